@@ -0,0 +1,105 @@
+/**
+ * contains_bench.c
+ *
+ * Micro-benchmark of the string search of -contains against memmem.
+ *
+ * Build from the top of the repository:
+ *      gcc -O2 -pthread -o contains_bench bench/contains_bench.c
+ *
+ * Usage:
+ *      ./contains_bench [ <megabytes> [ <rounds> ] ]
+ *
+ * The file includes libfind.c to reach its static functions, so it always
+ * measures the search of the tree it is built from.
+ */
+
+#include "../libfind.c"
+
+static const char *bench_strings[] = {
+    "e",                        //a single byte goes to memchr
+    "the",                      //frequent
+    "include",
+    "pthread_mutex_lock",
+    "zzzzzzzzzz",               //not in the text
+    "static int needle(void)",  //not in the text, frequent first byte
+};
+
+/**
+ *
+ * \brief: monotonic clock in nanoseconds
+ *
+ */
+
+static long long bench_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ *
+ * \brief: counts the occurrences of a string with a search function
+ *
+ */
+
+static size_t bench_count(const char *text, size_t len, const char *str, int own){
+    size_t n = strlen(str);
+    size_t hits = 0;
+    const char *p = text;
+    const char *end = text + len;
+    while (p < end){
+        const char *hit = own ? search_string(p, (size_t)(end - p), str, n) : memmem(p, (size_t)(end - p), str, n);
+        if (hit == NULL){
+            break;
+        }
+        hits++;
+        p = hit + 1;
+    }
+    return hits;
+}
+
+int main(int argc, char **argv){
+    static const char *words[] = {"static", "int", "the", "include", "return", "pthread_mutex_lock", "if", "else",
+                                  "void", "struct", "walker", "(w);", "\n", "{", "}", "error", "path", "=", "0;"};
+    size_t mb = argc > 1 ? (size_t)parse_number("megabytes", argv[1], 1) : 64;
+    int rounds = argc > 2 ? parse_number("rounds", argv[2], 1) : 5;
+    size_t len = mb * 1024 * 1024;
+    char *text = xmalloc(len + 1);
+    size_t pos = 0;
+
+    srand(1);
+    while (pos < len){
+        const char *word = words[rand() % (sizeof(words) / sizeof(words[0]))];
+        size_t n = strlen(word);
+        if (pos + n + 1 > len){
+            break;
+        }
+        memcpy(text + pos, word, n);
+        pos += n;
+        text[pos++] = ' ';
+    }
+    memset(text + pos, ' ', len - pos);
+    text[len] = '\0';
+
+    printf("%-26s %12s %12s %10s\n", "string", "memmem GB/s", "search GB/s", "matches");
+    for (size_t s = 0; s < sizeof(bench_strings) / sizeof(bench_strings[0]); s++){
+        size_t hits_mm = 0;
+        size_t hits_own = 0;
+        long long start = bench_now();
+        for (int r = 0; r < rounds; r++){
+            hits_mm += bench_count(text, len, bench_strings[s], 0);
+        }
+        long long mid = bench_now();
+        for (int r = 0; r < rounds; r++){
+            hits_own += bench_count(text, len, bench_strings[s], 1);
+        }
+        long long end = bench_now();
+        if (hits_mm != hits_own){
+            error(EXIT_FAILURE, 0, "mismatch for %s: %zu vs %zu", bench_strings[s], hits_mm, hits_own);
+        }
+        printf("%-26s %12.2f %12.2f %10zu\n", bench_strings[s],
+               (double)len * rounds / (double)(mid - start), (double)len * rounds / (double)(end - mid), hits_own / (size_t)rounds);
+    }
+    free(text);
+    return EXIT_SUCCESS;
+}
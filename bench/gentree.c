@@ -0,0 +1,355 @@
+/**
+ * gentree.c
+ *
+ * Generator of the synthetic trees the benchmarks run on. The same shape,
+ * count and seed always give the same names, types, sizes, owners and
+ * times, created in the same order.
+ *
+ * Build from the top of the repository:
+ *      gcc -O2 -o gentree bench/gentree.c
+ *
+ * Usage:
+ *      ./gentree [ -n <count> ] [ -s <seed> ] <shape> <directory>
+ *
+ * Shapes:
+ *      flat    one directory with <count> files (default 1000000)
+ *      deep    a chain of <count> directories, a file every 100 levels (default 10000)
+ *      wide    1000 directories below the top, <count> files spread over them (default 1000000)
+ *      mixed   a random tree of <count> items: files, directories, symbolic links
+ *              (some dangling), hard links and fifos (default 200000)
+ *      owners  like mixed, the items belong to 64 users and 16 groups, needs root (default 200000)
+ *
+ * The directory must not exist yet.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <error.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define GEN_MAX_DEPTH 8     //deepest level of the random trees
+#define GEN_OWNERS 64       //users of the owners shape, starting at uid 1000
+#define GEN_GROUPS 16       //groups of the owners shape, starting at gid 1000
+#define GEN_EPOCH 1577836800    //2020-01-01, the times are spread over the year after it
+
+static const char *gen_exts[] = {".c", ".h", ".o", ".txt", ".md", ".log", "", ".tar.gz"};
+
+/**
+ * state of one generator run
+ */
+struct gen {
+    uint64_t rng;           //xorshift64 state
+    int owners;             //1 to hand the items to GEN_OWNERS users
+    char **dirs;            //paths of the directories created so far, relative to the top
+    int *depths;
+    size_t ndirs;
+    size_t cap;
+    size_t created;
+};
+
+static uint64_t gen_rand(struct gen *g);
+static void gen_item(struct gen *g, const char *path, mode_t type, off_t size);
+static void gen_stamp(struct gen *g, const char *path);
+static void gen_add_dir(struct gen *g, const char *path, int depth);
+static void gen_flat(struct gen *g, size_t count);
+static void gen_deep(struct gen *g, size_t count);
+static void gen_wide(struct gen *g, size_t count);
+static void gen_mixed(struct gen *g, size_t count);
+
+int main(int argc, char **argv){
+    struct gen g;
+    long count = 0;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1){
+        switch (opt){
+            case 'n':
+                count = strtol(optarg, NULL, 10);
+                if (count < 1){
+                    error(EXIT_FAILURE, 0, "invalid count `%s'", optarg);
+                }
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [ -n <count> ] [ -s <seed> ] flat|deep|wide|mixed|owners <directory>\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2){
+        error(EXIT_FAILURE, 0, "expected a shape and a directory");
+    }
+    const char *shape = argv[optind];
+    memset(&g, 0, sizeof(g));
+    g.rng = seed * 0x9E3779B97F4A7C15ULL + 1;		//xorshift must not start at 0
+    if (mkdir(argv[optind + 1], 0755) == -1){
+        error(EXIT_FAILURE, errno, "%s", argv[optind + 1]);
+    }
+    if (chdir(argv[optind + 1]) == -1){
+        error(EXIT_FAILURE, errno, "%s", argv[optind + 1]);
+    }
+    umask(0);
+
+    if (strcmp(shape, "flat") == 0){
+        gen_flat(&g, count ? (size_t)count : 1000000);
+    }
+    else if (strcmp(shape, "deep") == 0){
+        gen_deep(&g, count ? (size_t)count : 10000);
+    }
+    else if (strcmp(shape, "wide") == 0){
+        gen_wide(&g, count ? (size_t)count : 1000000);
+    }
+    else if (strcmp(shape, "mixed") == 0 || strcmp(shape, "owners") == 0){
+        g.owners = strcmp(shape, "owners") == 0;
+        gen_mixed(&g, count ? (size_t)count : 200000);
+    }
+    else {
+        error(EXIT_FAILURE, 0, "unknown shape `%s'", shape);
+    }
+    printf("%s: %zu items\n", argv[optind + 1], g.created + 1);
+    return 0;
+}
+
+/**
+ *
+ * \brief: next number of the xorshift64 generator, the same seed always gives the same sequence
+ *
+ * \param g - the generator
+ *
+ * \return the number
+ *
+ */
+
+static uint64_t gen_rand(struct gen *g){
+    g->rng ^= g->rng << 13;
+    g->rng ^= g->rng >> 7;
+    g->rng ^= g->rng << 17;
+    return g->rng;
+}
+
+/**
+ *
+ * \brief: creates one item and gives it its time and, for the owners shape, its owner
+ *
+ * \param g - the generator
+ * \param path - path of the item relative to the top
+ * \param type - S_IFREG, S_IFDIR or S_IFIFO
+ * \param size - size of a regular file, the file is sparse
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void gen_item(struct gen *g, const char *path, mode_t type, off_t size){
+    int rc;
+    if (type == S_IFDIR){
+        rc = mkdir(path, 0755);
+    }
+    else if (type == S_IFIFO){
+        rc = mkfifo(path, 0644);
+    }
+    else {
+        int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, (gen_rand(g) % 4 == 0) ? 0755 : 0644);
+        rc = fd;
+        if (fd != -1 && size > 0 && ftruncate(fd, size) == -1){
+            error(EXIT_FAILURE, errno, "%s", path);
+        }
+        if (fd != -1){
+            close(fd);
+        }
+    }
+    if (rc == -1){
+        error(EXIT_FAILURE, errno, "%s", path);
+    }
+    gen_stamp(g, path);
+    if (g->owners){
+        uid_t uid = 1000 + (uid_t)(gen_rand(g) % GEN_OWNERS);
+        gid_t gid = 1000 + (gid_t)(gen_rand(g) % GEN_GROUPS);
+        if (lchown(path, uid, gid) == -1){
+            error(EXIT_FAILURE, errno, "lchown %s, the owners shape needs root", path);
+        }
+    }
+    g->created++;
+}
+
+/**
+ *
+ * \brief: gives an item a random time in the year after GEN_EPOCH, symbolic links are not followed
+ *
+ * Directories are stamped again once they are complete, creating their items changed the time.
+ *
+ * \param g - the generator
+ * \param path - path of the item relative to the top
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void gen_stamp(struct gen *g, const char *path){
+    struct timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = GEN_EPOCH + (time_t)(gen_rand(g) % (365 * 86400));
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    if (utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW) == -1){
+        error(EXIT_FAILURE, errno, "%s", path);
+    }
+}
+
+/**
+ *
+ * \brief: remembers a directory, later items of the random trees are put into one of them
+ *
+ * \param g - the generator
+ * \param path - path of the directory relative to the top
+ * \param depth - its depth, the top is 0
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void gen_add_dir(struct gen *g, const char *path, int depth){
+    if (g->ndirs == g->cap){
+        g->cap = g->cap ? g->cap * 2 : 64;
+        g->dirs = realloc(g->dirs, g->cap * sizeof(*g->dirs));
+        g->depths = realloc(g->depths, g->cap * sizeof(*g->depths));
+        if (g->dirs == NULL || g->depths == NULL){
+            error(EXIT_FAILURE, errno, "realloc");
+        }
+    }
+    g->dirs[g->ndirs] = strdup(path);
+    g->depths[g->ndirs++] = depth;
+}
+
+/**
+ *
+ * \brief: one directory holding all files
+ *
+ */
+
+static void gen_flat(struct gen *g, size_t count){
+    char name[64];
+    for (size_t i = 0; i < count; i++){
+        snprintf(name, sizeof(name), "f%07zu%s", i, gen_exts[gen_rand(g) % 8]);
+        gen_item(g, name, S_IFREG, 0);
+    }
+}
+
+/**
+ *
+ * \brief: a chain of directories, the path grows past PATH_MAX for large counts
+ *
+ * The chain is created relative to the last directory, so the length of the path never matters.
+ *
+ */
+
+static void gen_deep(struct gen *g, size_t count){
+    for (size_t i = 0; i < count; i++){
+        if (i % 100 == 0){
+            gen_item(g, "f.txt", S_IFREG, 0);
+        }
+        gen_item(g, "d", S_IFDIR, 0);
+        if (chdir("d") == -1){
+            error(EXIT_FAILURE, errno, "chdir at level %zu", i);
+        }
+    }
+    for (size_t i = 0; i < count; i++){		//back up, every directory is complete now
+        if (chdir("..") == -1){
+            error(EXIT_FAILURE, errno, "chdir ..");
+        }
+        gen_stamp(g, "d");
+    }
+}
+
+/**
+ *
+ * \brief: 1000 directories directly below the top, the files are dealt out round robin
+ *
+ */
+
+static void gen_wide(struct gen *g, size_t count){
+    char name[64];
+    for (int d = 0; d < 1000; d++){
+        snprintf(name, sizeof(name), "dir%03d", d);
+        gen_item(g, name, S_IFDIR, 0);
+    }
+    for (size_t i = 0; i < count; i++){
+        snprintf(name, sizeof(name), "dir%03zu/f%06zu%s", i % 1000, i / 1000, gen_exts[gen_rand(g) % 8]);
+        gen_item(g, name, S_IFREG, 0);
+    }
+    for (int d = 0; d < 1000; d++){
+        snprintf(name, sizeof(name), "dir%03d", d);
+        gen_stamp(g, name);
+    }
+}
+
+/**
+ *
+ * \brief: a random tree, each new item goes into a random directory created before it
+ *
+ * About one item in eight is a directory, one in twenty a symbolic link, one in fifty a hard
+ * link and one in two hundred a fifo, the rest are regular files of random sizes.
+ *
+ */
+
+static void gen_mixed(struct gen *g, size_t count){
+    static const off_t sizes[] = {0, 100, 4096, 65536, 1 << 20, 50 << 20};
+    char path[4096];
+    char target[4096];
+    char last_file[4096] = "";
+
+    gen_add_dir(g, ".", 0);
+    for (size_t i = 0; i < count; i++){
+        size_t d = (size_t)(gen_rand(g) % g->ndirs);
+        unsigned kind = (unsigned)(gen_rand(g) % 1000);
+        snprintf(path, sizeof(path), "%s/n%zu%s", g->dirs[d], i, kind < 125 ? "" : gen_exts[gen_rand(g) % 8]);
+        if (kind < 125 && g->depths[d] < GEN_MAX_DEPTH){
+            gen_item(g, path, S_IFDIR, 0);
+            gen_add_dir(g, path, g->depths[d] + 1);
+        }
+        else if (kind < 175){		//points at an earlier directory or nowhere, relative to the link
+            size_t len = 0;
+            target[0] = '\0';
+            for (int up = 0; up < g->depths[d]; up++){
+                len += (size_t)snprintf(target + len, sizeof(target) - len, "../");
+            }
+            if (gen_rand(g) % 10 == 0){
+                snprintf(target + len, sizeof(target) - len, "missing%zu", i);
+            }
+            else {
+                snprintf(target + len, sizeof(target) - len, "%s", g->dirs[gen_rand(g) % g->ndirs]);
+            }
+            if (symlink(target, path) == -1){
+                error(EXIT_FAILURE, errno, "%s", path);
+            }
+            gen_stamp(g, path);
+            if (g->owners && lchown(path, 1000 + (uid_t)(gen_rand(g) % GEN_OWNERS), 1000 + (gid_t)(gen_rand(g) % GEN_GROUPS)) == -1){
+                error(EXIT_FAILURE, errno, "lchown %s, the owners shape needs root", path);
+            }
+            g->created++;
+        }
+        else if (kind < 195 && last_file[0] != '\0'){
+            if (link(last_file, path) == -1){
+                error(EXIT_FAILURE, errno, "%s", path);
+            }
+            g->created++;
+        }
+        else if (kind < 200){
+            gen_item(g, path, S_IFIFO, 0);
+        }
+        else {
+            gen_item(g, path, S_IFREG, sizes[gen_rand(g) % 6] + (off_t)(gen_rand(g) % 512));
+            snprintf(last_file, sizeof(last_file), "%s", path);
+        }
+    }
+    for (size_t d = g->ndirs; d-- > 1; ){
+        gen_stamp(g, g->dirs[d]);
+    }
+}
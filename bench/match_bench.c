@@ -0,0 +1,84 @@
+/**
+ * match_bench.c
+ *
+ * Micro-benchmark of the -name matchers against plain fnmatch.
+ *
+ * Build from the top of the repository:
+ *      gcc -O2 -pthread -o match_bench bench/match_bench.c
+ *
+ * Usage:
+ *      ./match_bench [ <names> [ <rounds> ] ]
+ *
+ * The file includes libfind.c to reach its static functions, so it always
+ * measures the matchers of the tree it is built from.
+ */
+
+#include "../libfind.c"
+
+static const char *bench_patterns[] = {
+    "Makefile",     //exact
+    "lib*",         //prefix
+    "*.c",          //suffix
+    "*test*",       //contains
+    "*.[ch]",       //glob
+};
+
+/**
+ *
+ * \brief: monotonic clock in nanoseconds
+ *
+ */
+
+static long long bench_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv){
+    static const char *stems[] = {"main", "libfoo", "test_io", "Makefile", "README", "parser", "x"};
+    static const char *exts[] = {".c", ".h", ".o", ".txt", "", ".md"};
+    size_t count = argc > 1 ? (size_t)parse_number("names", argv[1], 1) : 100000;
+    int rounds = argc > 2 ? parse_number("rounds", argv[2], 1) : 20;
+    char **names = xmalloc(count * sizeof(*names));
+    size_t *lens = xmalloc(count * sizeof(*lens));
+
+    srand(1);
+    for (size_t i = 0; i < count; i++){
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s%d%s", stems[rand() % 7], rand() % 1000, exts[rand() % 6]);
+        if (rand() % 5 == 0){
+            snprintf(buf, sizeof(buf), "%s", stems[rand() % 7]);
+        }
+        names[i] = strdup(buf);
+        lens[i] = strlen(buf);
+    }
+
+    printf("%-10s %-9s %12s %12s %8s\n", "pattern", "kind", "fnmatch ns", "compiled ns", "matches");
+    for (size_t p = 0; p < sizeof(bench_patterns) / sizeof(bench_patterns[0]); p++){
+        static const char *kinds[] = {"exact", "prefix", "suffix", "contains", "glob"};
+        struct pattern *pat = compile_pattern(bench_patterns[p], 0);
+        size_t hits_fn = 0;
+        size_t hits_pat = 0;
+        long long start = bench_now();
+        for (int r = 0; r < rounds; r++){
+            for (size_t i = 0; i < count; i++){
+                hits_fn += fnmatch(bench_patterns[p], names[i], FNM_NOESCAPE) == 0;
+            }
+        }
+        long long mid = bench_now();
+        for (int r = 0; r < rounds; r++){
+            for (size_t i = 0; i < count; i++){
+                hits_pat += (size_t)match_pattern(pat, names[i], lens[i]);
+            }
+        }
+        long long end = bench_now();
+        if (hits_fn != hits_pat){
+            error(EXIT_FAILURE, 0, "mismatch for %s: %zu vs %zu", bench_patterns[p], hits_fn, hits_pat);
+        }
+        printf("%-10s %-9s %12.1f %12.1f %8zu\n", bench_patterns[p], kinds[pat->kind],
+               (double)(mid - start) / ((double)count * rounds),
+               (double)(end - mid) / ((double)count * rounds), hits_pat / (size_t)rounds);
+    }
+    return EXIT_SUCCESS;
+}
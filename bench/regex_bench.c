@@ -0,0 +1,93 @@
+/**
+ * regex_bench.c
+ *
+ * Micro-benchmark of the -regex matcher against regexec of the C library.
+ *
+ * Build from the top of the repository:
+ *      gcc -O2 -pthread -o regex_bench bench/regex_bench.c
+ *
+ * Usage:
+ *      ./regex_bench [ <paths> [ <rounds> ] ]
+ *
+ * The file includes libfind.c to reach its static functions, so it always
+ * measures the matcher of the tree it is built from.
+ */
+
+#include "../libfind.c"
+
+static const char *bench_regexes[] = {
+    "\\./src/main\\.c",                         //exact
+    ".*\\.c",                                   //suffix
+    ".*/src/.*\\.(c|h)",                        //required string
+    ".*test.*",                                 //required string
+    "\\./usr/lib/.*\\.so(\\.[0-9]+)*",          //prefix
+    ".*/[a-z]+[0-9]{2,3}\\.(txt|md)",           //no literal
+};
+
+/**
+ *
+ * \brief: monotonic clock in nanoseconds
+ *
+ */
+
+static long long bench_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv){
+    static const char *dirs[] = {"src", "include", "usr", "lib", "test", "doc", "build", "tools"};
+    static const char *stems[] = {"main", "libfoo", "test_io", "Makefile", "README", "parser", "x"};
+    static const char *exts[] = {".c", ".h", ".o", ".txt", "", ".md", ".so", ".so.1.2"};
+    size_t count = argc > 1 ? (size_t)parse_number("paths", argv[1], 1) : 100000;
+    int rounds = argc > 2 ? parse_number("rounds", argv[2], 1) : 10;
+    char **paths = xmalloc(count * sizeof(*paths));
+    size_t *lens = xmalloc(count * sizeof(*lens));
+
+    srand(1);
+    for (size_t i = 0; i < count; i++){
+        char buf[256];
+        int len = snprintf(buf, sizeof(buf), ".");
+        for (int depth = rand() % 6; depth >= 0; depth--){
+            len += snprintf(buf + len, sizeof(buf) - len, "/%s", dirs[rand() % 8]);
+        }
+        snprintf(buf + len, sizeof(buf) - len, "/%s%d%s", stems[rand() % 7], rand() % 1000, exts[rand() % 8]);
+        if (i % 1000 == 0){
+            snprintf(buf, sizeof(buf), "./src/main.c");
+        }
+        paths[i] = strdup(buf);
+        lens[i] = strlen(buf);
+    }
+
+    printf("%-34s %12s %12s %8s\n", "regex", "regexec ns", "compiled ns", "matches");
+    for (size_t p = 0; p < sizeof(bench_regexes) / sizeof(bench_regexes[0]); p++){
+        struct regex *re = compile_regex(bench_regexes[p], "-regex", 0);
+        struct dfa dfa = {0};
+        size_t hits_rx = 0;
+        size_t hits_dfa = 0;
+        long long start = bench_now();
+        for (int r = 0; r < rounds; r++){
+            for (size_t i = 0; i < count; i++){
+                regmatch_t m;
+                hits_rx += regexec(&re->compiled, paths[i], 1, &m, 0) == 0 && m.rm_so == 0 && (size_t)m.rm_eo == lens[i];
+            }
+        }
+        long long mid = bench_now();
+        for (int r = 0; r < rounds; r++){
+            for (size_t i = 0; i < count; i++){
+                hits_dfa += (size_t)match_regex(re, &dfa, paths[i], lens[i]);
+            }
+        }
+        long long end = bench_now();
+        if (hits_rx != hits_dfa){
+            error(EXIT_FAILURE, 0, "mismatch for %s: %zu vs %zu", bench_regexes[p], hits_rx, hits_dfa);
+        }
+        printf("%-34s %12.1f %12.1f %8zu\n", bench_regexes[p],
+               (double)(mid - start) / ((double)count * rounds),
+               (double)(end - mid) / ((double)count * rounds), hits_dfa / (size_t)rounds);
+        dfa_free(&dfa);
+        regex_free(re);
+    }
+    return EXIT_SUCCESS;
+}
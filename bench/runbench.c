@@ -0,0 +1,348 @@
+/**
+ * runbench.c
+ *
+ * Runs the representative queries of find on the trees made by gentree and
+ * reports entries per second, system calls per entry and peak RSS, compared
+ * to a stored baseline.
+ *
+ * Build from the top of the repository:
+ *      gcc -O2 -o runbench bench/runbench.c
+ *
+ * Usage:
+ *      ./runbench [ -f <find> ] [ -l <syscount.so> ] [ -b <baseline> ] [ -w ]
+ *                 [ -r <rounds> ] [ -c ] <trees>
+ *
+ *      <trees>  directory holding the trees flat, deep, wide, mixed and owners,
+ *               missing ones are left out
+ *      -f       the find binary to measure (default ./find)
+ *      -l       the counting shim, system calls are not reported without it (default ./syscount.so)
+ *      -b       baseline to compare with (default baseline.txt), a missing file is no error
+ *      -w       write the results to the baseline instead of comparing
+ *      -r       timed runs per query, the median is reported (default 5)
+ *      -c       cold cache as well: the page, dentry and inode caches are dropped
+ *               before every run, needs root and only means something on a disk
+ *               file system like an ext4 loop image, tmpfs keeps everything in memory
+ *
+ * A result is a regression if it walks fewer than 80% of the entries per second of the
+ * baseline, makes more than 2% more system calls per entry or needs more than 25% more
+ * memory. The exit status is 1 if there was one.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <error.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_MAX_RESULTS 128
+#define BENCH_SLOWER 0.80       //entries per second below this share of the baseline are a regression
+#define BENCH_MORE_CALLS 1.02   //system calls per entry above this share of the baseline are a regression
+#define BENCH_MORE_RSS 1.25     //peak RSS above this share of the baseline is a regression
+
+static const char *bench_trees[] = {"flat", "deep", "wide", "mixed", "owners"};
+
+/**
+ * a query and its arguments after the start point
+ */
+struct query {
+    const char *name;
+    const char *args[4];
+};
+
+static const struct query bench_queries[] = {
+    {"print", {NULL}},
+    {"name", {"-name", "*.c", NULL}},
+    {"type", {"-type", "d", NULL}},
+    {"user", {"-user", "1000", NULL}},
+    {"ls", {"-ls", NULL}},
+};
+
+/**
+ * one measured or stored result
+ */
+struct result {
+    char tree[16];
+    char query[16];
+    char mode[8];
+    double rate;            //entries per second
+    double calls;           //system calls per entry, negative if not counted
+    long rss;               //peak RSS in kB
+};
+
+/**
+ * settings of the run
+ */
+struct bench {
+    const char *find;
+    const char *shim;       //NULL if the counting shim is not there
+    int rounds;
+    char countfile[64];
+};
+
+static long bench_run(const struct bench *b, const char *tree, const struct query *q, int cold, int count_lines,
+    double *secs, long *rss, long *calls);
+static void bench_drop_caches(void);
+static int bench_cmp_double(const void *a, const void *b);
+static size_t bench_load(const char *file, struct result *res);
+static const struct result *bench_find(const struct result *res, size_t n, const struct result *r);
+
+int main(int argc, char **argv){
+    struct bench b = {"./find", "./syscount.so", 5, ""};
+    const char *baseline = "baseline.txt";
+    struct result base[BENCH_MAX_RESULTS];
+    struct result now[BENCH_MAX_RESULTS];
+    size_t nbase, nnow = 0;
+    int write_baseline = 0;
+    int cold = 0;
+    int regressions = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:l:b:wr:c")) != -1){
+        switch (opt){
+            case 'f': b.find = optarg; break;
+            case 'l': b.shim = optarg; break;
+            case 'b': baseline = optarg; break;
+            case 'w': write_baseline = 1; break;
+            case 'r': b.rounds = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+            case 'c': cold = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [ -f <find> ] [ -l <syscount.so> ] [ -b <baseline> ] [ -w ] [ -r <rounds> ] [ -c ] <trees>\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1){
+        error(EXIT_FAILURE, 0, "expected the directory of the trees");
+    }
+    if (access(b.shim, R_OK) == -1){
+        error(0, 0, "%s not found, system calls are not counted", b.shim);
+        b.shim = NULL;
+    }
+    snprintf(b.countfile, sizeof(b.countfile), "/tmp/runbench.%d", (int)getpid());
+    nbase = write_baseline ? 0 : bench_load(baseline, base);
+
+    printf("%-7s %-6s %-5s %10s %12s %9s %9s  %s\n", "tree", "query", "mode", "entries", "entries/s", "calls/ent", "rss kB", "vs baseline");
+    for (size_t t = 0; t < sizeof(bench_trees) / sizeof(bench_trees[0]); t++){
+        char tree[4096];
+        struct stat st;
+        long entries = 0;
+        snprintf(tree, sizeof(tree), "%s/%s", argv[optind], bench_trees[t]);
+        if (stat(tree, &st) == -1){
+            continue;
+        }
+        for (size_t qi = 0; qi < sizeof(bench_queries) / sizeof(bench_queries[0]); qi++){
+            const struct query *q = &bench_queries[qi];
+            for (int c = 0; c <= cold; c++){
+                double secs[64];
+                double unused;
+                long rss = 0, calls = -1, r;
+                int rounds = b.rounds < 64 ? b.rounds : 64;
+                if (entries == 0){		//the warm up run of the first query counts the entries
+                    entries = bench_run(&b, tree, &bench_queries[0], 0, 1, &unused, &r, &calls);
+                }
+                for (int i = 0; i < rounds; i++){
+                    bench_run(&b, tree, q, c, 0, &secs[i], &r, &calls);
+                    rss = r > rss ? r : rss;
+                }
+                qsort(secs, (size_t)rounds, sizeof(secs[0]), bench_cmp_double);
+
+                if (nnow == BENCH_MAX_RESULTS){
+                    error(EXIT_FAILURE, 0, "more than %d results", BENCH_MAX_RESULTS);
+                }
+                struct result *res = &now[nnow++];
+                snprintf(res->tree, sizeof(res->tree), "%s", bench_trees[t]);
+                snprintf(res->query, sizeof(res->query), "%s", q->name);
+                snprintf(res->mode, sizeof(res->mode), "%s", c ? "cold" : "warm");
+                res->rate = (double)entries / secs[rounds / 2];
+                res->calls = calls >= 0 ? (double)calls / (double)entries : -1;
+                res->rss = rss;
+                printf("%-7s %-6s %-5s %10ld %12.0f %9.3f %9ld ", res->tree, res->query, res->mode, entries, res->rate, res->calls, res->rss);
+
+                const struct result *old = bench_find(base, nbase, res);
+                if (old != NULL){
+                    int slow = res->rate < old->rate * BENCH_SLOWER;
+                    int more = res->calls >= 0 && old->calls >= 0 && res->calls > old->calls * BENCH_MORE_CALLS + 0.001;
+                    int fat = res->rss > old->rss * BENCH_MORE_RSS + 1024;
+                    printf(" %+5.0f%% %+7.3f %+6ld%s%s%s", (res->rate / old->rate - 1) * 100, res->calls - old->calls, res->rss - old->rss,
+                        slow ? " SLOWER" : "", more ? " MORE-CALLS" : "", fat ? " MORE-RSS" : "");
+                    regressions += slow || more || fat;
+                }
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+    unlink(b.countfile);
+
+    if (write_baseline){
+        FILE *fp = fopen(baseline, "w");
+        if (fp == NULL){
+            error(EXIT_FAILURE, errno, "%s", baseline);
+        }
+        fprintf(fp, "# tree query mode entries/s calls/entry rss-kB, written by runbench -w\n");
+        for (size_t i = 0; i < nnow; i++){
+            fprintf(fp, "%s %s %s %.0f %.3f %ld\n", now[i].tree, now[i].query, now[i].mode, now[i].rate, now[i].calls, now[i].rss);
+        }
+        fclose(fp);
+        printf("baseline written to %s\n", baseline);
+    }
+    else if (regressions > 0){
+        printf("%d regression(s) against %s\n", regressions, baseline);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ *
+ * \brief: runs find once on a tree and measures it
+ *
+ * The output goes to /dev/null, or through a pipe if its lines are counted. The peak RSS
+ * comes from wait4, the system calls from the counting shim.
+ *
+ * \param b - settings of the run
+ * \param tree - the start point
+ * \param q - the query
+ * \param cold - 1 to drop the caches first
+ * \param count_lines - 1 to count the lines printed
+ * \param secs - receives the wall clock time
+ * \param rss - receives the peak RSS in kB
+ * \param calls - receives the number of system calls, left alone without the shim
+ *
+ * \return the number of lines printed if they were counted, 0 otherwise
+ *
+ */
+
+static long bench_run(const struct bench *b, const char *tree, const struct query *q, int cold, int count_lines,
+    double *secs, long *rss, long *calls){
+    struct timespec start, end;
+    struct rusage ru;
+    int status;
+    int fds[2];
+    long lines = 0;
+
+    if (cold){
+        bench_drop_caches();
+    }
+    if (count_lines && pipe(fds) == -1){
+        error(EXIT_FAILURE, errno, "pipe");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == -1){
+        error(EXIT_FAILURE, errno, "fork");
+    }
+    if (pid == 0){
+        const char *argv[8] = {b->find, tree};
+        int out = count_lines ? fds[1] : open("/dev/null", O_WRONLY);
+        for (int i = 0; q->args[i] != NULL; i++){
+            argv[2 + i] = q->args[i];
+        }
+        dup2(out, STDOUT_FILENO);
+        if (b->shim != NULL){
+            setenv("LD_PRELOAD", b->shim, 1);
+            setenv("SYSCOUNT_OUT", b->countfile, 1);
+        }
+        execv(b->find, (char **)argv);
+        error(127, errno, "%s", b->find);
+    }
+    if (count_lines){
+        char buf[65536];
+        ssize_t n;
+        close(fds[1]);
+        while ((n = read(fds[0], buf, sizeof(buf))) > 0){
+            for (ssize_t i = 0; i < n; i++){
+                lines += buf[i] == '\n';
+            }
+        }
+        close(fds[0]);
+    }
+    if (wait4(pid, &status, 0, &ru) == -1){
+        error(EXIT_FAILURE, errno, "wait4");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+        error(EXIT_FAILURE, 0, "%s %s %s failed", b->find, tree, q->name);
+    }
+    *secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    *rss = ru.ru_maxrss;
+    if (b->shim != NULL){
+        FILE *fp = fopen(b->countfile, "r");
+        char name[32];
+        long n;
+        while (fp != NULL && fscanf(fp, "%31s %ld", name, &n) == 2){
+            if (strcmp(name, "total") == 0){
+                *calls = n;
+            }
+        }
+        if (fp != NULL){
+            fclose(fp);
+        }
+    }
+    return lines;
+}
+
+/**
+ *
+ * \brief: writes back dirty pages and drops the page, dentry and inode caches
+ *
+ */
+
+static void bench_drop_caches(void){
+    int fd;
+    sync();
+    if ((fd = open("/proc/sys/vm/drop_caches", O_WRONLY)) == -1 || write(fd, "3\n", 2) != 2){
+        error(EXIT_FAILURE, errno, "dropping the caches needs root");
+    }
+    close(fd);
+}
+
+static int bench_cmp_double(const void *a, const void *b){
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ *
+ * \brief: reads a baseline, lines starting with # are comments
+ *
+ * \param file - the baseline
+ * \param res - receives up to BENCH_MAX_RESULTS results
+ *
+ * \return the number of results read, 0 if there is no baseline
+ *
+ */
+
+static size_t bench_load(const char *file, struct result *res){
+    FILE *fp = fopen(file, "r");
+    char line[256];
+    size_t n = 0;
+    if (fp == NULL){
+        return 0;
+    }
+    while (n < BENCH_MAX_RESULTS && fgets(line, sizeof(line), fp) != NULL){
+        struct result *r = &res[n];
+        if (line[0] != '#' && sscanf(line, "%15s %15s %7s %lf %lf %ld", r->tree, r->query, r->mode, &r->rate, &r->calls, &r->rss) == 6){
+            n++;
+        }
+    }
+    fclose(fp);
+    return n;
+}
+
+static const struct result *bench_find(const struct result *res, size_t n, const struct result *r){
+    for (size_t i = 0; i < n; i++){
+        if (strcmp(res[i].tree, r->tree) == 0 && strcmp(res[i].query, r->query) == 0 && strcmp(res[i].mode, r->mode) == 0){
+            return &res[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,179 @@
+/**
+ * syscount.c
+ *
+ * LD_PRELOAD shim counting the system calls find makes through the libc
+ * wrappers, including the raw ones made with syscall(2) for io_uring.
+ *
+ * Build from the top of the repository:
+ *      gcc -O2 -shared -fPIC -o syscount.so bench/syscount.c -ldl
+ *
+ * Usage:
+ *      SYSCOUNT_OUT=<file> LD_PRELOAD=./syscount.so ./find ...
+ *
+ * When the program exits one line "<name> <count>" per wrapper that was
+ * called is written to the file, the last line is "total <count>".
+ * Calls made inside libc itself (opendir, getpwuid, stdio) are not seen,
+ * find makes all calls of the walk directly.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/**
+ * the counted wrappers, the order of the table
+ */
+enum sc_call {
+    SC_OPEN,
+    SC_OPENAT,
+    SC_CLOSE,
+    SC_READ,
+    SC_WRITE,
+    SC_GETDENTS64,
+    SC_STATX,
+    SC_FSTATAT,
+    SC_LSTAT,
+    SC_STAT,
+    SC_FSTAT,
+    SC_READLINK,
+    SC_SYSCALL,
+    SC_NCALLS
+};
+
+static const char *sc_names[SC_NCALLS] = {
+    "open", "openat", "close", "read", "write", "getdents64", "statx",
+    "fstatat", "lstat", "stat", "fstat", "readlink", "syscall",
+};
+
+static atomic_ulong sc_counts[SC_NCALLS];
+
+/**
+ * looks up the real wrapper once and counts the call, the wrappers below are built from it
+ */
+#define SC_REAL(call, name, type) \
+    static __typeof__(type) real; \
+    atomic_fetch_add_explicit(&sc_counts[call], 1, memory_order_relaxed); \
+    if (real == NULL){ \
+        real = (type)dlsym(RTLD_NEXT, name); \
+    }
+
+int open(const char *path, int flags, ...){
+    SC_REAL(SC_OPEN, "open", int (*)(const char *, int, ...));
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)){
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return real(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...){
+    SC_REAL(SC_OPENAT, "openat", int (*)(int, const char *, int, ...));
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)){
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return real(dirfd, path, flags, mode);
+}
+
+int close(int fd){
+    SC_REAL(SC_CLOSE, "close", int (*)(int));
+    return real(fd);
+}
+
+ssize_t read(int fd, void *buf, size_t count){
+    SC_REAL(SC_READ, "read", ssize_t (*)(int, void *, size_t));
+    return real(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count){
+    SC_REAL(SC_WRITE, "write", ssize_t (*)(int, const void *, size_t));
+    return real(fd, buf, count);
+}
+
+ssize_t getdents64(int fd, void *buf, size_t count){
+    SC_REAL(SC_GETDENTS64, "getdents64", ssize_t (*)(int, void *, size_t));
+    return real(fd, buf, count);
+}
+
+int statx(int dirfd, const char *path, int flags, unsigned int mask, struct statx *stx){
+    SC_REAL(SC_STATX, "statx", int (*)(int, const char *, int, unsigned int, struct statx *));
+    return real(dirfd, path, flags, mask, stx);
+}
+
+int fstatat(int dirfd, const char *path, struct stat *st, int flags){
+    SC_REAL(SC_FSTATAT, "fstatat", int (*)(int, const char *, struct stat *, int));
+    return real(dirfd, path, st, flags);
+}
+
+int lstat(const char *path, struct stat *st){
+    SC_REAL(SC_LSTAT, "lstat", int (*)(const char *, struct stat *));
+    return real(path, st);
+}
+
+int stat(const char *path, struct stat *st){
+    SC_REAL(SC_STAT, "stat", int (*)(const char *, struct stat *));
+    return real(path, st);
+}
+
+int fstat(int fd, struct stat *st){
+    SC_REAL(SC_FSTAT, "fstat", int (*)(int, struct stat *));
+    return real(fd, st);
+}
+
+ssize_t readlink(const char *path, char *buf, size_t size){
+    SC_REAL(SC_READLINK, "readlink", ssize_t (*)(const char *, char *, size_t));
+    return real(path, buf, size);
+}
+
+long syscall(long number, ...){
+    SC_REAL(SC_SYSCALL, "syscall", long (*)(long, ...));
+    long a[6];
+    va_list ap;
+    va_start(ap, number);
+    for (int i = 0; i < 6; i++){		//the kernel takes at most six arguments, extra ones are ignored
+        a[i] = va_arg(ap, long);
+    }
+    va_end(ap);
+    return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+/**
+ *
+ * \brief: writes the counts to the file named by SYSCOUNT_OUT when the program exits
+ *
+ */
+
+__attribute__((destructor))
+static void sc_report(void){
+    const char *file = getenv("SYSCOUNT_OUT");
+    unsigned long total = 0;
+    FILE *fp;
+    if (file == NULL || (fp = fopen(file, "w")) == NULL){
+        return;
+    }
+    for (int i = 0; i < SC_NCALLS; i++){
+        unsigned long n = atomic_load(&sc_counts[i]);
+        if (n > 0){
+            fprintf(fp, "%s %lu\n", sc_names[i], n);
+        }
+        total += n;
+    }
+    fprintf(fp, "total %lu\n", total);
+    fclose(fp);
+}
@@ -0,0 +1,11389 @@
+/*
+ * libfind.c
+ *
+ *\description: the search engine of find as a library: a command line is compiled into
+ * a plan once, which is then walked over the start points. The items -print would write
+ * go to stdout (find_run), to a callback (find_walk) or to a pull iterator (find_iter_open).
+ * The interface is described in libfind.h, find.c is the command line tool built on it.
+ *
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <error.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fnmatch.h>
+#include <grp.h>
+#include <pwd.h>
+#include <time.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <setjmp.h>
+#include <stdarg.h>
+#include <regex.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "libfind.h"
+
+
+
+#define PATH_INITIAL 256    //initial capacity of the path buffer, it grows on demand
+#define DEQUE_INITIAL 64    //initial capacity of a work deque, it grows on demand
+#define FD_BUDGET_DEFAULT 64    //directories a walker keeps open at most (-fd-budget)
+#define IDLE_WAIT_NS 1000000    //how long an idle worker sleeps before looking for work again
+#define URING_BATCH 256     //directory entries whose statx requests are in flight together (-uring)
+#define DIRBUF_DEFAULT (256 * 1024) //bytes read from a directory with one getdents64 call (-dirbuf)
+#define JOBS_PER_CPU 4      //-j is limited to this many threads per online processor
+#define JOBS_MAX 1024       //and to this many in any case
+#define DIRBUF_MIN (4 * 1024)
+#define DIRBUF_MAX (64 * 1024 * 1024)
+#define OUTBUF_SIZE (64 * 1024) //bytes collected per output and walker before they are written
+#define LS_FIXED_MAX 128    //bytes of an -ls line without the path, user and group names
+#define RECORD_FIXED_MAX 256 //bytes of a -format ndjson or csv record without the path
+#define RECORD_MASK (STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | STATX_SIZE | STATX_MTIME | STATX_INO)   //stat fields of -format ndjson, csv and bin
+#define BIN_MAGIC "FINDREC1"
+#define BIN_VERSION 1
+#define IDCACHE_INITIAL 64  //initial number of slots of the user and group caches
+#define IDCACHE_HASH(id) ((size_t)((id) * 2654435761u))
+#define STRSET_INITIAL 64   //initial number of slots of the exact names of -name-from
+#define INDEX_MAGIC "FINDIDX1"  //first bytes of an index file (-build-index, -db)
+#define INDEX_VERSION 3     //2: start points are kept as absolute paths, see index_path, 3: the header has the build time
+#define INDEX_RESTART 64    //records between two whole paths in an index
+#define INDEX_NONE UINT32_MAX   //no record
+#define WATCH_MASK (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_CLOSE_WRITE | IN_ONLYDIR | IN_EXCL_UNLINK)   //events of -watch
+#define WATCH_BUF (64 * 1024)   //bytes of inotify events read at once
+#define WATCH_RESCAN_SEC 10 //seconds between rescans of directories without a watch
+#define WATCH_STOP_MS 100   //how often -watch looks whether find_walk or the iterator asked it to stop
+#define ITER_BATCH 256      //results an iterator hands from a walker to the reader at once
+#define ITER_BATCHES 4      //batches of an iterator besides one per walker, the walk is this far ahead at most
+#define REGEX_LIT_MAX 32   //bytes of the literals a -regex is checked for before its DFA runs
+#define REGEX_NODES_MAX 4096    //syntax tree nodes of a -regex, larger ones are matched by regexec
+#define REGEX_NFA_MAX 4096  //NFA states of a -regex, counted repetitions are expanded
+#define REGEX_DFA_STATES 1024   //DFA states a walker keeps per -regex, the cache starts over when it is full
+#define CONTAINS_BLOCK (1024 * 1024)   //bytes of a file -contains reads and searches at once
+#define CONTAINS_SNIFF 8192 //a null byte in this many leading bytes makes a file binary, -contains skips it
+#define CONTAINS_MAX_DEFAULT (64 * 1024 * 1024) //bytes of a file searched at most (-contains-max)
+#define CONTAINS_JOBS_DEFAULT 4 //threads reading the files of -contains while the walk goes on (-contains-jobs)
+#define READ_QUEUE 256      //files waiting for those threads, the walk waits when there are more
+#define SORT_MEM_DEFAULT (64 * 1024 * 1024) //bytes of results -sort keeps in memory, the rest goes to sorted runs in temporary files (-sort-mem)
+#define SORT_MEM_MIN (64 * 1024)
+#define SORT_FANIN 64       //runs merged at once, more are first merged into fewer longer ones
+#define DIRCACHE_DEFAULT (256 * 1024 * 1024) //bytes of directory listings -daemon keeps at most (-daemon-cache)
+#define DIRCACHE_MIN (64 * 1024)
+#define DIRCACHE_INITIAL 1024   //initial number of hash chains of the listings, they double with the listings
+#define DIRCACHE_RACY_SEC 2 //listings of directories changed this recently are not kept, a change within the same timestamp would go unnoticed
+#define DAEMON_QUERIES 64   //compiled queries -daemon keeps for clients sending the same arguments again
+#define DAEMON_TTL_SEC 60   //after this long -daemon looks user and group names up again and compiles queries again
+#define DAEMON_REQUEST_MAX (1024 * 1024)   //bytes of the arguments of one query at most
+#define DAEMON_TIMEOUT_SEC 5    //how long -daemon waits for a client to send its query
+#define DAEMON_POLL_MS 100  //how often -daemon looks whether the client of a running query went away
+#define DAEMON_MAGIC 0x31514446u    //"FDQ1", first word of a query sent to -daemon
+#define STATS_SAMPLE 16     //-stats times one evaluation of a primary in this many, they are all counted
+#define NSEC_PER_SEC 1000000000LL
+#define EXEC_HEADROOM 2048  //bytes of the argument area of a command left unused by -exec ... +
+#define ORDER_FIRST 256     //evaluations of a reordered -a or -o before its order is revised the first time
+#define ORDER_MAX (1024 * 1024) //evaluations between two revisions at most, the interval grows until then
+#define INDEX_MASK (STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | STATX_SIZE | STATX_MTIME)    //stat fields kept in an index
+
+/**
+ * kinds of nodes in the compiled expression tree
+ */
+enum expr_kind {
+    EXPR_AND,       //all children have to match (-a or juxtaposition)
+    EXPR_OR,        //one child has to match (-o)
+    EXPR_NOT,       //negates its only child (! or -not)
+    EXPR_NAME,      //-name, -iname
+    EXPR_PATH,      //-path, -ipath
+    EXPR_NAME_FROM, //-name-from
+    EXPR_PATH_FROM, //-path-from
+    EXPR_REGEX,     //-regex, -iregex
+    EXPR_CONTAINS,  //-contains, -contains-from
+    EXPR_TYPE,      //-type
+    EXPR_USER,      //-user
+    EXPR_GROUP,     //-group
+    EXPR_NOUSER,    //-nouser
+    EXPR_NOGROUP,   //-nogroup
+    EXPR_SIZE,      //-size
+    EXPR_TIME,      //-atime, -ctime, -mtime, -amin, -cmin, -mmin, -newer
+    EXPR_PERM,      //-perm
+    EXPR_INUM,      //-inum
+    EXPR_LINKS,     //-links
+    EXPR_EMPTY,     //-empty
+    EXPR_PRINT,     //-print, -print0, -fprint
+    EXPR_LS,        //-ls
+    EXPR_PRINTF,    //-printf, -fprintf
+    EXPR_PRUNE,     //-prune
+    EXPR_EXEC,      //-exec, -execdir
+    EXPR_TRUE       //placeholder for options like -j, always matches
+};
+
+/**
+ * how a compiled -name or -path pattern is matched
+ */
+enum match_kind {
+    MATCH_EXACT,    //no wildcards: "core"
+    MATCH_PREFIX,   //"lit*"
+    MATCH_SUFFIX,   //"*lit"
+    MATCH_CONTAINS, //"*lit*", also "*" with an empty literal
+    MATCH_GLOB      //everything else goes to fnmatch
+};
+
+/**
+ * a pattern classified once while parsing
+ */
+struct pattern {
+    enum match_kind kind;
+    const char *glob;       //the pattern as given, for fnmatch
+    char *lit;              //the literal part, lower case for -iname and -ipath
+    size_t litlen;
+    int icase;              //1 for -iname and -ipath
+};
+
+/**
+ * one node of a byte trie, children are kept in sibling lists
+ * except for the root, which has a full table
+ */
+struct trie_node {
+    int child;          //first child, 0 if none
+    int sibling;        //next child of the parent, 0 if none
+    unsigned char byte;
+    char term;          //a literal ends here (or, after linking, at a suffix of it)
+    int fail;           //Aho-Corasick failure link
+    int dict;           //nearest node on the failure chain that has globs
+    int globs;          //first entry in the glob list of the set, -1 if none
+};
+
+struct trie {
+    struct trie_node *nodes;    //nodes[0] is the root
+    size_t count;
+    size_t cap;
+    int root[256];
+};
+
+/**
+ * a set of patterns of -name-from or -path-from, matched in one pass per item
+ *
+ * Literals go to a hash set, lit* to a trie, *lit to a trie of the reversed
+ * literals and *lit* to an Aho-Corasick automaton. Other globs are keyed in
+ * the same automaton by their longest literal run and only handed to fnmatch
+ * when that run occurs; globs without any literal are always tried.
+ */
+struct patset {
+    char **exact;           //open addressing, NULL marks a free slot
+    size_t nexact;
+    size_t exact_cap;
+    struct trie prefix;
+    struct trie suffix;
+    struct trie contains;
+    const char **globs;     //globs handed to fnmatch
+    size_t nglobs;
+    int *glob_next;         //glob list entries of the automaton: glob index and next entry
+    int *glob_of;
+    size_t nglob_links;
+    size_t *always;         //globs without a literal run
+    size_t nalways;
+    int match_all;          //the set contains "*"
+};
+
+/**
+ * the strings of -contains or -contains-from, a file matches if it contains any of them
+ */
+struct needles {
+    char *str;              //the only string, searched with search_string
+    size_t len;
+    struct trie trie;       //Aho-Corasick automaton if there are several, NULL nodes otherwise
+    size_t count;           //0 for an empty -contains-from, nothing matches
+    size_t maxlen;          //longest string, at least 1; blocks overlap by one byte less
+    int match_all;          //the empty string, every text file with a byte matches
+};
+
+/**
+ * 256 bits, one per byte value
+ */
+struct rx_set {
+    uint64_t bits[4];
+};
+
+/**
+ * operations of the NFA of a -regex
+ */
+enum nfa_op {
+    NFA_SET,        //consumes a byte of the set, then goes on to out
+    NFA_SPLIT,      //goes on to out and out1
+    NFA_BOL,        //goes on to out before the first byte only
+    NFA_EOL,        //goes on to out after the last byte only
+    NFA_MATCH       //the path matches if it ends here
+};
+
+struct nfa_state {
+    enum nfa_op op;
+    int set;                //NFA_SET: index of the byte set
+    int out;
+    int out1;
+};
+
+/**
+ * a -regex or -iregex compiled once while parsing, POSIX extended syntax matched against the whole path
+ *
+ * The NFA is turned into a DFA lazily by every walker on its own (struct dfa). Before it runs,
+ * the path is checked for the literals every match contains. regcomp checks the syntax and
+ * matches what the NFA does not cover: equivalence classes, back references, word boundaries,
+ * multibyte locales and very large expressions.
+ */
+struct regex {
+    size_t index;           //index of its DFA in the walkers
+    int icase;              //1 for -iregex, the literals are in lower case
+    struct nfa_state *nfa;  //NULL if regexec matches it
+    int nnfa;
+    int start;
+    struct rx_set *sets;    //the byte sets of the NFA
+    size_t nsets;
+    unsigned char classes[256]; //bytes none of the sets tells apart share a class
+    unsigned char rep[256];     //one byte of each class
+    int nclasses;
+    char prefix[REGEX_LIT_MAX + 1];     //every match starts with it
+    size_t prefixlen;
+    char suffix[REGEX_LIT_MAX + 1];     //and ends with it
+    size_t suffixlen;
+    char required[REGEX_LIT_MAX + 1];   //and contains it, searched with memmem
+    size_t requiredlen;
+    int exact;              //1 if the prefix is the only string that matches
+    regex_t compiled;       //from regcomp
+};
+
+/**
+ * the DFA of a -regex in one walker, states are added as the paths need them
+ *
+ * A state is the set of NFA_SET states the bytes so far may have reached. State 0 is the dead
+ * state without any, the walk of the path stops there.
+ */
+struct dfa {
+    int *next;              //nclasses transitions per state, -1 until the first byte of that class arrived
+    char *accept;           //1 if the path matches when it ends in this state
+    size_t *off;            //NFA states of state s are sets[off[s]] up to sets[off[s + 1]]
+    int *sets;
+    size_t sets_cap;
+    int nstates;
+    int start;
+    int *table;             //hash of the states by their NFA states, state + 1, 0 for a free slot
+    int *work;              //NFA states of the state being built
+    int nwork;
+    int *keep;              //the same while the cache starts over
+    int *stack;
+    unsigned *mark;         //two per NFA state, equal to gen once reached during this step
+    unsigned gen;
+};
+
+/**
+ * nodes of the syntax tree of a -regex, only kept while it is compiled
+ */
+enum rx_kind {
+    RX_EMPTY,       //matches the empty string
+    RX_SET,         //one byte of a set
+    RX_BOL,         //^
+    RX_EOL,         //$
+    RX_CAT,         //left, then right
+    RX_ALT,         //left or right
+    RX_REPEAT       //left min to max times
+};
+
+struct rx_node {
+    enum rx_kind kind;
+    int left;               //children, indexes into the nodes of the parser
+    int right;
+    int set;                //RX_SET: index of the byte set
+    int min;
+    int max;                //-1 for no limit
+};
+
+/**
+ * state of the parser of a -regex
+ */
+struct rx_parser {
+    const char *s;          //next character of the expression
+    struct regex *re;       //receives the byte sets
+    int icase;
+    struct rx_node *nodes;
+    int nnodes;
+    int cap;
+    int depth;              //open parentheses
+};
+
+/**
+ * literals of a part of a -regex, see rx_literals
+ */
+struct rx_lit {
+    int exact;              //1 if the part only matches prefix
+    int fixed;              //the same, but it may contain anchors
+    char prefix[REGEX_LIT_MAX + 1];
+    size_t prefixlen;
+    char suffix[REGEX_LIT_MAX + 1];
+    size_t suffixlen;
+    char required[REGEX_LIT_MAX + 1];
+    size_t requiredlen;
+};
+
+/**
+ * one node of the compiled expression, the arguments are already converted
+ * so evaluating a node does not touch argv anymore
+ */
+struct expr {
+    enum expr_kind kind;
+    struct expr **kids;     //children of -a, -o and !
+    size_t nkids;
+    int id;                 //index of the counters of -stats, -1 for operators and options
+    char *label;            //the primary and its argument as given, for -stats
+    int pure;               //1 if evaluating the node has no side effect, no action is below it
+    double cost;            //estimated cost of one evaluation, stat calls dominate
+    double pass;            //estimated share of the items that match
+    int group;              //index of the evaluation order in the walkers for -a and -o whose children are reordered, -1 otherwise
+    union {
+        struct pattern *pat;    //-name, -path, -iname, -ipath
+        struct patset *set;     //-name-from, -path-from
+        struct regex *regex;    //-regex, -iregex
+        struct needles *needles;    //-contains, -contains-from
+        mode_t type;            //-type as S_IFMT value
+        uid_t uid;              //-user, resolved while parsing
+        gid_t gid;              //-group, resolved while parsing
+        struct {
+            int64_t lo;         //the value of the item has to be in [lo, hi], times in nanoseconds
+            int64_t hi;
+            int64_t unit;       //-size: bytes per unit, sizes are rounded up to whole units
+            char field;         //time of -atime ... -mmin and -newer: 'a', 'c' or 'm'
+        } range;                //-size, -atime ... -mmin, -newer, -inum, -links
+        struct {
+            mode_t mode;
+            char how;           //'\0' for exactly these bits, '-' for all of them, '/' for any of them
+        } perm;                 //-perm
+        struct {
+            size_t out;         //index of the output in the plan
+            char term;          //terminator of the name, '\n' or '\0' for -print0
+        } print;                //-print, -print0, -fprint, -ls
+        struct {
+            size_t out;
+            struct format *fmt;
+        } printf;               //-printf, -fprintf
+        struct exec *exec;      //-exec, -execdir
+    } arg;
+};
+
+/**
+ * one step of a compiled -printf format: literal text or a directive
+ */
+struct fmt_op {
+    char conv;              //the directive letter, '\0' for literal text
+    char time;              //conversion of %A, %C and %T
+    int left;               //1 for the - flag, the value is padded on the right
+    int alt;                //1 for the # flag, %#m writes the mode with a leading 0
+    int width;              //0 if none was given
+    int prec;               //-1 if none was given, cuts the value to this many bytes
+    const char *text;       //literal text with the escapes resolved
+    size_t len;
+};
+
+/**
+ * a -printf format compiled once while parsing
+ */
+struct format {
+    struct fmt_op *ops;
+    size_t nops;
+    int stop;               //1 if the format ended with \c, the output is flushed after the record
+    unsigned int stat_mask; //STATX_* fields the directives read
+    char *text;             //the literal text of all steps
+};
+
+/**
+ * layouts of the records -print writes (-format)
+ */
+enum record_format {
+    FORMAT_TEXT,    //the path and a newline, or a null byte for -print0
+    FORMAT_NDJSON,  //one JSON object per line
+    FORMAT_CSV,     //RFC 4180 with a header line
+    FORMAT_BIN      //struct bin_header, then a struct bin_record and the path per item
+};
+
+/**
+ * start of the stream of -format bin, numbers are in native byte order
+ */
+struct bin_header {
+    char magic[8];          //BIN_MAGIC
+    uint32_t version;       //BIN_VERSION
+    uint32_t record;        //size of struct bin_record, the path follows it
+};
+
+/**
+ * one item of -format bin, followed by the path and zero bytes up to a multiple of 8
+ */
+struct bin_record {
+    uint32_t len;           //bytes of the record including the path and the padding
+    uint32_t pathlen;
+    uint32_t mode;
+    uint32_t uid;
+    uint32_t gid;
+    uint32_t nlink;
+    uint64_t size;
+    int64_t mtime;          //nanoseconds since the epoch
+    uint64_t ino;
+};
+
+/**
+ * the command of -exec or -execdir
+ */
+struct exec {
+    char **argv;            //the command as given up to ";" or "+", points into the arguments of the program
+    size_t argc;
+    int batch;              //1 for the "+" form, the items take the place of the last argument "{}"
+    int dir;                //1 for -execdir, the command runs in the directory of the item on ./name
+    size_t index;           //index of the batch in the walkers, "+" form only
+};
+
+/**
+ * the items a walker collected for one -exec ... + until they are handed to the command
+ */
+struct execbatch {
+    char **args;            //owned copies of the paths
+    size_t nargs;
+    size_t cap;
+    size_t bytes;           //room the command and the items take in the argument area
+    char *dir;              //directory all items are in with -execdir, owned
+};
+
+/**
+ * a file the actions write to, stdout is always the first one
+ */
+struct output {
+    const char *name;       //file name of -fprint, NULL for stdout
+    int fd;
+    int is_tty;             //terminals get every record right away
+    int records;            //1 if -print writes to it, it gets the header of -format csv and bin
+    pthread_mutex_t lock;   //the workers of -j write their buffers one at a time
+};
+
+/**
+ * the order of the results (-sort)
+ */
+enum sort_key {
+    SORT_NONE,      //as the walk finds them
+    SORT_NAME,      //by name within each directory, the items of a directory before those of its subdirectories
+    SORT_SIZE,      //by size, equal sizes like SORT_NAME
+    SORT_MTIME      //by modification time, equal times like SORT_NAME
+};
+
+/**
+ * the compiled command line: the start points and the expression evaluated for every entry
+ */
+struct plan {
+    char **paths;
+    size_t npaths;
+    struct expr *root;
+    unsigned int stat_mask;     //STATX_* fields the predicates and actions read
+    int jobs;                   //number of threads walking the tree (-j)
+    int uring;                  //1 if the stat data may be fetched in batches through io_uring (-uring)
+    int stat_always;            //1 if the expression needs the stat data of every entry
+    size_t dirbuf_size;         //size of the getdents64 buffer (-dirbuf)
+    int fd_budget;              //directories a walker keeps open at most (-fd-budget)
+    int bfs;                    //1 to read the tree level by level (-order bfs)
+    int maxdepth;               //directories at this depth are not read (-maxdepth)
+    int mindepth;               //items above this depth are not checked (-mindepth)
+    int xdev;                   //1 to stay on the file system of the start point (-xdev)
+    struct patset *skip;        //names of directories that are neither checked nor read (-skip-dir)
+    const char *index_out;      //index file to write instead of searching (-build-index)
+    const char *db;             //index file searched instead of the file system (-db)
+    struct watch *watch;        //set if changes are reported after the walk (-watch)
+    int stats;                  //1 to print statistics at the end (-stats), 2 as JSON (-stats-json)
+    struct expr **nodes;        //the primaries in the order given, indexed by their id
+    size_t nnodes;
+    struct expr **exprs;        //every node the parser allocated, also those an error left unlinked, plan_free releases them
+    size_t nexprs;
+    int reorder;                //0 keeps the order given, 1 sorts by the estimates, 2 also by measured pass rates (-reorder)
+    size_t nregexes;            //-regex and -iregex, each has a DFA in the walkers
+    int contains;               //1 if the expression reads file contents (-contains, -contains-from)
+    int contains_jobs;          //threads the walkers hand those files to, 0 to read them in the walkers (-contains-jobs)
+    size_t contains_max;        //bytes of a file searched at most (-contains-max)
+    enum sort_key sort;         //order of the results (-sort)
+    size_t sort_mem;            //bytes of results kept in memory while sorting (-sort-mem)
+    const char *daemon;         //socket queries are served on instead of walking (-daemon)
+    size_t daemon_cache;        //bytes of directory listings the daemon keeps (-daemon-cache)
+    int reusable;               //0 if compiling the arguments again could give another plan, -daemon does not keep it
+    struct expr **groups;       //the -a and -o nodes reordered during the walk, indexed by their group
+    size_t ngroups;
+    struct exec **execs;        //the "+" forms of -exec and -execdir, indexed by their batch
+    size_t nexecs;
+    int exec_jobs;              //commands of -exec ... + running at once at most (-exec-jobs)
+    size_t arg_max;             //bytes of arguments a command may get, without the environment
+    enum record_format format;  //layout of the records of -print (-format)
+    struct output *outputs;     //stdout and the files of -fprint
+    size_t noutputs;
+    int default_path;           //1 if the current directory is searched because no start point was given
+    struct sink *sink;          //receives the items of -print instead of stdout during find_walk and iterators
+};
+
+/**
+ * an item visited during the walk, the stat data is only fetched if a predicate needs it
+ */
+struct find_entry {
+    const char *path;       //whole path of the item
+    int dirfd;              //directory the item is looked up in, AT_FDCWD for start points
+    const char *name;       //name of the item relative to dirfd
+    unsigned char d_type;   //DT_* value reported by getdents64, DT_UNKNOWN if not known
+    unsigned int stat_mask; //STATX_* fields to request when the stat data is needed
+    int have_stat;          //1 once st is filled, -1 if the stat call failed
+    struct stat st;
+    int depth;              //0 for start points
+    int prune;              //set by -prune, the directory is not read
+};
+
+/**
+ * growable buffer holding the path of the current item, names are appended
+ * when descending and cut off again when returning
+ */
+struct pathbuf {
+    char *buf;
+    size_t len;
+    size_t cap;
+};
+
+/**
+ * a compiled query of the library
+ */
+struct find_query {
+    struct plan plan;
+    char **argv;                //the command line built by find_compile_spec, NULL for find_compile
+};
+
+/**
+ * where find_walk and the iterators deliver the items -print writes to stdout otherwise
+ */
+struct sink {
+    find_callback callback;     //NULL for an iterator
+    void *arg;
+    struct find_iter *iter;
+    atomic_int stop;            //set once the callback returned nonzero or the iterator is closed
+};
+
+/**
+ * results a walker collected for the reader of an iterator, the paths are copies
+ */
+struct iter_batch {
+    struct iter_batch *next;
+    struct find_entry items[ITER_BATCH];
+    size_t off[ITER_BATCH];     //offsets of the paths, the pointers are set when the batch is handed over
+    size_t count;
+    struct pathbuf paths;       //the paths one after the other, each with its null byte
+};
+
+/**
+ * a walk running on a thread of its own, its walkers hand the results over in batches
+ */
+struct find_iter {
+    struct find_query *query;
+    struct sink sink;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        //a batch was filled, given back, or the walk ended
+    struct iter_batch *full;    //batches waiting for the reader, the oldest first
+    struct iter_batch *last;
+    struct iter_batch *spare;   //batches the reader gave back
+    struct iter_batch *cur;     //batch the reader is at
+    size_t pos;                 //next item of cur
+    size_t nbatches;            //batches allocated
+    int done;                   //1 once the walk ended
+    int status;                 //its exit status
+};
+
+/**
+ * a directory waiting to be read in the parallel walk
+ */
+struct task {
+    char *path;             //whole path, owned by the task
+    int depth;              //depth of the directory
+    dev_t dev;              //device of its start point, for -xdev
+    const char *root;       //its start point, for %P and %H of -printf
+};
+
+/**
+ * a name of the directory being read for -sort name, its leading bytes are packed next to
+ * its offset so most comparisons do not look at the names
+ */
+struct nameref {
+    uint64_t prefix;        //first 8 bytes of the name, big endian, padded with null bytes
+    size_t off;             //offset of the name in the names buffer
+    unsigned char d_type;
+};
+
+/**
+ * a directory read as a whole for -sort name, its items are checked once they are sorted
+ */
+struct dirsort {
+    struct pathbuf names;   //the names one after the other, each with its null byte
+    struct nameref *refs;
+    size_t count;
+    size_t cap;
+};
+
+/**
+ * header of a result collected for -sort, followed by its path with the null byte, the text
+ * it wrote to stdout and the items it handed to the sink
+ */
+struct sortrec {
+    uint64_t key;           //size, or modification time with the sign bit flipped, 0 for -sort name
+    uint32_t root;          //index of its start point, they keep the order given
+    uint32_t rel;           //offset of the path below the start point
+    uint32_t pathlen;
+    uint32_t textlen;
+    uint32_t emitlen;       //bytes of copies of find_entry, their path is the one of the record
+    uint32_t pad;
+};
+
+/**
+ * a result in the sort buffer of a walker, the key is packed next to the offset of its record
+ */
+struct sortref {
+    uint64_t key;
+    size_t off;             //offset of the record, aligned for its header
+};
+
+/**
+ * results a walker collected for -sort, written as a sorted run once its share of -sort-mem is used
+ */
+struct sortbuf {
+    struct pathbuf recs;    //the records one after the other
+    struct sortref *refs;
+    size_t count;
+    size_t cap;
+    struct pathbuf emits;   //items the current result handed to the sink
+    const char *root;       //start point of the last result
+    uint32_t rootidx;       //its index
+    size_t rootlen;         //its length without trailing slashes
+};
+
+/**
+ * a sorted run of results, in a temporary file or still in memory
+ */
+struct sortrun {
+    FILE *fp;               //NULL for a run in memory
+    struct sortbuf mem;
+    size_t pos;             //next result of a run in memory
+    struct sortrec *head;   //the current result, NULL once the run is used up
+    struct pathbuf rec;     //the current result read from the file
+};
+
+/**
+ * the runs of the walkers of a walk with -sort, merged once the walk ended
+ */
+struct sorter {
+    enum sort_key key;
+    size_t share;           //bytes of results a walker keeps before it writes a run
+    pthread_mutex_t lock;   //walkers hand their runs over one at a time
+    struct sortrun *runs;
+    size_t nruns;
+    size_t cap;
+};
+
+/**
+ * the listing of a directory kept by -daemon, valid while the directory keeps its times
+ */
+struct dirlist {
+    struct dirlist *next;       //in its hash chain
+    struct dirlist *older;      //in the order of use, the oldest is dropped when the cache is full
+    struct dirlist *newer;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    struct timespec ctime;
+    char *recs;                 //the getdents64 records of the directory
+    size_t len;
+};
+
+/**
+ * directory listings of -daemon, shared by the walkers of all queries
+ */
+struct dircache {
+    struct dirlist **chains;
+    size_t nchains;             //power of two
+    size_t count;
+    size_t bytes;               //held by the listings
+    size_t budget;              //above it the least recently used listings are dropped
+    struct dirlist *oldest;
+    struct dirlist *newest;
+    pthread_mutex_t lock;
+};
+
+/**
+ * a compiled query -daemon keeps for clients sending the same arguments again
+ */
+struct daemon_query {
+    char *args;                 //the arguments as sent, each with its null byte, the plan points into them
+    size_t len;
+    char **argv;
+    struct find_query *query;
+    time_t compiled;            //it is compiled again DAEMON_TTL_SEC later
+    uint64_t used;              //the least recently used one is replaced
+};
+
+/**
+ * first bytes of a query sent to -daemon, the arguments follow, each with its null byte;
+ * stdout, stderr and the working directory of the client come along as descriptors
+ */
+struct daemon_request {
+    uint32_t magic;
+    uint32_t len;               //bytes of the arguments
+};
+
+/**
+ * a regular file handed to the readers of -contains, the expression is evaluated on it again
+ */
+struct readtask {
+    char *path;             //whole path, owned by the task
+    int depth;
+    unsigned char d_type;
+    unsigned int stat_mask;
+    int have_stat;
+    struct stat st;         //copied if have_stat is 1
+    const char *root;       //its start point, for %P and %H of -printf
+};
+
+/**
+ * a thread reading the files of -contains with a walker of its own for the output
+ */
+struct reader {
+    struct walker *w;
+    struct readpool *pool;
+    pthread_t thread;
+};
+
+/**
+ * the files of -contains waiting to be read while the walk goes on (-contains-jobs)
+ */
+struct readpool {
+    struct readtask items[READ_QUEUE];  //ring buffer
+    size_t head;
+    size_t count;
+    int done;               //set once the walk ended, the readers leave when the ring is empty
+    pthread_mutex_t lock;
+    pthread_cond_t more;    //a task was queued or the walk ended
+    pthread_cond_t room;    //a task was taken
+    struct reader *readers;
+    struct walker *walkers;
+    int nreaders;
+};
+
+/**
+ * double ended queue of directories waiting to be read, the owning worker
+ * takes from the bottom, idle workers steal from the top
+ */
+struct deque {
+    pthread_mutex_t lock;
+    struct task *items;
+    size_t head;            //index of the top item
+    size_t count;
+    size_t cap;
+};
+
+/**
+ * shared state of the parallel walk (-j)
+ */
+struct pool {
+    struct deque *deques;   //one per worker
+    int nworkers;
+    atomic_long pending;    //directories queued or being read, the walk ends at 0
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    int idle;               //number of workers waiting for work
+};
+
+/**
+ * an io_uring instance set up with the raw system calls, the rings are shared with the kernel
+ */
+struct uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_len;
+    void *cq_ring;
+    size_t cq_ring_len;
+    size_t sqes_len;
+    int broken;             //1 once a request failed in a way a retry would not fix, the walker stats synchronously then
+};
+
+/**
+ * entries of one directory whose statx requests are submitted together,
+ * the names point into the getdents64 buffer
+ */
+struct batch {
+    struct statx stx[URING_BATCH];
+    const char *name[URING_BATCH];
+    unsigned char d_type[URING_BATCH];
+    unsigned char finished[URING_BATCH];    //1 once the completion of the entry arrived and it was checked
+    size_t count;
+};
+
+/**
+ * names of subdirectories waiting to be read, each directory pushes the names
+ * found in it on top and pops them once they are read
+ */
+struct namestack {
+    char *buf;
+    size_t len;
+    size_t cap;
+};
+
+/**
+ * a directory on the stack of the walk, its descriptor may have been given back to stay
+ * within the budget, it is opened again from its path when its next subdirectory is read
+ */
+struct frame {
+    int fd;                 //-1 while closed
+    int depth;
+    size_t pathlen;         //length of its path in the path buffer
+    size_t base;            //offset of its subdirectory names on the name stack
+    size_t next;            //offset of the next name to read
+    size_t end;             //offset behind its last name
+    dev_t dev;              //identity checked when it is opened again
+    ino_t ino;
+    uint32_t child;         //-build-index: record of the next subdirectory to read
+};
+
+/**
+ * records collected for one output, only whole records are written
+ */
+struct outbuf {
+    char *buf;
+    size_t len;
+    size_t cap;
+};
+
+/**
+ * counters of one walker for -stats, times are in ticks of stats_ticks()
+ */
+struct stats {
+    uint64_t dirs;          //directories opened
+    uint64_t reopens;       //opened again after giving their descriptor back
+    uint64_t cached;        //listed from the cache of -daemon, without getdents64
+    uint64_t entries;       //items checked
+    uint64_t getdents;      //getdents64 calls
+    uint64_t getdents_ticks;
+    uint64_t stats;         //statx or fstatat calls
+    uint64_t stat_ticks;
+    uint64_t batched;       //statx requests sent through io_uring
+    uint64_t nss;           //user and group lookups that missed the caches
+    uint64_t nss_ticks;
+    uint64_t writes;        //write calls of the outputs
+    uint64_t write_bytes;
+    uint64_t write_ticks;
+    uint64_t execs;         //commands started by -exec and -execdir
+    uint64_t exec_ticks;    //spent starting them, and waiting for the ";" form
+    uint64_t reads;         //files opened by -contains
+    uint64_t read_bytes;
+    uint64_t read_ticks;
+    uint64_t *evals;        //per primary, indexed by its id
+    uint64_t *passes;
+    uint64_t *ticks;        //including the stat calls and lookups the primary caused
+    uint64_t *timed;        //evaluations that were timed
+};
+
+/**
+ * the order a walker evaluates the children of a reordered -a or -o in, revised from the
+ * pass rates it measures
+ */
+struct order {
+    size_t *perm;           //children in evaluation order, children with side effects keep their place
+    uint64_t *evals;        //per child, halved at every revision so old rates fade
+    uint64_t *passes;
+    double *key;            //scratch space of the revision
+    uint64_t count;         //evaluations of the node
+    uint64_t next;          //count at which the order is revised next
+};
+
+/**
+ * per thread state of a walk
+ */
+struct walker {
+    const struct plan *plan;
+    struct pathbuf pb;      //path of the current item
+    struct pool *pool;      //NULL for the sequential walk
+    int id;                 //index of the own deque in the pool
+    struct uring *ring;     //set up on first use if -uring is given
+    struct batch *batch;
+    char *dirbuf;           //getdents64 buffer, reused for every directory
+    struct namestack pending;
+    struct frame *frames;   //directories being read, the innermost last
+    size_t nframes;
+    size_t cap_frames;
+    size_t open_fds;        //frames holding a descriptor
+    size_t low_fd;          //the frames below this one are all closed
+    struct deque bfs;       //directories queued in breadth first order, the lock is not used
+    int depth;              //depth of the items in the directory being read
+    dev_t dev;              //device of the current start point, for -xdev
+    const char *root;       //the current start point as given, NULL while -watch reports changes
+    struct timespec since;  //during rescans of -watch only items changed after this are checked
+    struct outbuf *out;     //one buffer per output of the plan
+    struct stats *stats;    //NULL without -stats
+    struct order *orders;   //one per group of the plan
+    struct execbatch *batches;  //one per "+" form of -exec of the plan
+    struct dfa *dfas;       //one per -regex of the plan
+    struct readpool *reads; //set if -contains hands its files to the readers
+    int effects;            //an action ran for the current item, -contains reads it right away then
+    int deferred;           //the current item went to the readers, the rest of its evaluation is skipped
+    int replay;             //a reader evaluates the tests in front of -contains again, -stats counted them already
+    char *readbuf;          //block of a file read by -contains
+    size_t readcap;
+    struct sorter *sort;    //set if the results are collected for -sort instead of written right away
+    struct sortbuf sorted;  //and those collected by this walker
+    struct dirsort *dirsort;    //set if each directory is read as a whole and checked in name order (-sort name)
+    struct pathbuf listing; //getdents64 records of the directory being read, for the cache of -daemon
+    time_t ls_minute;       //minute of the last date formatted by -ls
+    char ls_date[16];       //and its text, neighbouring files mostly share it
+    struct pathbuf line;    //record of -printf being put together
+    time_t fmt_minute;      //minute of the last time formatted by -printf
+    struct tm fmt_tm;       //and its broken down form
+    struct iter_batch *emit;    //results collected for an iterator, NULL if none
+};
+
+/**
+ * packed columns of an index file, one value per record
+ */
+enum index_col {
+    COL_MODE,       //uint32_t st_mode
+    COL_UID,        //uint32_t
+    COL_GID,        //uint32_t
+    COL_DEPTH,      //uint32_t, 0 for the start points
+    COL_PARENT,     //uint32_t record of the directory, INDEX_NONE for start points
+    COL_FIRST,      //uint32_t first record inside a directory, the records of one directory are contiguous
+    COL_SIZE,       //uint64_t
+    COL_MTIME,      //uint64_t nanoseconds since the epoch
+    COL_DEV,        //uint64_t
+    INDEX_NCOLS
+};
+
+/**
+ * header of an index file written by -build-index, numbers are in native byte order
+ *
+ * The paths are front coded: each record holds the number of bytes it shares with the
+ * previous path and the rest of it, both lengths as LEB128. Every INDEX_RESTART records
+ * the whole path is stored, so a record can be decoded without starting at the beginning.
+ */
+struct index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t restart;           //records between two whole paths
+    uint64_t count;
+    uint64_t paths_off;
+    uint64_t paths_len;
+    uint64_t restarts_off;      //uint64_t offset into the paths of every whole path
+    uint64_t col_off[INDEX_NCOLS];
+    uint64_t built;             //nanoseconds since the epoch when the build started
+};
+
+/**
+ * one record while the index is built
+ */
+struct index_rec {
+    uint32_t mode;
+    uint32_t uid;
+    uint32_t gid;
+    uint32_t depth;
+    uint32_t parent;
+    uint32_t first;
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t dev;
+    uint64_t ctime;         //nanoseconds since the epoch, not written, only directories that were stat'ed have it
+};
+
+/**
+ * slot of the table from directory path to record, used to find unchanged directories
+ */
+struct index_slot {
+    uint64_t hash;
+    uint32_t rec;           //INDEX_NONE marks a free slot
+};
+
+/**
+ * a mapped index file
+ */
+struct index {
+    void *map;
+    size_t len;
+    size_t count;
+    size_t restart;
+    const unsigned char *paths;
+    size_t paths_len;
+    const uint64_t *restarts;
+    uint64_t built;                     //nanoseconds since the epoch when the build started
+    const uint32_t *u32[COL_SIZE];      //the uint32_t columns
+    const uint64_t *u64[INDEX_NCOLS - COL_SIZE];    //the uint64_t columns, from COL_SIZE on
+    struct index_slot *dirs;            //built on demand for incremental refreshes
+    size_t dirs_cap;
+};
+
+/**
+ * position while decoding the paths of an index
+ */
+struct index_cursor {
+    const struct index *ix;
+    size_t rec;             //record decoded next
+    size_t off;             //its offset in the paths
+    struct pathbuf path;    //path of the record decoded last
+};
+
+/**
+ * state of -build-index
+ */
+struct index_build {
+    const struct plan *plan;
+    FILE *fp;               //the new index, written under a temporary name
+    char *tmpname;
+    struct index_rec *recs;
+    size_t count;
+    size_t cap;
+    uint64_t *restarts;
+    uint64_t paths_len;
+    struct pathbuf prev;    //path of the last record, the next one is coded against it
+    struct index *old;      //the previous index, NULL for a full build
+    struct index_cursor cur;
+    uint64_t built;         //nanoseconds since the epoch when the build started
+    struct walker w;        //its path buffer, name stack and directory stack with the descriptor budget of the walk
+    dev_t dev;              //device of the current start point, for -xdev
+};
+
+/**
+ * a directory under watch, or a subtree that is rescanned because no watch was left for it
+ */
+struct watch_dir {
+    char *path;             //whole path, NULL for a free slot
+    int depth;
+    dev_t dev;              //device of its start point, for -xdev
+};
+
+/**
+ * state of -watch
+ */
+struct watch {
+    int fd;                 //inotify descriptor
+    pthread_mutex_t lock;   //the workers of -j add watches during the first walk
+    struct watch_dir *dirs; //indexed by watch descriptor
+    size_t cap;
+    struct watch_dir *rescan;   //subtrees that could not be watched
+    size_t nrescan;
+    struct timespec since;  //start of the last rescan
+};
+
+/**
+ * hash table from user or group id to name
+ */
+struct idcache_slot {
+    unsigned int id;
+    int used;
+    const char *name;       //NULL if the id has no entry in the database
+};
+
+struct idcache {
+    struct idcache_slot *slots;
+    size_t cap;             //power of two
+    size_t count;
+};
+
+/**
+ * table of the primaries known to the parser
+ */
+struct primary {
+    const char *name;
+    enum expr_kind kind;
+    int has_arg;
+    unsigned int stat_mask;     //STATX_* fields the primary reads
+};
+
+static const struct primary primaries[] = {
+    {"-nogroup", EXPR_NOGROUP, 0, STATX_GID},
+    {"-group",   EXPR_GROUP,   1, STATX_GID},
+    {"-nouser",  EXPR_NOUSER,  0, STATX_UID},
+    {"-user",    EXPR_USER,    1, STATX_UID},
+    {"-size",    EXPR_SIZE,    1, STATX_SIZE},
+    {"-atime",   EXPR_TIME,    1, STATX_ATIME},
+    {"-ctime",   EXPR_TIME,    1, STATX_CTIME},
+    {"-mtime",   EXPR_TIME,    1, STATX_MTIME},
+    {"-amin",    EXPR_TIME,    1, STATX_ATIME},
+    {"-cmin",    EXPR_TIME,    1, STATX_CTIME},
+    {"-mmin",    EXPR_TIME,    1, STATX_MTIME},
+    {"-newer",   EXPR_TIME,    1, STATX_MTIME},
+    {"-perm",    EXPR_PERM,    1, STATX_MODE},
+    {"-inum",    EXPR_INUM,    1, STATX_INO},
+    {"-links",   EXPR_LINKS,   1, STATX_NLINK},
+    {"-empty",   EXPR_EMPTY,   0, STATX_SIZE},
+    {"-name",    EXPR_NAME,    1, 0},
+    {"-iname",   EXPR_NAME,    1, 0},
+    {"-type",    EXPR_TYPE,    1, STATX_TYPE},
+    {"-path",    EXPR_PATH,    1, 0},
+    {"-ipath",   EXPR_PATH,    1, 0},
+    {"-name-from", EXPR_NAME_FROM, 1, 0},
+    {"-path-from", EXPR_PATH_FROM, 1, 0},
+    {"-regex",   EXPR_REGEX,   1, 0},
+    {"-iregex",  EXPR_REGEX,   1, 0},
+    {"-contains", EXPR_CONTAINS, 1, STATX_TYPE},
+    {"-contains-from", EXPR_CONTAINS, 1, STATX_TYPE},
+    {"-print",   EXPR_PRINT,   0, 0},
+    {"-print0",  EXPR_PRINT,   0, 0},
+    {"-fprint",  EXPR_PRINT,   1, 0},
+    {"-ls",      EXPR_LS,      0, STATX_BASIC_STATS},
+    {"-printf",  EXPR_PRINTF,  1, 0},		//the directives add their own fields
+    {"-fprintf", EXPR_PRINTF,  1, 0},		//the format follows the file
+    {"-prune",   EXPR_PRUNE,   0, 0},
+    {"-exec",    EXPR_EXEC,    0, 0},		//the command is read up to ";" or "{} +"
+    {"-execdir", EXPR_EXEC,    0, 0},
+};
+
+/**
+ * options that change how the walk is done instead of testing items,
+ * they may appear anywhere in the expression and always match
+ */
+enum option_kind {
+    OPT_JOBS,       //-j N
+    OPT_URING,      //-uring
+    OPT_DIRBUF,     //-dirbuf SIZE
+    OPT_MAXDEPTH,   //-maxdepth N
+    OPT_MINDEPTH,   //-mindepth N
+    OPT_XDEV,       //-xdev, -mount
+    OPT_SKIPDIR,    //-skip-dir GLOB
+    OPT_BUILD_INDEX,    //-build-index FILE
+    OPT_DB,         //-db FILE
+    OPT_WATCH,      //-watch
+    OPT_FD_BUDGET,  //-fd-budget N
+    OPT_ORDER,      //-order dfs|bfs
+    OPT_STATS,      //-stats
+    OPT_STATS_JSON, //-stats-json
+    OPT_REORDER,    //-reorder off|static|adaptive
+    OPT_EXEC_JOBS,  //-exec-jobs N
+    OPT_CONTAINS_JOBS,  //-contains-jobs N
+    OPT_CONTAINS_MAX,   //-contains-max SIZE
+    OPT_SORT,       //-sort name|size|mtime
+    OPT_SORT_MEM,   //-sort-mem SIZE
+    OPT_DAEMON,     //-daemon SOCKET
+    OPT_DAEMON_CACHE,   //-daemon-cache SIZE
+    OPT_FORMAT      //-format text|ndjson|csv|bin
+};
+
+struct option {
+    const char *name;
+    enum option_kind kind;
+    int has_arg;
+};
+
+static const struct option options[] = {
+    {"-j", OPT_JOBS, 1},
+    {"-uring", OPT_URING, 0},
+    {"-dirbuf", OPT_DIRBUF, 1},
+    {"-maxdepth", OPT_MAXDEPTH, 1},
+    {"-mindepth", OPT_MINDEPTH, 1},
+    {"-xdev", OPT_XDEV, 0},
+    {"-mount", OPT_XDEV, 0},
+    {"-skip-dir", OPT_SKIPDIR, 1},
+    {"-build-index", OPT_BUILD_INDEX, 1},
+    {"-db", OPT_DB, 1},
+    {"-watch", OPT_WATCH, 0},
+    {"-fd-budget", OPT_FD_BUDGET, 1},
+    {"-order", OPT_ORDER, 1},
+    {"-stats", OPT_STATS, 0},
+    {"-stats-json", OPT_STATS_JSON, 0},
+    {"-reorder", OPT_REORDER, 1},
+    {"-exec-jobs", OPT_EXEC_JOBS, 1},
+    {"-contains-jobs", OPT_CONTAINS_JOBS, 1},
+    {"-contains-max", OPT_CONTAINS_MAX, 1},
+    {"-sort", OPT_SORT, 1},
+    {"-sort-mem", OPT_SORT_MEM, 1},
+    {"-daemon", OPT_DAEMON, 1},
+    {"-daemon-cache", OPT_DAEMON_CACHE, 1},
+    {"-format", OPT_FORMAT, 1},
+};
+
+/**
+ * state of the recursive descent parser
+ */
+struct parser {
+    struct plan *plan;
+    char **args;
+    int pos;
+    int count;
+    int has_action;     //set if the expression contains an action like -print or -ls
+    unsigned int stat_mask;     //union of the STATX_* fields of the parsed primaries
+    int64_t now;                //start of the program in nanoseconds, ages are counted from it
+};
+
+/**
+ * caches of the user and group names of ids, ids without an entry are cached with a NULL name
+ */
+static struct idcache user_cache = {NULL, 0, 0};
+static struct idcache group_cache = {NULL, 0, 0};
+
+/**
+ * guards the caches, getpwuid and getgrgid return static buffers so the lookups are serialized as well
+ */
+static pthread_mutex_t nss_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * walkers whose buffered output is written by flush_at_exit if the program terminates early
+ */
+static struct walker *exit_walkers = NULL;
+static int exit_nwalkers = 0;
+
+/**
+ * commands of -exec ... + running in the background, the oldest first, at most plan->exec_jobs
+ */
+static pid_t *exec_pids = NULL;
+static size_t exec_running = 0;
+static size_t exec_cap = 0;
+static pthread_mutex_t exec_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * exit status of the program, 1 once a command of -exec ... + failed or one could not be started
+ */
+static atomic_int exit_status = 0;
+
+/**
+ * state of -daemon: the directory listings, and whether the running query has to end early
+ */
+static struct dircache *dir_cache = NULL;
+static int serving = 0;             //a query of -daemon is running, a failed write ends it instead of the program
+static atomic_int client_gone = 0;  //set when the client went away or an output of its query failed
+static const char *daemon_socket = NULL;    //socket of -daemon while it is bound, flush_at_exit removes it
+static int daemon_dir = AT_FDCWD;           //own working directory of -daemon, a query runs in the one of its client
+static volatile sig_atomic_t daemon_stop = 0;   //set by SIGINT and SIGTERM
+static int daemon_wake = -1;                     //write end of the pipe that wakes the loop of -daemon up for them
+
+/**
+ * set while find_compile runs on the thread, errors in the command line return from it with the message
+ */
+static _Thread_local jmp_buf *compile_env = NULL;
+static _Thread_local char *compile_msg = NULL;
+static _Thread_local size_t compile_msglen = 0;
+
+/**
+ * set once io_uring turned out to be unusable on this system, no more rings are set up then
+ * and stat data is fetched synchronously, a ring that fails later only stops its own walker
+ */
+static atomic_int uring_broken = 0;
+
+/**
+ * -stats: counters of the running thread for the code that has no walker at hand,
+ * and the sum of all walkers that are done
+ */
+static _Thread_local struct stats *thread_stats = NULL;
+static struct stats stats_total;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t stats_start_ticks;
+static struct timespec stats_start_time;
+
+static void *xmalloc(size_t size);
+static void *xrealloc(void *ptr, size_t size);
+static char *format_permission_string(char *out, mode_t mode);
+static char *format_number(char *out, unsigned long long number, int width);
+static char *format_string(char *out, const char *str, int width);
+static void no_argv(int argc, char ** parms, struct plan *plan);
+static void compile_error(int errnum, const char *format, ...) __attribute__((noreturn, format(printf, 2, 3)));
+static int walk_plan(const struct plan *plan);
+static int walk_stopped(const struct plan *plan);
+static void plan_free(struct plan *plan);
+static void patset_free(struct patset *set);
+static void trie_free(struct trie *t);
+static void do_emit(struct walker *w, struct find_entry *ent);
+static struct iter_batch *iter_get(struct find_iter *it);
+static void iter_put(struct find_iter *it, struct iter_batch *b);
+static void iter_flush(struct walker *w);
+static void *iter_walk(void *arg);
+static struct expr *new_expr(struct plan *plan, enum expr_kind kind);
+static void add_kid(struct expr *parent, struct expr *kid);
+static struct expr *parse_or(struct parser *p);
+static struct expr *parse_and(struct parser *p);
+static struct expr *parse_unary(struct parser *p);
+static struct expr *parse_primary(struct parser *p);
+static int parse_option(struct parser *p);
+static long parse_number(const char *option, const char *value, long min);
+static int jobs_max(void);
+static size_t parse_size(const char *option, const char *value, size_t min, size_t max);
+static mode_t parse_type(const char *parms);
+static struct pattern *compile_pattern(const char *glob, int icase);
+static int match_pattern(const struct pattern *pat, const char *str, size_t len);
+static struct patset *patset_new(void);
+static struct patset *load_patset(const char *file);
+static void patset_add(struct patset *set, char *glob);
+static void patset_finish(struct patset *set);
+static int match_patset(const struct patset *set, const char *str, size_t len);
+static struct regex *compile_regex(const char *value, const char *option, int icase);
+static int rx_parse_alt(struct rx_parser *p);
+static int rx_parse_cat(struct rx_parser *p);
+static int rx_parse_repeat(struct rx_parser *p);
+static int rx_parse_atom(struct rx_parser *p);
+static int rx_parse_bracket(struct rx_parser *p);
+static int rx_node(struct rx_parser *p, enum rx_kind kind, int left, int right);
+static int rx_literal(struct rx_parser *p, unsigned char c);
+static int rx_emit(struct regex *re, const struct rx_parser *p, int node, int next);
+static int nfa_add(struct regex *re, enum nfa_op op, int set, int out, int out1);
+static void rx_literals(const struct regex *re, const struct rx_parser *p, int node, struct rx_lit *lit);
+static void rx_classes(struct regex *re);
+static int match_regex(const struct regex *re, struct dfa *d, const char *str, size_t len);
+static int dfa_match(const struct regex *re, struct dfa *d, const char *str, size_t len);
+static int dfa_step(const struct regex *re, struct dfa *d, int from, int cls);
+static void dfa_reset(const struct regex *re, struct dfa *d);
+static void dfa_generation(const struct regex *re, struct dfa *d);
+static void dfa_closure(const struct regex *re, struct dfa *d, int state, int bol, int *accept);
+static int dfa_add(const struct regex *re, struct dfa *d, int accept);
+static void dfa_free(struct dfa *d);
+static void regex_free(struct regex *re);
+static struct needles *compile_needles(const char *value);
+static struct needles *load_needles(const char *file);
+static void needles_free(struct needles *nd);
+static int match_needles(const struct needles *nd, const char *buf, size_t len);
+static const char *search_string(const char *hay, size_t len, const char *str, size_t n);
+static int match_expr(const struct expr *e, const char *str, size_t len);
+static size_t strset_hash(const char *s, size_t len);
+static int trie_add(struct trie *t, const char *lit, size_t len, int reverse);
+static int trie_child(const struct trie *t, int node, unsigned char byte);
+static void trie_link(struct trie *t);
+static size_t glob_literal(const char *glob, const char **lit);
+static int expr_needs_stat(const struct expr *e);
+static void optimize_expr(struct plan *plan, struct expr *e);
+static void expr_estimate(struct expr *e);
+static double order_key(const struct expr *e, double cost, double pass);
+static void order_sort(const struct expr *e, size_t *perm, const double *key);
+static void order_init(struct order *o, const struct expr *e);
+static void order_revise(const struct expr *e, struct order *o);
+static int eval_ordered(const struct expr *e, struct find_entry *ent, struct walker *w);
+static struct exec *parse_exec(struct parser *p, const char *arg);
+static int do_exec(const struct exec *ex, struct find_entry *ent, struct walker *w);
+static char *exec_arg(const char *arg, const char *item);
+static void exec_split(const char *path, char **dir, char **item);
+static void exec_flush(struct walker *w, size_t i);
+static pid_t exec_spawn(struct walker *w, char **argv, const char *dir, int dirfd);
+static int exec_wait(pid_t pid);
+static void jobs_add(struct walker *w, char **argv, const char *dir);
+static void jobs_wait_all(void);
+static size_t add_output(struct plan *plan, const char *name);
+static int eval_expr(const struct expr *e, struct find_entry *ent, struct walker *w);
+static int eval_primary(const struct expr *e, struct find_entry *ent, struct walker *w);
+static int eval_counted(const struct expr *e, struct find_entry *ent, struct walker *w);
+static uint64_t stats_ticks(void);
+static void stats_init(struct stats *st, size_t nnodes);
+static void stats_add_node(struct plan *plan, struct expr *e, const char *arg, const char *value);
+static void stats_merge(const struct plan *plan, const struct stats *st);
+static void stats_report(const struct plan *plan);
+static void stats_json_string(FILE *fp, const char *str);
+static struct stat *entry_stat(struct find_entry *ent);
+static void statx_to_stat(const struct statx *stx, struct stat *st);
+static mode_t entry_type(struct find_entry *ent);
+static void path_set(struct pathbuf *pb, const char *path);
+static size_t path_push(struct pathbuf *pb, const char *name);
+static void do_entry(struct find_entry *ent, struct walker *w);
+static void namestack_push(struct namestack *ns, const char *name);
+static void build_index(const struct plan *plan);
+static int index_push(struct index_build *ib, int dirfd, const char *name, uint32_t rec);
+static void index_step(struct index_build *ib);
+static void index_error(const char *path, int err);
+static void index_read(struct index_build *ib, int fd, uint32_t rec);
+static void index_copy(struct index_build *ib, int fd, uint32_t old, uint32_t rec);
+static void index_child(struct index_build *ib, int fd, const char *name, unsigned char d_type, uint32_t parent, const struct index_rec *old);
+static void index_rec_set(struct index_rec *r, const struct stat *st, uint32_t parent, uint32_t depth);
+static void index_rec_get(const struct index *ix, size_t rec, struct index_rec *r);
+static uint64_t index_field(const struct index_rec *r, int col);
+static int index_descend(const struct index_build *ib, uint32_t rec);
+static uint32_t index_add(struct index_build *ib, const char *path, const struct index_rec *r);
+static size_t index_put_varint(FILE *fp, uint64_t v);
+static void index_write(struct index_build *ib, const char *file);
+static struct index *index_open(const char *file, int quiet);
+static void index_close(struct index *ix);
+static int index_check(const struct index *ix);
+static void index_seek(struct index_cursor *c, size_t rec);
+static const char *index_next(struct index_cursor *c);
+static uint32_t index_find_dir(struct index *ix, struct index_cursor *c, const char *path);
+static void walk_index(const struct plan *plan, struct walker *w);
+static char *index_path(const char *path);
+static struct watch *watch_open(void);
+static void watch_add(struct watch *wt, int fd, const char *path, int depth, dev_t dev);
+static void watch_rescan_add(struct watch *wt, const char *path, int depth, dev_t dev);
+static void watch_forget(struct watch *wt, const char *path);
+static void watch_run(const struct plan *plan);
+static void watch_event(struct watch *wt, const struct inotify_event *ev, struct walker *w);
+static void watch_rescan(struct walker *w, const struct watch_dir *root, struct timespec since);
+static int do_visit(struct find_entry *ent, struct walker *w);
+static void do_descend(struct find_entry *ent, struct walker *w);
+static void do_dir(struct find_entry *dir, struct walker *w);
+static void walk_step(struct walker *w);
+static int dir_push(struct walker *w, int dirfd, const char *name, int depth);
+static void frame_close(struct walker *w, size_t i, int reopen);
+static int frame_reopen(struct walker *w, size_t i);
+static int open_long(int dirfd, char *path);
+static void do_chunk(int fd, const char *buf, size_t len, int batched, struct walker *w);
+static void do_item(int fd, const char *name, unsigned char d_type, int batched, struct walker *w);
+static void defer_dir(struct find_entry *ent, struct walker *w);
+static void run_batch(int fd, struct walker *w);
+static void batch_visit(int fd, struct walker *w, const struct batch *b, size_t i, int res);
+static void uring_fail(struct uring *ring, int err);
+static void uring_unusable(const char *why, int err);
+static struct uring *uring_open(unsigned entries);
+static void uring_close(struct uring *ring);
+static int uring_enter(struct uring *ring, unsigned submit, unsigned wait);
+static void walker_init(struct walker *w, const struct plan *plan, struct pool *pool, int id);
+static void walker_free(struct walker *w);
+static void walk_parallel(const struct plan *plan, struct readpool *reads, struct sorter *sort);
+static void *walk_worker(void *arg);
+static void pool_push(struct walker *w, const char *path, int depth);
+static void deque_push(struct deque *dq, char *path, int depth, dev_t dev, const char *root);
+static int pool_take(struct walker *w, struct task *task);
+static int do_name(const struct find_entry *ent, const struct expr *e);
+static int do_type(mode_t type, struct find_entry *ent);
+static int do_path(const char * entry_name, const struct expr *e);
+static int do_regex(const char *path, const struct expr *e, struct walker *w);
+static int do_contains(struct find_entry *ent, const struct expr *e, struct walker *w);
+static int read_contains(struct find_entry *ent, const struct needles *nd, struct walker *w);
+static struct readpool *reads_start(const struct plan *plan, struct sorter *sort);
+static void reads_stop(struct readpool *rp);
+static void reads_push(struct readpool *rp, const struct find_entry *ent, const char *root);
+static void *read_worker(void *arg);
+static int daemon_run(const struct plan *plan);
+static void daemon_serve(int c, struct daemon_query *cache, uint64_t *clock, const int *keep);
+static struct daemon_query *daemon_compile(struct daemon_query *cache, struct daemon_query *q, uint64_t *clock);
+static void daemon_query_free(struct daemon_query *q);
+static void *daemon_watch_client(void *arg);
+static void daemon_signal(int sig);
+static int dircache_get(struct walker *w, int fd, struct stat *st);
+static void dircache_put(const struct stat *st, const char *recs, size_t len);
+static void dircache_drop(struct dircache *dc, struct dirlist *e);
+static size_t dircache_chain(const struct dircache *dc, dev_t dev, ino_t ino);
+static void dircache_free(struct dircache *dc);
+static struct sorter *sort_start(const struct plan *plan);
+static void sort_add(struct walker *w, struct find_entry *ent);
+static void sort_spill(struct walker *w);
+static void sort_finish(struct walker *w);
+static void sort_output(const struct plan *plan, struct sorter *s);
+static void sort_merge(const struct plan *plan, struct sortrun *runs, size_t n, FILE *to, struct walker *w);
+static void sort_sift(struct sortrun *runs, size_t *heap, size_t count, size_t i);
+static void sort_next(struct sortrun *run);
+static void sort_put(const struct sortrec *rec, FILE *to, struct walker *w);
+static FILE *sort_tmpfile(void);
+static int sort_cmp(const struct sortrec *a, const struct sortrec *b);
+static int sort_ref_cmp(const void *a, const void *b, void *base);
+static int walk_cmp(const char *p, const char *q);
+static void dirsort_add(struct walker *w, const char *buf, size_t len);
+static void dirsort_run(int fd, int batched, struct walker *w);
+static int name_ref_cmp(const void *a, const void *b, void *base);
+static void do_print(struct walker *w, size_t out, const char *file_name, char term);
+static void do_ls(struct walker *w, size_t out, const char *path, const struct stat *buf);
+static struct format *compile_format(const char *format);
+static void format_add(struct format *f, const struct fmt_op *op, size_t *cap);
+static void do_printf(struct walker *w, size_t out, const struct format *f, struct find_entry *ent);
+static char *line_reserve(struct pathbuf *b, size_t len);
+static size_t path_base(const struct find_entry *ent, size_t len);
+static char type_char(mode_t mode);
+static size_t format_time(struct walker *w, char *out, const struct stat *st, char field, char conv);
+static void do_record(struct walker *w, size_t out, struct find_entry *ent);
+static char *format_json_string(char *out, const char *str, size_t len);
+static size_t utf8_char(const char *s, size_t len);
+static char *format_csv_string(char *out, const char *str, size_t len);
+static char *format_seconds(char *out, const struct timespec *ts);
+static void format_header(const struct plan *plan);
+static char *out_reserve(struct walker *w, size_t out, size_t len);
+static void out_commit(struct walker *w, size_t out, const char *end);
+static void out_flush(struct walker *w, size_t out);
+static void flush_at_exit(void);
+static void flush_at_exit_register(void);
+static int do_user(const struct stat *entry_data, uid_t uid);
+static uid_t parse_user(const char * parms);
+static int do_nouser(const struct stat *entry_data);
+static int do_group(const struct stat *entry_data, gid_t gid);
+static gid_t parse_group(const char * parms);
+static int do_nogroup(const struct stat *entry_data);
+static void parse_range(struct expr *e, const char *option, const char *value);
+static int parse_cmp(const char *option, const char *value, int64_t *n, const char **suffix);
+static void parse_filesize(struct expr *e, const char *option, const char *value);
+static void parse_age(struct expr *e, const char *option, const char *value, int64_t now);
+static int64_t time_back(int64_t now, int64_t n, int64_t unit);
+static void parse_newer(struct expr *e, const char *value);
+static void parse_perm(struct expr *e, const char *option, const char *value);
+static mode_t parse_symbolic(const char *option, const char *value, const char *s);
+static int64_t stat_time(const struct stat *st, char field);
+static int do_range(const struct expr *e, const struct stat *st);
+static int do_perm(const struct expr *e, const struct stat *st);
+static int do_empty(const struct find_entry *ent, const struct stat *st);
+static const char *user_name(uid_t uid);
+static const char *group_name(gid_t gid);
+static int idcache_get(const struct idcache *cache, unsigned int id, const char **name);
+static const char *idcache_put(struct idcache *cache, unsigned int id, const char *name);
+static size_t idcache_slot(const struct idcache *cache, unsigned int id);
+static void idcache_clear(struct idcache *cache);
+
+/**
+ *
+ * \brief: compiles a command line into a query, see libfind.h
+ *
+ * Errors in the command line jump back here through compile_error. What the parser had
+ * allocated until then is released as far as the plan knows it.
+ *
+ */
+
+struct find_query *find_compile(int argc, char **argv, char *err, size_t errlen){
+    struct find_query *volatile query = xmalloc(sizeof(*query));		//read again after longjmp
+    jmp_buf env;
+    memset(query, 0, sizeof(*query));
+    compile_msg = err;
+    compile_msglen = errlen;
+    compile_env = &env;
+    if (setjmp(env) != 0){
+        compile_env = NULL;
+        plan_free(&query->plan);
+        free(query);
+        return NULL;
+    }
+    no_argv(argc, argv, &query->plan);
+    compile_env = NULL;
+    return query;
+}
+
+/**
+ *
+ * \brief: compiles a query from its parts by building the command line for it, see libfind.h
+ *
+ * Only the options and the expression go through the parser. The start points are set
+ * afterwards, so one named like an option, "!" or "(" is still a start point.
+ *
+ */
+
+struct find_query *find_compile_spec(const struct find_spec *spec, char *err, size_t errlen){
+    char numbers[3][24];		//the parser keeps the values, not the strings
+    size_t n = 0;
+    size_t npaths = 0;
+    int argc = 1;
+    while (spec->paths != NULL && spec->paths[npaths] != NULL){
+        npaths++;
+    }
+    for (size_t i = 0; spec->expr != NULL && spec->expr[i] != NULL; i++){
+        n++;
+    }
+    char **argv = xmalloc((n + npaths + 10) * sizeof(*argv));		//the start points are kept behind the command line
+    argv[0] = "find";
+    if (spec->jobs > 0){
+        snprintf(numbers[0], sizeof(numbers[0]), "%d", spec->jobs);
+        argv[argc++] = "-j";
+        argv[argc++] = numbers[0];
+    }
+    if (spec->maxdepth > 0){
+        snprintf(numbers[1], sizeof(numbers[1]), "%d", spec->maxdepth);
+        argv[argc++] = "-maxdepth";
+        argv[argc++] = numbers[1];
+    }
+    if (spec->mindepth > 0){
+        snprintf(numbers[2], sizeof(numbers[2]), "%d", spec->mindepth);
+        argv[argc++] = "-mindepth";
+        argv[argc++] = numbers[2];
+    }
+    if (spec->xdev){
+        argv[argc++] = "-xdev";
+    }
+    if (spec->expr != NULL && spec->expr[0] != NULL){		//in parentheses, so a -o in it does not split off the options
+        argv[argc++] = "(";
+        for (size_t i = 0; spec->expr[i] != NULL; i++){
+            argv[argc++] = (char *)spec->expr[i];
+        }
+        argv[argc++] = ")";
+    }
+    argv[argc] = NULL;
+    struct find_query *query = find_compile(argc, argv, err, errlen);
+    if (query == NULL){
+        free(argv);
+        return NULL;
+    }
+    if (npaths > 0){		//in place of the current directory, or of the whole index of -db
+        query->plan.paths = &argv[argc + 1];
+        memcpy(query->plan.paths, spec->paths, npaths * sizeof(*argv));
+        query->plan.npaths = npaths;
+        query->plan.default_path = 0;
+    }
+    query->argv = argv;
+    return query;
+}
+
+/**
+ *
+ * \brief: releases a query, see libfind.h
+ *
+ */
+
+void find_free(struct find_query *query){
+    if (query == NULL){
+        return;
+    }
+    for (size_t i = 0; i < query->plan.noutputs; i++){		//initialized once the whole command line was parsed
+        pthread_mutex_destroy(&query->plan.outputs[i].lock);
+    }
+    plan_free(&query->plan);
+    free(query->argv);
+    free(query);
+}
+
+/**
+ *
+ * \brief: walks a query like the command line tool, see libfind.h
+ *
+ */
+
+int find_run(struct find_query *query){
+    return walk_plan(&query->plan);
+}
+
+/**
+ *
+ * \brief: walks a query and hands the results to a callback, see libfind.h
+ *
+ */
+
+int find_walk(struct find_query *query, find_callback callback, void *arg){
+    struct sink sink;
+    sink.callback = callback;
+    sink.arg = arg;
+    sink.iter = NULL;
+    atomic_init(&sink.stop, 0);
+    query->plan.sink = &sink;
+    int status = walk_plan(&query->plan);
+    query->plan.sink = NULL;
+    return status;
+}
+
+/**
+ *
+ * \brief: starts the walk of an iterator on its own thread, see libfind.h
+ *
+ */
+
+struct find_iter *find_iter_open(struct find_query *query){
+    struct find_iter *it = xmalloc(sizeof(*it));
+    memset(it, 0, sizeof(*it));
+    it->query = query;
+    it->sink.iter = it;
+    atomic_init(&it->sink.stop, 0);
+    pthread_mutex_init(&it->lock, NULL);
+    pthread_cond_init(&it->cond, NULL);
+    query->plan.sink = &it->sink;
+    int rc = pthread_create(&it->thread, NULL, iter_walk, it);
+    if (rc != 0){
+        error(EXIT_FAILURE, rc, "pthread_create");
+    }
+    return it;
+}
+
+/**
+ *
+ * \brief: returns the next result of an iterator, see libfind.h
+ *
+ * The batch the reader is done with goes back to the walkers.
+ *
+ */
+
+struct find_entry *find_iter_next(struct find_iter *it){
+    if (it->cur != NULL && it->pos < it->cur->count){
+        return &it->cur->items[it->pos++];
+    }
+    pthread_mutex_lock(&it->lock);
+    if (it->cur != NULL){
+        it->cur->next = it->spare;
+        it->spare = it->cur;
+        it->cur = NULL;
+        pthread_cond_broadcast(&it->cond);
+    }
+    while (it->full == NULL && !it->done){
+        pthread_cond_wait(&it->cond, &it->lock);
+    }
+    if (it->full != NULL){
+        it->cur = it->full;
+        it->full = it->cur->next;
+        if (it->full == NULL){
+            it->last = NULL;
+        }
+        it->pos = 0;
+    }
+    pthread_mutex_unlock(&it->lock);
+    return it->cur != NULL ? &it->cur->items[it->pos++] : NULL;
+}
+
+/**
+ *
+ * \brief: stops the walk of an iterator and releases it, see libfind.h
+ *
+ */
+
+int find_iter_close(struct find_iter *it){
+    struct iter_batch *lists[3] = {it->full, it->spare, it->cur};
+    atomic_store(&it->sink.stop, 1);
+    pthread_mutex_lock(&it->lock);		//walkers waiting for a batch see the stop
+    pthread_cond_broadcast(&it->cond);
+    pthread_mutex_unlock(&it->lock);
+    pthread_join(it->thread, NULL);
+    it->query->plan.sink = NULL;
+    lists[0] = it->full;
+    lists[1] = it->spare;
+    lists[2] = it->cur;
+    if (it->cur != NULL){
+        it->cur->next = NULL;
+    }
+    for (int i = 0; i < 3; i++){
+        while (lists[i] != NULL){
+            struct iter_batch *b = lists[i];
+            lists[i] = b->next;
+            free(b->paths.buf);
+            free(b);
+        }
+    }
+    pthread_mutex_destroy(&it->lock);
+    pthread_cond_destroy(&it->cond);
+    int status = it->status;
+    free(it);
+    return status;
+}
+
+/**
+ * \brief the path of a result, see libfind.h
+ */
+
+const char *find_entry_path(const struct find_entry *entry){
+    return entry->path;
+}
+
+/**
+ * \brief the last element of the path of a result, see libfind.h
+ */
+
+const char *find_entry_name(const struct find_entry *entry){
+    return entry->path + path_base(entry, strlen(entry->path));
+}
+
+/**
+ * \brief the depth of a result, see libfind.h
+ */
+
+int find_entry_depth(const struct find_entry *entry){
+    return entry->depth;
+}
+
+/**
+ * \brief the type of a result as reported by the directory, see libfind.h
+ */
+
+unsigned char find_entry_dtype(const struct find_entry *entry){
+    return entry->d_type;
+}
+
+/**
+ *
+ * \brief: returns the stat data of a result, see libfind.h
+ *
+ * If the walk has not fetched it, all basic fields are asked for, not only those of the plan.
+ *
+ */
+
+const struct stat *find_entry_stat(struct find_entry *entry){
+    if (entry->have_stat == 0){
+        entry->stat_mask |= STATX_BASIC_STATS;
+    }
+    return entry_stat(entry);
+}
+
+/**
+ *
+ * \brief: runs a query in a daemon started with -daemon, see libfind.h
+ *
+ * The arguments go over the socket with their null bytes, stdout, stderr and the working
+ * directory along with them, so the daemon writes the results itself.
+ *
+ */
+
+int find_client(const char *socket_path, int argc, char **argv){
+    struct sockaddr_un addr;
+    struct daemon_request req = {DAEMON_MAGIC, 0};
+    char ctl[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = {&req, sizeof(req)};
+    struct msghdr msg;
+    int32_t status;
+    char *args = NULL;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)){
+        error(0, 0, "%s: the path of the socket is too long", socket_path);
+        return 1;
+    }
+    for (int i = 0; i < argc; i++){
+        size_t n = strlen(argv[i]) + 1;
+        args = xrealloc(args, req.len + n);
+        memcpy(args + req.len, argv[i], n);
+        req.len += n;
+    }
+    if (req.len > DAEMON_REQUEST_MAX){
+        error(0, 0, "the arguments are too long for the daemon");
+        free(args);
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    int fds[3] = {STDOUT_FILENO, STDERR_FILENO, open(".", O_PATH | O_DIRECTORY | O_CLOEXEC)};
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fds[2] == -1 || fd == -1 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1){
+        error(0, errno, "%s", fds[2] == -1 ? "." : socket_path);
+        goto fail;
+    }
+    memset(&msg, 0, sizeof(msg));
+    memset(ctl, 0, sizeof(ctl));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl;
+    msg.msg_controllen = sizeof(ctl);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(req) || (req.len > 0 && send(fd, args, req.len, MSG_NOSIGNAL) != (ssize_t)req.len)){
+        error(0, errno, "%s", socket_path);
+        goto fail;
+    }
+    ssize_t n = recv(fd, &status, sizeof(status), MSG_WAITALL);
+    if (n != sizeof(status)){
+        error(0, n == -1 ? errno : 0, "%s: the daemon ended the query", socket_path);
+        goto fail;
+    }
+    free(args);
+    close(fds[2]);
+    close(fd);
+    return status;
+fail:
+    free(args);
+    if (fds[2] != -1){
+        close(fds[2]);
+    }
+    if (fd != -1){
+        close(fd);
+    }
+    return 1;
+}
+
+/**
+ *
+ * \brief: walks the start points of a plan, or its index, and runs -watch afterwards
+ *
+ * Used by find_run, find_walk and the iterators, the plan tells them apart by its sink.
+ *
+ * \param plan - the compiled command line
+ *
+ * \return the exit status, 1 if a command of -exec ... + failed
+ *
+ */
+
+static int walk_plan(const struct plan *plan){
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    struct walker w;
+    struct readpool *reads;
+    struct sorter *sort = NULL;
+    pthread_once(&once, flush_at_exit_register);
+    if (plan->daemon != NULL){
+        return daemon_run(plan);
+    }
+    exit_status = 0;
+    if (plan->default_path && plan->format == FORMAT_TEXT && plan->sink == NULL){		//records stay parseable
+        printf ("Default directory\n");
+        fflush(stdout);		//the results are written to the descriptor directly
+    }
+    if (plan->index_out != NULL){
+        build_index(plan);
+        return exit_status;
+    }
+    format_header(plan);
+    if (plan->nexecs > 0){
+        pthread_mutex_lock(&exec_lock);
+        if (exec_cap < (size_t)plan->exec_jobs){
+            exec_pids = xrealloc(exec_pids, (size_t)plan->exec_jobs * sizeof(*exec_pids));
+            exec_cap = (size_t)plan->exec_jobs;
+        }
+        pthread_mutex_unlock(&exec_lock);
+    }
+    if (plan->stats){
+        pthread_mutex_lock(&stats_lock);
+        free(stats_total.evals);
+        stats_init(&stats_total, plan->nnodes);
+        pthread_mutex_unlock(&stats_lock);
+        clock_gettime(CLOCK_MONOTONIC, &stats_start_time);
+        stats_start_ticks = stats_ticks();
+    }
+    if (plan->sort != SORT_NONE && (plan->sort != SORT_NAME || plan->jobs > 1 || plan->bfs || plan->db != NULL
+        || (plan->contains && plan->contains_jobs > 0))){
+        sort = sort_start(plan);		//the results do not come in their order, they are merged once the walk ended
+    }
+    reads = plan->contains && plan->contains_jobs > 0 ? reads_start(plan, sort) : NULL;
+    if (plan->db != NULL){
+        walker_init(&w, plan, NULL, 0);
+        w.reads = reads;
+        w.sort = sort;
+        exit_walkers = &w;
+        exit_nwalkers = 1;
+        walk_index(plan, &w);
+        walker_free(&w);
+        exit_nwalkers = 0;
+        reads_stop(reads);
+        jobs_wait_all();
+        sort_output(plan, sort);
+        stats_report(plan);
+        return exit_status;
+    }
+    if (plan->jobs > 1){
+        walk_parallel(plan, reads, sort);
+        reads_stop(reads);
+        jobs_wait_all();
+        sort_output(plan, sort);
+        stats_report(plan);
+        if (plan->watch != NULL){
+            watch_run(plan);
+        }
+        return exit_status;
+    }
+    walker_init(&w, plan, NULL, 0);
+    w.reads = reads;
+    w.sort = sort;
+    if (plan->sort == SORT_NAME && sort == NULL){		//one sorted directory after the other keeps the whole walk sorted
+        w.dirsort = xmalloc(sizeof(*w.dirsort));
+        memset(w.dirsort, 0, sizeof(*w.dirsort));
+    }
+    exit_walkers = &w;
+    exit_nwalkers = 1;
+    for (size_t i = 0; i < plan->npaths; i++){
+        path_set(&w.pb, plan->paths[i]);
+        struct find_entry ent = {w.pb.buf, AT_FDCWD, plan->paths[i], DT_UNKNOWN, plan->stat_mask, 0, {0}, 0, 0};
+        if (entry_stat(&ent) != NULL){		//a missing start point is always reported
+            w.dev = ent.st.st_dev;
+            w.root = plan->paths[i];
+            do_entry(&ent,&w);
+        }
+    }
+    walker_free(&w);
+    exit_nwalkers = 0;
+    reads_stop(reads);		//-watch reads the files of its changes itself
+    jobs_wait_all();
+    sort_output(plan, sort);
+    stats_report(plan);		//the summary covers the walk, not the changes reported later
+    if (plan->watch != NULL){
+        watch_run(plan);
+    }
+    return exit_status;
+}
+
+/**
+ *
+ * \brief: reports an error in the command line and leaves the parser
+ *
+ * During find_compile the message goes to its caller, otherwise the program terminates like with error().
+ *
+ * \param errnum - errno value whose text is appended, 0 for none
+ * \param format - printf format of the message
+ *
+ * \return: never returns
+ *
+ */
+
+static void compile_error(int errnum, const char *format, ...){
+    char msg[512];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(msg, sizeof(msg), format, ap);
+    va_end(ap);
+    if (compile_env == NULL){
+        error(EXIT_FAILURE, errnum, "%s", msg);
+    }
+    if (compile_msg != NULL && compile_msglen > 0){
+        snprintf(compile_msg, compile_msglen, "%s%s%s", msg, errnum != 0 ? ": " : "", errnum != 0 ? strerror(errnum) : "");
+    }
+    longjmp(*compile_env, 1);
+}
+
+/**
+ *
+ * \brief: releases what a plan allocated, for find_free and for find_compile on an error
+ *
+ * The nodes are released through the table new_expr fills, which has every one of them,
+ * also those a failed parse did not link into the expression yet.
+ *
+ * \param plan - the plan, the descriptors of -fprint are closed
+ *
+ */
+
+static void plan_free(struct plan *plan){
+    for (size_t i = 0; i < plan->nexprs; i++){
+        struct expr *e = plan->exprs[i];
+        switch (e->kind){
+            case EXPR_NAME:
+            case EXPR_PATH:
+                if (e->arg.pat != NULL){
+                    free(e->arg.pat->lit);
+                    free(e->arg.pat);
+                }
+                break;
+            case EXPR_NAME_FROM:
+            case EXPR_PATH_FROM:
+                patset_free(e->arg.set);
+                break;
+            case EXPR_REGEX:
+                regex_free(e->arg.regex);
+                break;
+            case EXPR_CONTAINS:
+                needles_free(e->arg.needles);
+                break;
+            case EXPR_PRINTF:
+                if (e->arg.printf.fmt != NULL){
+                    free(e->arg.printf.fmt->ops);
+                    free(e->arg.printf.fmt->text);
+                    free(e->arg.printf.fmt);
+                }
+                break;
+            case EXPR_EXEC:
+                free(e->arg.exec);
+                break;
+            default:
+                break;
+        }
+        free(e->kids);
+        free(e->label);
+        free(e);
+    }
+    free(plan->exprs);
+    free(plan->nodes);
+    free(plan->groups);
+    free(plan->execs);
+    patset_free(plan->skip);
+    for (size_t i = 1; i < plan->noutputs; i++){		//the first one is stdout
+        close(plan->outputs[i].fd);
+    }
+    free(plan->outputs);
+    if (plan->watch != NULL){
+        close(plan->watch->fd);
+        for (size_t i = 0; i < plan->watch->cap; i++){
+            free(plan->watch->dirs[i].path);
+        }
+        for (size_t i = 0; i < plan->watch->nrescan; i++){
+            free(plan->watch->rescan[i].path);
+        }
+        free(plan->watch->dirs);
+        free(plan->watch->rescan);
+        pthread_mutex_destroy(&plan->watch->lock);
+        free(plan->watch);
+    }
+}
+
+/**
+ *
+ * \brief: releases a pattern set of -name-from, -path-from or -skip-dir
+ *
+ * \param set - the set, may be NULL
+ *
+ */
+
+static void patset_free(struct patset *set){
+    if (set == NULL){
+        return;
+    }
+    for (size_t i = 0; i < set->exact_cap; i++){
+        free(set->exact[i]);
+    }
+    for (size_t i = 0; i < set->nglobs; i++){
+        free((char *)set->globs[i]);
+    }
+    trie_free(&set->prefix);
+    trie_free(&set->suffix);
+    trie_free(&set->contains);
+    free(set->exact);
+    free(set->globs);
+    free(set->glob_next);
+    free(set->glob_of);
+    free(set->always);
+    free(set);
+}
+
+/**
+ * \brief releases the nodes of a trie, the trie itself is part of its set
+ */
+
+static void trie_free(struct trie *t){
+    free(t->nodes);
+}
+
+/**
+ *
+ *\brief: no_argv splits the arguments supplied in the program call into the start points
+ *and the expression, sets the current directory as a default if not supplied by the user
+ *and compiles the expression into a plan
+ *
+ * \param argc is the count of the arguments supplied
+ * \param parms is the arry of the supplied arguments (argv)
+ * \param plan receives the start points and the compiled expression
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void no_argv(int argc, char ** parms, struct plan *plan){
+    static char *default_path[] = {"."};
+    int first = 1;
+    struct parser p;
+
+    //everything up to the first option, "!" or "(" is a start point
+    while (first < argc && *parms[first] != '-' && strcmp(parms[first], "!") != 0 && strcmp(parms[first], "(") != 0){
+        first++;
+    }
+    if (first == 1){		//if no directory is supplied the current directory will be the default
+        plan->paths = default_path;
+        plan->npaths = 1;
+    }
+    else {
+        plan->paths = &parms[1];
+        plan->npaths = (size_t)(first - 1);
+    }
+
+    plan->jobs = 1;
+    plan->uring = 0;
+    plan->dirbuf_size = DIRBUF_DEFAULT;
+    plan->fd_budget = FD_BUDGET_DEFAULT;
+    plan->bfs = 0;
+    plan->maxdepth = INT_MAX;
+    plan->mindepth = 0;
+    plan->xdev = 0;
+    plan->skip = NULL;
+    plan->index_out = NULL;
+    plan->db = NULL;
+    plan->watch = NULL;
+    plan->stats = 0;
+    plan->nodes = NULL;
+    plan->nnodes = 0;
+    plan->exprs = NULL;
+    plan->nexprs = 0;
+    plan->reorder = 2;
+    plan->nregexes = 0;
+    plan->contains = 0;
+    plan->contains_jobs = CONTAINS_JOBS_DEFAULT;
+    plan->contains_max = CONTAINS_MAX_DEFAULT;
+    plan->sort = SORT_NONE;
+    plan->sort_mem = SORT_MEM_DEFAULT;
+    plan->daemon = NULL;
+    plan->daemon_cache = DIRCACHE_DEFAULT;
+    plan->reusable = 1;
+    plan->groups = NULL;
+    plan->ngroups = 0;
+    plan->execs = NULL;
+    plan->nexecs = 0;
+    plan->exec_jobs = 1;
+    plan->format = FORMAT_TEXT;
+    plan->outputs = NULL;
+    plan->noutputs = 0;
+    plan->sink = NULL;
+    add_output(plan, NULL);
+    p.plan = plan;
+    p.args = parms;
+    p.pos = first;
+    p.count = argc;
+    p.has_action = 0;
+    p.stat_mask = STATX_TYPE;		//the type is needed to descend if getdents64 does not report it
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    p.now = (int64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+    plan->root = NULL;
+    if (p.pos < p.count){
+        plan->root = parse_or(&p);
+        if (p.pos < p.count){
+            compile_error(0, "unexpected argument `%s'", parms[p.pos]);
+        }
+    }
+    if (p.has_action == 0){		//without -print or -ls every match is printed
+        struct expr *and = new_expr(plan, EXPR_AND);
+        if (plan->root != NULL){
+            add_kid(and, plan->root);
+        }
+        struct expr *print = new_expr(plan, EXPR_PRINT);
+        print->arg.print.out = 0;
+        print->arg.print.term = '\n';
+        stats_add_node(plan, print, "-print", "(implied)");
+        add_kid(and, print);
+        plan->root = and;
+        plan->outputs[0].records = 1;
+    }
+    if (plan->format != FORMAT_TEXT){
+        p.stat_mask |= RECORD_MASK;
+    }
+    for (size_t i = 0; i < plan->noutputs; i++){		//the table does not move anymore
+        pthread_mutex_init(&plan->outputs[i].lock, NULL);
+    }
+    if (plan->skip != NULL){
+        patset_finish(plan->skip);
+    }
+    if (plan->watch != NULL && (plan->db != NULL || plan->index_out != NULL)){
+        compile_error(0, "-watch only works on the file system, not with -db or -build-index");
+    }
+    if (plan->watch != NULL){
+        p.stat_mask |= STATX_CTIME;		//rescans look at the status change time
+    }
+    if (first == 1 && plan->db != NULL){		//an index is searched as a whole by default
+        plan->npaths = 0;
+    }
+    plan->default_path = first == 1 && plan->db == NULL;
+    if (plan->nexecs > 0){
+        long arg_max = sysconf(_SC_ARG_MAX);
+        size_t env = EXEC_HEADROOM;
+        for (char **var = environ; *var != NULL; var++){		//the environment shares the area with the arguments
+            env += strlen(*var) + 1 + sizeof(*var);
+        }
+        plan->arg_max = arg_max > 0 && (size_t)arg_max > env + EXEC_HEADROOM ? (size_t)arg_max - env : EXEC_HEADROOM;
+    }
+    plan->stat_mask = p.stat_mask;
+    optimize_expr(plan, plan->root);
+    plan->stat_always = expr_needs_stat(plan->root);		//after reordering, cheap tests may now come first
+}
+
+/**
+ *
+ * \brief: malloc that terminates the program if no memory is left
+ *
+ * \param size - number of bytes to allocate
+ *
+ * \return pointer to the allocated memory
+ *
+ */
+
+static void *xmalloc(size_t size){
+    void *ptr = malloc(size);
+    if (ptr == NULL){
+        error(EXIT_FAILURE, errno, "malloc");
+    }
+    return ptr;
+}
+
+/**
+ *
+ * \brief: realloc that terminates the program if no memory is left
+ *
+ * \param ptr - memory to resize
+ * \param size - new number of bytes
+ *
+ * \return pointer to the resized memory
+ *
+ */
+
+static void *xrealloc(void *ptr, size_t size){
+    ptr = realloc(ptr, size);
+    if (ptr == NULL){
+        error(EXIT_FAILURE, errno, "realloc");
+    }
+    return ptr;
+}
+
+/**
+ *
+ * \brief: allocates an empty expression node, the plan owns it from then on
+ *
+ * \param plan - the plan being compiled, plan_free releases the node
+ * \param kind - kind of the new node
+ *
+ * \return the new node
+ *
+ */
+
+static struct expr *new_expr(struct plan *plan, enum expr_kind kind){
+    struct expr *e = xmalloc(sizeof(*e));
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+    e->id = -1;
+    e->group = -1;
+    plan->exprs = xrealloc(plan->exprs, (plan->nexprs + 1) * sizeof(*plan->exprs));
+    plan->exprs[plan->nexprs++] = e;
+    return e;
+}
+
+/**
+ *
+ * \brief: appends a child to an -a, -o or ! node
+ *
+ * \param parent - node that receives the child
+ * \param kid - the child
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void add_kid(struct expr *parent, struct expr *kid){
+    parent->kids = xrealloc(parent->kids, (parent->nkids + 1) * sizeof(*parent->kids));
+    parent->kids[parent->nkids++] = kid;
+}
+
+/**
+ *
+ * \brief: parses alternatives: expr -o expr ...
+ *
+ * \param p - parser state
+ *
+ * \return the compiled expression
+ *
+ */
+
+static struct expr *parse_or(struct parser *p){
+    struct expr *left = parse_and(p);
+    if (p->pos >= p->count || (strcmp(p->args[p->pos], "-o") != 0 && strcmp(p->args[p->pos], "-or") != 0)){
+        return left;
+    }
+    struct expr *or = new_expr(p->plan, EXPR_OR);
+    add_kid(or, left);
+    while (p->pos < p->count && (strcmp(p->args[p->pos], "-o") == 0 || strcmp(p->args[p->pos], "-or") == 0)){
+        p->pos++;
+        add_kid(or, parse_and(p));
+    }
+    return or;
+}
+
+/**
+ *
+ * \brief: parses conjunctions: expr [-a] expr ...
+ *
+ * \param p - parser state
+ *
+ * \return the compiled expression
+ *
+ */
+
+static struct expr *parse_and(struct parser *p){
+    struct expr *left = parse_unary(p);
+    struct expr *and = NULL;
+    while (p->pos < p->count){
+        const char *arg = p->args[p->pos];
+        if (strcmp(arg, "-o") == 0 || strcmp(arg, "-or") == 0 || strcmp(arg, ")") == 0){
+            break;
+        }
+        if (strcmp(arg, "-a") == 0 || strcmp(arg, "-and") == 0){
+            p->pos++;
+        }
+        if (and == NULL){		//a single operand needs no node of its own
+            and = new_expr(p->plan, EXPR_AND);
+            add_kid(and, left);
+        }
+        add_kid(and, parse_unary(p));
+    }
+    return and != NULL ? and : left;
+}
+
+/**
+ *
+ * \brief: parses negations and parentheses
+ *
+ * \param p - parser state
+ *
+ * \return the compiled expression
+ *
+ */
+
+static struct expr *parse_unary(struct parser *p){
+    if (p->pos >= p->count){
+        compile_error(0, "expected an expression after `%s'", p->args[p->pos - 1]);
+    }
+    const char *arg = p->args[p->pos];
+    if (strcmp(arg, "!") == 0 || strcmp(arg, "-not") == 0){
+        p->pos++;
+        struct expr *not = new_expr(p->plan, EXPR_NOT);
+        add_kid(not, parse_unary(p));
+        return not;
+    }
+    if (strcmp(arg, "(") == 0){
+        p->pos++;
+        struct expr *inner = parse_or(p);
+        if (p->pos >= p->count || strcmp(p->args[p->pos], ")") != 0){
+            compile_error(0, "missing `)'");
+        }
+        p->pos++;
+        return inner;
+    }
+    return parse_primary(p);
+}
+
+/**
+ *
+ * \brief: looks the option up in the table of primaries and converts its argument
+ *
+ * \param p - parser state
+ *
+ * \return the compiled primary
+ *
+ */
+
+static struct expr *parse_primary(struct parser *p){
+    const char *arg = p->args[p->pos];
+    if (parse_option(p)){
+        return new_expr(p->plan, EXPR_TRUE);
+    }
+    for (size_t j = 0; j < sizeof(primaries) / sizeof(primaries[0]); j++){
+        if (strcmp(primaries[j].name, arg) != 0){
+            continue;
+        }
+        p->pos++;
+        const char *value = NULL;
+        if (primaries[j].has_arg){
+            if (p->pos >= p->count){
+                compile_error(0, "missing argument to `%s'", arg);
+            }
+            value = p->args[p->pos++];
+        }
+        struct expr *e = new_expr(p->plan, primaries[j].kind);
+        p->stat_mask |= primaries[j].stat_mask;
+        stats_add_node(p->plan, e, arg, value);
+        switch (e->kind){
+            case EXPR_NAME:
+            case EXPR_PATH:
+                e->arg.pat = compile_pattern(value, arg[1] == 'i');
+                break;
+            case EXPR_NAME_FROM:
+            case EXPR_PATH_FROM:
+                e->arg.set = load_patset(value);
+                p->plan->reusable = 0;		//the file may change
+                break;
+            case EXPR_REGEX:
+                e->arg.regex = compile_regex(value, arg, arg[1] == 'i');
+                e->arg.regex->index = p->plan->nregexes++;
+                break;
+            case EXPR_CONTAINS:
+                e->arg.needles = strcmp(arg, "-contains-from") == 0 ? load_needles(value) : compile_needles(value);
+                p->plan->contains = 1;
+                p->plan->reusable &= strcmp(arg, "-contains-from") != 0;
+                break;
+            case EXPR_TYPE:
+                e->arg.type = parse_type(value);
+                break;
+            case EXPR_USER:
+                e->arg.uid = parse_user(value);
+                break;
+            case EXPR_GROUP:
+                e->arg.gid = parse_group(value);
+                break;
+            case EXPR_SIZE:
+                parse_filesize(e, arg, value);
+                break;
+            case EXPR_TIME:
+                p->plan->reusable = 0;		//ages count from the time of compiling
+                if (strcmp(arg, "-newer") == 0){
+                    parse_newer(e, value);
+                }
+                else {
+                    parse_age(e, arg, value, p->now);
+                }
+                break;
+            case EXPR_PERM:
+                parse_perm(e, arg, value);
+                break;
+            case EXPR_INUM:
+            case EXPR_LINKS:
+                parse_range(e, arg, value);
+                break;
+            case EXPR_PRINT:
+                e->arg.print.out = strcmp(arg, "-fprint") == 0 ? add_output(p->plan, value) : 0;
+                e->arg.print.term = strcmp(arg, "-print0") == 0 ? '\0' : '\n';
+                p->has_action = 1;
+                p->plan->outputs[e->arg.print.out].records = 1;
+                break;
+            case EXPR_PRINTF:
+                e->arg.printf.out = 0;
+                if (strcmp(arg, "-fprintf") == 0){
+                    if (p->pos >= p->count){
+                        compile_error(0, "missing argument to `%s'", arg);
+                    }
+                    e->arg.printf.out = add_output(p->plan, value);
+                    value = p->args[p->pos++];
+                }
+                e->arg.printf.fmt = compile_format(value);
+                p->stat_mask |= e->arg.printf.fmt->stat_mask;
+                p->has_action = 1;
+                break;
+            case EXPR_LS:
+                e->arg.print.out = 0;
+                e->arg.print.term = '\n';
+                p->has_action = 1;
+                break;
+            case EXPR_EXEC:
+                e->arg.exec = parse_exec(p, arg);
+                p->has_action = 1;
+                break;
+            default:
+                break;
+        }
+        return e;
+    }
+    compile_error(0, "unknown predicate `%s'", arg);
+    return NULL;
+}
+
+/**
+ *
+ * \brief: adds an output to the plan, the file of -fprint is created right away
+ *
+ * Naming the same file twice writes both actions into one output.
+ *
+ * \param plan - the plan
+ * \param name - the file name, NULL for stdout
+ *
+ * \return index of the output in the plan
+ *
+ */
+
+static size_t add_output(struct plan *plan, const char *name){
+    for (size_t i = 0; name != NULL && i < plan->noutputs; i++){
+        if (plan->outputs[i].name != NULL && strcmp(plan->outputs[i].name, name) == 0){
+            return i;
+        }
+    }
+    plan->outputs = xrealloc(plan->outputs, (plan->noutputs + 1) * sizeof(*plan->outputs));
+    struct output *o = &plan->outputs[plan->noutputs];
+    o->name = name;
+    if (name == NULL){
+        o->fd = STDOUT_FILENO;
+    }
+    else if ((o->fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) == -1){
+        compile_error(errno, "%s", name);
+    }
+    else {
+        plan->reusable = 0;		//the file is truncated when the plan is compiled, not when it is walked
+    }
+    o->is_tty = isatty(o->fd);
+    o->records = 0;
+    return plan->noutputs++;
+}
+
+/**
+ *
+ * \brief: looks the argument up in the table of options and stores its value in the plan
+ *
+ * \param p - parser state
+ *
+ * \return 1 if the argument was an option and has been consumed, 0 otherwise
+ *
+ */
+
+static int parse_option(struct parser *p){
+    const char *arg = p->args[p->pos];
+    for (size_t j = 0; j < sizeof(options) / sizeof(options[0]); j++){
+        if (strcmp(options[j].name, arg) != 0){
+            continue;
+        }
+        p->pos++;
+        const char *value = NULL;
+        if (options[j].has_arg){
+            if (p->pos >= p->count){
+                compile_error(0, "missing argument to `%s'", arg);
+            }
+            value = p->args[p->pos++];
+        }
+        switch (options[j].kind){
+            case OPT_JOBS:
+                p->plan->jobs = (int)parse_number(arg, value, 1);
+                if (p->plan->jobs > jobs_max()){		//more threads than that only contend, and each one costs a stack
+                    error(0, 0, "warning: `%s %s' is limited to %d threads", arg, value, jobs_max());
+                    p->plan->jobs = jobs_max();
+                }
+                break;
+            case OPT_URING:
+                p->plan->uring = 1;
+                break;
+            case OPT_DIRBUF:
+                p->plan->dirbuf_size = parse_size(arg, value, DIRBUF_MIN, DIRBUF_MAX);
+                break;
+            case OPT_MAXDEPTH:
+                p->plan->maxdepth = (int)parse_number(arg, value, 0);
+                break;
+            case OPT_MINDEPTH:
+                p->plan->mindepth = (int)parse_number(arg, value, 0);
+                break;
+            case OPT_XDEV:
+                p->plan->xdev = 1;
+                break;
+            case OPT_SKIPDIR:
+                if (p->plan->skip == NULL){
+                    p->plan->skip = patset_new();
+                }
+                patset_add(p->plan->skip, strdup(value));
+                break;
+            case OPT_BUILD_INDEX:
+                p->plan->index_out = value;
+                break;
+            case OPT_DB:
+                p->plan->db = value;
+                break;
+            case OPT_WATCH:
+                if (p->plan->watch == NULL){
+                    p->plan->watch = watch_open();
+                }
+                break;
+            case OPT_FD_BUDGET:
+                p->plan->fd_budget = (int)parse_number(arg, value, 1);
+                break;
+            case OPT_ORDER:
+                if (strcmp(value, "dfs") != 0 && strcmp(value, "bfs") != 0){
+                    compile_error(0, "invalid argument `%s' to `%s', expected dfs or bfs", value, arg);
+                }
+                p->plan->bfs = strcmp(value, "bfs") == 0;
+                break;
+            case OPT_STATS:
+                p->plan->stats = 1;
+                break;
+            case OPT_STATS_JSON:
+                p->plan->stats = 2;
+                break;
+            case OPT_REORDER:
+                if (strcmp(value, "off") == 0){
+                    p->plan->reorder = 0;
+                }
+                else if (strcmp(value, "static") == 0){
+                    p->plan->reorder = 1;
+                }
+                else if (strcmp(value, "adaptive") == 0){
+                    p->plan->reorder = 2;
+                }
+                else {
+                    compile_error(0, "invalid argument `%s' to `%s', expected off, static or adaptive", value, arg);
+                }
+                break;
+            case OPT_EXEC_JOBS:
+                p->plan->exec_jobs = (int)parse_number(arg, value, 1);
+                break;
+            case OPT_CONTAINS_JOBS:
+                p->plan->contains_jobs = (int)parse_number(arg, value, 0);
+                break;
+            case OPT_CONTAINS_MAX:
+                p->plan->contains_max = parse_size(arg, value, 1, SIZE_MAX);
+                break;
+            case OPT_SORT:
+                if (strcmp(value, "name") == 0){
+                    p->plan->sort = SORT_NAME;
+                }
+                else if (strcmp(value, "size") == 0){
+                    p->plan->sort = SORT_SIZE;
+                    p->stat_mask |= STATX_SIZE;
+                }
+                else if (strcmp(value, "mtime") == 0){
+                    p->plan->sort = SORT_MTIME;
+                    p->stat_mask |= STATX_MTIME;
+                }
+                else {
+                    compile_error(0, "invalid argument `%s' to `%s', expected name, size or mtime", value, arg);
+                }
+                break;
+            case OPT_SORT_MEM:
+                p->plan->sort_mem = parse_size(arg, value, SORT_MEM_MIN, SIZE_MAX);
+                break;
+            case OPT_DAEMON:
+                p->plan->daemon = value;
+                break;
+            case OPT_DAEMON_CACHE:
+                p->plan->daemon_cache = parse_size(arg, value, DIRCACHE_MIN, SIZE_MAX);
+                break;
+            case OPT_FORMAT:
+                if (strcmp(value, "text") == 0){
+                    p->plan->format = FORMAT_TEXT;
+                }
+                else if (strcmp(value, "ndjson") == 0){
+                    p->plan->format = FORMAT_NDJSON;
+                }
+                else if (strcmp(value, "csv") == 0){
+                    p->plan->format = FORMAT_CSV;
+                }
+                else if (strcmp(value, "bin") == 0){
+                    p->plan->format = FORMAT_BIN;
+                }
+                else {
+                    compile_error(0, "invalid argument `%s' to `%s', expected text, ndjson, csv or bin", value, arg);
+                }
+                break;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ *
+ * \brief: converts the numeric argument of an option
+ *
+ * \param option - name of the option for the error message
+ * \param value - the argument
+ * \param min - smallest allowed value
+ *
+ * \return the number, the program terminates if the argument is invalid
+ *
+ */
+
+static long parse_number(const char *option, const char *value, long min){
+    char *end;
+    errno = 0;
+    long number = strtol(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || number < min || number > INT_MAX){
+        compile_error(0, "invalid argument `%s' to `%s'", value, option);
+    }
+    return number;
+}
+
+/**
+ *
+ * \brief: the most threads -j starts, JOBS_PER_CPU per online processor but at most JOBS_MAX
+ *
+ * \return the limit
+ *
+ */
+
+static int jobs_max(void){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1 || cpus > JOBS_MAX / JOBS_PER_CPU){
+        return JOBS_MAX;
+    }
+    return (int)cpus * JOBS_PER_CPU;
+}
+
+/**
+ *
+ * \brief: converts a size argument with an optional k or m suffix
+ *
+ * \param option - name of the option for the error message
+ * \param value - the argument
+ * \param min - smallest allowed value
+ * \param max - largest allowed value
+ *
+ * \return the size in bytes, the program terminates if the argument is invalid
+ *
+ */
+
+static size_t parse_size(const char *option, const char *value, size_t min, size_t max){
+    char *end;
+    errno = 0;
+    unsigned long long size = strtoull(value, &end, 10);
+    if (*end == 'k' || *end == 'K'){
+        size *= 1024;
+        end++;
+    }
+    else if (*end == 'm' || *end == 'M'){
+        size *= 1024 * 1024;
+        end++;
+    }
+    if (errno != 0 || end == value || *end != '\0' || *value == '-' || size < min || size > max){
+        compile_error(0, "invalid argument `%s' to `%s'", value, option);
+    }
+    return (size_t)size;
+}
+
+/**
+ *
+ * \brief: converts the argument of -type into the matching S_IFMT value
+ *
+ * \param parms is the type parameter [bcdpfls]
+ *
+ * \return the file type bits
+ *
+ */
+
+static mode_t parse_type(const char *parms){
+    if (parms[0] != '\0' && parms[1] == '\0'){
+        switch (parms[0]){
+            case 'd': return S_IFDIR;  // is Directory
+            case 'c': return S_IFCHR;  // is char special file
+            case 'b': return S_IFBLK;  // is block special file
+            case 'p': return S_IFIFO;  // is  FIFO(named pipe)
+            case 'l': return S_IFLNK;  //is symbolic link
+            case 's': return S_IFSOCK; // is socket
+            case 'f': return S_IFREG;  // is „normal“ file
+            default: break;
+        }
+    }
+    compile_error(0, "Unknown type: %s", parms);
+    return 0;
+}
+
+/**
+ *
+ * \brief: classifies a -name or -path pattern so most patterns avoid fnmatch
+ *
+ * Patterns that are a literal with optional leading and/or trailing stars are matched
+ * with memcmp and memmem, everything else is left to fnmatch.
+ *
+ * \param glob - the pattern as given
+ * \param icase - 1 to match regardless of case
+ *
+ * \return the compiled pattern
+ *
+ */
+
+static struct pattern *compile_pattern(const char *glob, int icase){
+    struct pattern *pat = xmalloc(sizeof(*pat));
+    const char *start = glob;
+    const char *end = glob + strlen(glob);
+    int lead = 0;
+    int trail = 0;
+    while (*start == '*'){
+        start++;
+        lead = 1;
+    }
+    while (end > start && end[-1] == '*'){
+        end--;
+        trail = 1;
+    }
+    pat->glob = glob;
+    pat->icase = icase;
+    pat->litlen = (size_t)(end - start);
+    pat->lit = xmalloc(pat->litlen + 1);
+    for (size_t i = 0; i < pat->litlen; i++){
+        pat->lit[i] = icase ? (char)tolower((unsigned char)start[i]) : start[i];
+    }
+    pat->lit[pat->litlen] = '\0';
+
+    if (memchr(start, '*', pat->litlen) != NULL || memchr(start, '?', pat->litlen) != NULL || memchr(start, '[', pat->litlen) != NULL){
+        pat->kind = MATCH_GLOB;
+    }
+    else if (lead && (trail || pat->litlen == 0)){
+        pat->kind = MATCH_CONTAINS;
+    }
+    else if (lead){
+        pat->kind = MATCH_SUFFIX;
+    }
+    else if (trail){
+        pat->kind = MATCH_PREFIX;
+    }
+    else {
+        pat->kind = MATCH_EXACT;
+    }
+    return pat;
+}
+
+/**
+ *
+ * \brief: matches a string against a compiled pattern
+ *
+ * \param pat - the compiled pattern
+ * \param str - the name or path
+ * \param len - its length
+ *
+ * \return 1 if it matches, 0 otherwise
+ *
+ */
+
+static int match_pattern(const struct pattern *pat, const char *str, size_t len){
+    int control;
+    switch (pat->kind){
+        case MATCH_EXACT:
+            if (len != pat->litlen){
+                return 0;
+            }
+            return pat->icase ? strncasecmp(str, pat->lit, len) == 0 : memcmp(str, pat->lit, len) == 0;
+        case MATCH_PREFIX:
+            if (len < pat->litlen){
+                return 0;
+            }
+            return pat->icase ? strncasecmp(str, pat->lit, pat->litlen) == 0 : memcmp(str, pat->lit, pat->litlen) == 0;
+        case MATCH_SUFFIX:
+            if (len < pat->litlen){
+                return 0;
+            }
+            str += len - pat->litlen;
+            return pat->icase ? strncasecmp(str, pat->lit, pat->litlen) == 0 : memcmp(str, pat->lit, pat->litlen) == 0;
+        case MATCH_CONTAINS:
+            if (len < pat->litlen){
+                return 0;
+            }
+            return pat->icase ? strcasestr(str, pat->lit) != NULL : memmem(str, len, pat->lit, pat->litlen) != NULL;
+        case MATCH_GLOB:
+            break;
+    }
+    errno=0;
+    if ((control=fnmatch(pat->glob, str, FNM_NOESCAPE | (pat->icase ? FNM_CASEFOLD : 0))) == 0){
+        return 1;
+    }
+    if (control != FNM_NOMATCH){
+        error(1, errno, "FNMATCH %s %s\n", pat->glob, str);
+    }
+    return 0;
+}
+
+/**
+ *
+ * \brief: matches a name or path against the pattern or pattern set of a node
+ *
+ * \param e - -name, -path or one of their variants
+ * \param str - the name or path
+ * \param len - its length
+ *
+ * \return 1 if it matches, 0 otherwise
+ *
+ */
+
+static int match_expr(const struct expr *e, const char *str, size_t len){
+    if (e->kind == EXPR_NAME_FROM || e->kind == EXPR_PATH_FROM){
+        return match_patset(e->arg.set, str, len);
+    }
+    return match_pattern(e->arg.pat, str, len);
+}
+
+/**
+ *
+ * \brief: creates an empty pattern set, patterns are added with patset_add
+ *
+ * \return the set
+ *
+ */
+
+static struct patset *patset_new(void){
+    struct patset *set = xmalloc(sizeof(*set));
+    memset(set, 0, sizeof(*set));
+    set->exact_cap = STRSET_INITIAL;
+    set->exact = xmalloc(set->exact_cap * sizeof(*set->exact));
+    memset(set->exact, 0, set->exact_cap * sizeof(*set->exact));
+    return set;
+}
+
+/**
+ *
+ * \brief: reads the patterns of -name-from or -path-from, one per line
+ *
+ * Empty lines are ignored.
+ *
+ * \param file - the pattern file
+ *
+ * \return the compiled set
+ *
+ */
+
+static struct patset *load_patset(const char *file){
+    struct patset *set;
+    FILE *fp;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    if ((fp = fopen(file, "re")) == NULL){
+        compile_error(errno, "%s", file);
+    }
+    set = patset_new();
+    while ((len = getline(&line, &size, fp)) != -1){
+        if (len > 0 && line[len - 1] == '\n'){
+            line[--len] = '\0';
+        }
+        if (len > 0){
+            patset_add(set, strdup(line));
+        }
+    }
+    int err = ferror(fp) ? errno : 0;
+    free(line);
+    fclose(fp);
+    if (err != 0){
+        patset_free(set);
+        compile_error(err, "%s", file);
+    }
+    patset_finish(set);
+    return set;
+}
+
+/**
+ *
+ * \brief: sorts one pattern into the matcher of its kind
+ *
+ * \param set - the set being built
+ * \param glob - the pattern, owned by the set from now on
+ *
+ */
+
+static void patset_add(struct patset *set, char *glob){
+    if (glob == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    struct pattern *pat = compile_pattern(glob, 0);
+    const char *lit;
+    size_t litlen;
+    int node;
+
+    switch (pat->kind){
+        case MATCH_EXACT:
+            if (2 * (set->nexact + 1) > set->exact_cap){
+                size_t cap = set->exact_cap * 2;
+                char **slots = xmalloc(cap * sizeof(*slots));
+                memset(slots, 0, cap * sizeof(*slots));
+                for (size_t i = 0; i < set->exact_cap; i++){
+                    if (set->exact[i] != NULL){
+                        size_t j = strset_hash(set->exact[i], strlen(set->exact[i])) & (cap - 1);
+                        while (slots[j] != NULL){
+                            j = (j + 1) & (cap - 1);
+                        }
+                        slots[j] = set->exact[i];
+                    }
+                }
+                free(set->exact);
+                set->exact = slots;
+                set->exact_cap = cap;
+            }
+            for (size_t j = strset_hash(pat->lit, pat->litlen) & (set->exact_cap - 1); ; j = (j + 1) & (set->exact_cap - 1)){
+                if (set->exact[j] == NULL){
+                    set->exact[j] = pat->lit;
+                    set->nexact++;
+                    break;
+                }
+                if (strcmp(set->exact[j], pat->lit) == 0){
+                    break;
+                }
+            }
+            break;
+        case MATCH_PREFIX:
+            node = trie_add(&set->prefix, pat->lit, pat->litlen, 0);
+            set->prefix.nodes[node].term = 1;
+            break;
+        case MATCH_SUFFIX:
+            node = trie_add(&set->suffix, pat->lit, pat->litlen, 1);
+            set->suffix.nodes[node].term = 1;
+            break;
+        case MATCH_CONTAINS:
+            if (pat->litlen == 0){
+                set->match_all = 1;
+            }
+            else {
+                node = trie_add(&set->contains, pat->lit, pat->litlen, 0);
+                set->contains.nodes[node].term = 1;
+            }
+            break;
+        case MATCH_GLOB:
+            set->globs = xrealloc(set->globs, (set->nglobs + 1) * sizeof(*set->globs));
+            set->globs[set->nglobs] = glob;
+            if ((litlen = glob_literal(glob, &lit)) == 0){
+                set->always = xrealloc(set->always, (set->nalways + 1) * sizeof(*set->always));
+                set->always[set->nalways++] = set->nglobs;
+            }
+            else {
+                node = trie_add(&set->contains, lit, litlen, 0);
+                set->glob_next = xrealloc(set->glob_next, (set->nglob_links + 1) * sizeof(*set->glob_next));
+                set->glob_of = xrealloc(set->glob_of, (set->nglob_links + 1) * sizeof(*set->glob_of));
+                set->glob_of[set->nglob_links] = (int)set->nglobs;
+                set->glob_next[set->nglob_links] = set->contains.nodes[node].globs;
+                set->contains.nodes[node].globs = (int)set->nglob_links++;
+            }
+            set->nglobs++;
+            break;
+    }
+    if (pat->kind != MATCH_EXACT){
+        free(pat->lit);
+    }
+    if (pat->kind != MATCH_GLOB){		//fnmatch is not needed for it
+        free(glob);
+    }
+    free(pat);
+}
+
+/**
+ *
+ * \brief: finds the longest run of literal characters of a glob
+ *
+ * Any match of the glob contains this run, so it can be searched for
+ * before fnmatch is called.
+ *
+ * \param glob - the pattern
+ * \param lit - set to the start of the run
+ *
+ * \return length of the run, 0 if the glob has no literal characters
+ *
+ */
+
+static size_t glob_literal(const char *glob, const char **lit){
+    const char *run = glob;
+    size_t best = 0;
+
+    *lit = glob;
+    for (const char *c = glob; ; c++){
+        if (*c == '\0' || *c == '*' || *c == '?' || *c == '['){
+            if ((size_t)(c - run) > best){
+                best = (size_t)(c - run);
+                *lit = run;
+            }
+            if (*c == '\0'){
+                break;
+            }
+            if (*c == '['){
+                const char *close = c + 1;
+                if (*close == '!' || *close == '^'){
+                    close++;
+                }
+                if (*close == ']'){
+                    close++;
+                }
+                close = strchr(close, ']');
+                if (close == NULL){
+                    break;      //fnmatch takes the '[' literally, simply stop looking
+                }
+                c = close;
+            }
+            run = c + 1;
+        }
+    }
+    return best;
+}
+
+/**
+ *
+ * \brief: hashes a name for the set of exact names (FNV-1a)
+ *
+ */
+
+static size_t strset_hash(const char *s, size_t len){
+    size_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++){
+        h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ *
+ * \brief: finds the child of a trie node for one byte
+ *
+ * \return the child, 0 if there is none
+ *
+ */
+
+static int trie_child(const struct trie *t, int node, unsigned char byte){
+    if (node == 0){
+        return t->root[byte];
+    }
+    for (int c = t->nodes[node].child; c != 0; c = t->nodes[c].sibling){
+        if (t->nodes[c].byte == byte){
+            return c;
+        }
+    }
+    return 0;
+}
+
+/**
+ *
+ * \brief: inserts a literal into a trie
+ *
+ * \param t - the trie, an empty one is set up on first use
+ * \param lit - the literal
+ * \param len - its length
+ * \param reverse - 1 to insert it from the last byte to the first
+ *
+ * \return the node the literal ends in
+ *
+ */
+
+static int trie_add(struct trie *t, const char *lit, size_t len, int reverse){
+    int node = 0;
+    if (t->nodes == NULL){
+        t->cap = 16;
+        t->nodes = xmalloc(t->cap * sizeof(*t->nodes));
+        memset(&t->nodes[0], 0, sizeof(t->nodes[0]));
+        t->nodes[0].globs = -1;
+        t->count = 1;
+    }
+    for (size_t i = 0; i < len; i++){
+        unsigned char byte = (unsigned char)lit[reverse ? len - 1 - i : i];
+        int next = trie_child(t, node, byte);
+        if (next == 0){
+            if (t->count == t->cap){
+                t->cap *= 2;
+                t->nodes = xrealloc(t->nodes, t->cap * sizeof(*t->nodes));
+            }
+            next = (int)t->count++;
+            memset(&t->nodes[next], 0, sizeof(t->nodes[next]));
+            t->nodes[next].byte = byte;
+            t->nodes[next].globs = -1;
+            if (node == 0){
+                t->root[byte] = next;
+            }
+            else {
+                t->nodes[next].sibling = t->nodes[node].child;
+                t->nodes[node].child = next;
+            }
+        }
+        node = next;
+    }
+    return node;
+}
+
+/**
+ *
+ * \brief: computes the failure and dictionary links of the Aho-Corasick automaton
+ *
+ * Nodes are visited breadth first; a node inherits the terminal flag of its
+ * failure node, so one check per byte is enough while matching.
+ *
+ * \param t - the trie of the *lit* literals and glob runs
+ *
+ */
+
+static void trie_link(struct trie *t){
+    int *queue;
+    size_t head = 0;
+    size_t tail = 0;
+    if (t->nodes == NULL){
+        return;
+    }
+    queue = xmalloc(t->count * sizeof(*queue));
+    for (int b = 0; b < 256; b++){
+        if (t->root[b] != 0){
+            t->nodes[t->root[b]].fail = 0;
+            t->nodes[t->root[b]].dict = 0;
+            queue[tail++] = t->root[b];
+        }
+    }
+    while (head < tail){
+        int node = queue[head++];
+        for (int c = t->nodes[node].child; c != 0; c = t->nodes[c].sibling){
+            int f = t->nodes[node].fail;
+            int next;
+            while ((next = trie_child(t, f, t->nodes[c].byte)) == 0 && f != 0){
+                f = t->nodes[f].fail;
+            }
+            t->nodes[c].fail = next;
+            t->nodes[c].term |= t->nodes[next].term;
+            t->nodes[c].dict = t->nodes[next].globs != -1 ? next : t->nodes[next].dict;
+            queue[tail++] = c;
+        }
+    }
+    free(queue);
+}
+
+/**
+ *
+ * \brief: builds the automaton once all patterns are added
+ *
+ */
+
+static void patset_finish(struct patset *set){
+    trie_link(&set->contains);
+}
+
+/**
+ *
+ * \brief: matches a name or path against all patterns of a set
+ *
+ * The cost depends on the length of the string and not on the number of patterns,
+ * apart from globs whose literal run occurs in the string.
+ *
+ * \param set - the compiled set
+ * \param str - the name or path
+ * \param len - its length
+ *
+ * \return 1 if any pattern matches, 0 otherwise
+ *
+ */
+
+static int match_patset(const struct patset *set, const char *str, size_t len){
+    const struct trie *t;
+    int node;
+    if (set->match_all){
+        return 1;
+    }
+    if (set->nexact > 0){
+        for (size_t j = strset_hash(str, len) & (set->exact_cap - 1); set->exact[j] != NULL; j = (j + 1) & (set->exact_cap - 1)){
+            if (strncmp(set->exact[j], str, len) == 0 && set->exact[j][len] == '\0'){
+                return 1;
+            }
+        }
+    }
+    if ((t = &set->prefix)->nodes != NULL){
+        node = 0;
+        for (size_t i = 0; i < len && (node = trie_child(t, node, (unsigned char)str[i])) != 0; i++){
+            if (t->nodes[node].term){
+                return 1;
+            }
+        }
+    }
+    if ((t = &set->suffix)->nodes != NULL){
+        node = 0;
+        for (size_t i = len; i > 0 && (node = trie_child(t, node, (unsigned char)str[i - 1])) != 0; i--){
+            if (t->nodes[node].term){
+                return 1;
+            }
+        }
+    }
+    if ((t = &set->contains)->nodes != NULL){
+        node = 0;
+        for (size_t i = 0; i < len; i++){
+            unsigned char byte = (unsigned char)str[i];
+            int next;
+            while ((next = trie_child(t, node, byte)) == 0 && node != 0){
+                node = t->nodes[node].fail;
+            }
+            node = next;
+            if (t->nodes[node].term){
+                return 1;
+            }
+            for (int d = t->nodes[node].globs != -1 ? node : t->nodes[node].dict; d != 0; d = t->nodes[d].dict){
+                for (int g = t->nodes[d].globs; g != -1; g = set->glob_next[g]){
+                    if (fnmatch(set->globs[set->glob_of[g]], str, FNM_NOESCAPE) == 0){
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < set->nalways; i++){
+        if (fnmatch(set->globs[set->always[i]], str, FNM_NOESCAPE) == 0){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ *
+ * \brief: compiles the argument of -regex or -iregex
+ *
+ * regcomp checks the syntax first, so the errors are the ones of the C library. The expression
+ * is then parsed again into a syntax tree, from which the literals for the prefilter are taken
+ * and the NFA is built. If the tree uses something the NFA does not support, regexec matches it.
+ * The process has to stay in a single byte locale for the NFA, find does not call setlocale.
+ *
+ * \param value - the expression
+ * \param option - -regex or -iregex, for the error message
+ * \param icase - 1 to ignore case
+ *
+ * \return the compiled expression, the program terminates if it is invalid
+ *
+ */
+
+static struct regex *compile_regex(const char *value, const char *option, int icase){
+    struct regex *re = xmalloc(sizeof(*re));
+    struct rx_parser p;
+    int rc;
+    memset(re, 0, sizeof(*re));
+    re->icase = icase;
+    if ((rc = regcomp(&re->compiled, value, REG_EXTENDED | (icase ? REG_ICASE : 0))) != 0){
+        char msg[256];
+        regerror(rc, &re->compiled, msg, sizeof(msg));
+        free(re);
+        compile_error(0, "invalid regular expression `%s' to `%s': %s", value, option, msg);
+    }
+    memset(&p, 0, sizeof(p));
+    p.s = value;
+    p.re = re;
+    p.icase = icase;
+    int root = MB_CUR_MAX == 1 ? rx_parse_alt(&p) : -1;		//in multibyte locales "." is a character, not a byte
+    if (root >= 0 && *p.s != '\0'){
+        root = -1;
+    }
+    if (root >= 0){
+        struct rx_lit lit;
+        rx_literals(re, &p, root, &lit);
+        memcpy(re->prefix, lit.prefix, lit.prefixlen);
+        re->prefixlen = lit.prefixlen;
+        memcpy(re->suffix, lit.suffix, lit.suffixlen);
+        re->suffixlen = lit.suffixlen;
+        re->exact = lit.exact;
+        if ((lit.requiredlen != lit.prefixlen || memcmp(lit.required, lit.prefix, lit.prefixlen) != 0) &&
+            (lit.requiredlen != lit.suffixlen || memcmp(lit.required, lit.suffix, lit.suffixlen) != 0)){		//already checked at its place
+            memcpy(re->required, lit.required, lit.requiredlen);
+            re->requiredlen = lit.requiredlen;
+        }
+        re->nfa = xmalloc(REGEX_NFA_MAX * sizeof(*re->nfa));
+        int match = nfa_add(re, NFA_MATCH, -1, -1, -1);
+        re->start = rx_emit(re, &p, root, match);
+        if (re->start < 0){		//too many states after the repetitions were expanded
+            free(re->nfa);
+            re->nfa = NULL;
+            re->nnfa = 0;
+        }
+        else {
+            re->nfa = xrealloc(re->nfa, (size_t)re->nnfa * sizeof(*re->nfa));
+            rx_classes(re);
+        }
+    }
+    free(p.nodes);
+    return re;
+}
+
+/**
+ *
+ * \brief: parses alternatives: branch | branch ...
+ *
+ * The parsers return the index of the node, or -1 if the NFA does not support the syntax.
+ *
+ * \param p - parser state
+ *
+ * \return the node, -1 if regexec has to match the expression
+ *
+ */
+
+static int rx_parse_alt(struct rx_parser *p){
+    int left = rx_parse_cat(p);
+    while (left >= 0 && *p->s == '|'){
+        p->s++;
+        int right = rx_parse_cat(p);
+        left = right < 0 ? -1 : rx_node(p, RX_ALT, left, right);
+    }
+    return left;
+}
+
+/**
+ *
+ * \brief: parses a branch, the pieces up to the next | or )
+ *
+ * \param p - parser state
+ *
+ * \return the node, -1 if regexec has to match the expression
+ *
+ */
+
+static int rx_parse_cat(struct rx_parser *p){
+    int node = rx_node(p, RX_EMPTY, -1, -1);
+    int first = 1;
+    while (node >= 0 && *p->s != '\0' && *p->s != '|' && *p->s != ')'){
+        int piece = rx_parse_repeat(p);
+        if (piece < 0){
+            return -1;
+        }
+        node = first ? piece : rx_node(p, RX_CAT, node, piece);
+        first = 0;
+    }
+    return node;
+}
+
+/**
+ *
+ * \brief: parses an atom and the *, +, ? and {m,n} after it
+ *
+ * \param p - parser state
+ *
+ * \return the node, -1 if regexec has to match the expression
+ *
+ */
+
+static int rx_parse_repeat(struct rx_parser *p){
+    int node = rx_parse_atom(p);
+    while (node >= 0){
+        long min;
+        long max;
+        if (*p->s == '*'){
+            min = 0;
+            max = -1;
+        }
+        else if (*p->s == '+'){
+            min = 1;
+            max = -1;
+        }
+        else if (*p->s == '?'){
+            min = 0;
+            max = 1;
+        }
+        else if (*p->s == '{'){
+            char *end;
+            if (!isdigit((unsigned char)p->s[1])){		//{,n} and a literal { are left to regexec
+                return -1;
+            }
+            min = strtol(p->s + 1, &end, 10);
+            max = min;
+            if (*end == ','){
+                end++;
+                max = isdigit((unsigned char)*end) ? strtol(end, &end, 10) : -1;
+            }
+            if (*end != '}' || min > RE_DUP_MAX || max > RE_DUP_MAX || (max != -1 && max < min)){
+                return -1;
+            }
+            p->s = end;
+        }
+        else {
+            return node;
+        }
+        p->s++;
+        int rep = rx_node(p, RX_REPEAT, node, -1);
+        if (rep >= 0){
+            p->nodes[rep].min = (int)min;
+            p->nodes[rep].max = (int)max;
+        }
+        node = rep;
+    }
+    return node;
+}
+
+/**
+ *
+ * \brief: parses a group, a bracket expression, an anchor, "." or a single character
+ *
+ * \param p - parser state
+ *
+ * \return the node, -1 if regexec has to match the expression
+ *
+ */
+
+static int rx_parse_atom(struct rx_parser *p){
+    unsigned char c = (unsigned char)*p->s++;
+    int node;
+    switch (c){
+        case '(':
+            if (++p->depth > REGEX_NODES_MAX / 4){
+                return -1;
+            }
+            node = rx_parse_alt(p);
+            if (node < 0 || *p->s != ')'){
+                return -1;
+            }
+            p->s++;
+            p->depth--;
+            return node;
+        case '*':
+        case '+':
+        case '?':
+        case '{':		//a repetition without an atom
+            return -1;
+        case '^':
+            return rx_node(p, RX_BOL, -1, -1);
+        case '$':
+            return rx_node(p, RX_EOL, -1, -1);
+        case '[':
+            return rx_parse_bracket(p);
+        case '.':
+            if ((node = rx_literal(p, 1)) >= 0){
+                struct rx_set *set = &p->re->sets[p->nodes[node].set];
+                memset(set->bits, 0xff, sizeof(set->bits));
+                set->bits[0] &= ~(uint64_t)1;		//any byte but the null byte
+            }
+            return node;
+        case '\\':
+            c = (unsigned char)*p->s++;
+            if (c != '\0' && strchr(".[]()*+?{}|^$\\", c) != NULL){
+                return rx_literal(p, c);
+            }
+            if (c == 'w' || c == 'W' || c == 's' || c == 'S'){		//GNU extensions, a back reference or word boundary goes to regexec
+                if ((node = rx_literal(p, 1)) >= 0){
+                    struct rx_set *set = &p->re->sets[p->nodes[node].set];
+                    set->bits[0] = 0;
+                    for (int b = 1; b < 256; b++){
+                        int in = c == 'w' || c == 'W' ? isalnum(b) || b == '_' : isspace(b);
+                        if (in == (c == 'w' || c == 's')){
+                            set->bits[b / 64] |= (uint64_t)1 << (b % 64);
+                        }
+                    }
+                }
+                return node;
+            }
+            return -1;
+        default:
+            return rx_literal(p, c);
+    }
+}
+
+/**
+ *
+ * \brief: parses a bracket expression, the [ is already read
+ *
+ * Ranges compare byte values like the C locale does. Equivalence classes and collating
+ * elements are left to regexec.
+ *
+ * \param p - parser state
+ *
+ * \return the node, -1 if regexec has to match the expression
+ *
+ */
+
+static int rx_parse_bracket(struct rx_parser *p){
+    static const struct {
+        const char *name;
+        int (*test)(int);
+    } classes[] = {
+        {"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum}, {"upper", isupper},
+        {"lower", islower}, {"space", isspace}, {"blank", isblank}, {"punct", ispunct},
+        {"print", isprint}, {"graph", isgraph}, {"cntrl", iscntrl}, {"xdigit", isxdigit},
+    };
+    int node = rx_literal(p, 0);
+    if (node < 0){
+        return -1;
+    }
+    struct rx_set *set = &p->re->sets[p->nodes[node].set];
+    int negate = *p->s == '^';
+    set->bits[0] = 0;
+    p->s += negate;
+    for (int first = 1; *p->s != ']' || first; first = 0){
+        unsigned char lo = (unsigned char)*p->s;
+        unsigned char hi;
+        if (lo == '\0'){
+            return -1;
+        }
+        if (lo == '[' && p->s[1] == ':'){
+            const char *end = strstr(p->s + 2, ":]");
+            size_t k = 0;
+            while (end != NULL && k < sizeof(classes) / sizeof(classes[0]) &&
+                   (strlen(classes[k].name) != (size_t)(end - p->s - 2) || strncmp(classes[k].name, p->s + 2, (size_t)(end - p->s - 2)) != 0)){
+                k++;
+            }
+            if (end == NULL || k == sizeof(classes) / sizeof(classes[0])){
+                return -1;
+            }
+            for (int b = 1; b < 256; b++){
+                if (classes[k].test(b)){
+                    set->bits[b / 64] |= (uint64_t)1 << (b % 64);
+                }
+            }
+            p->s = end + 2;
+            continue;
+        }
+        if (lo == '[' && (p->s[1] == '=' || p->s[1] == '.')){
+            return -1;
+        }
+        hi = lo;
+        p->s++;
+        if (*p->s == '-' && p->s[1] != ']' && p->s[1] != '\0'){
+            hi = (unsigned char)p->s[1];
+            if (hi == '[' || hi < lo){
+                return -1;
+            }
+            p->s += 2;
+        }
+        for (int b = lo; b <= hi; b++){
+            set->bits[b / 64] |= (uint64_t)1 << (b % 64);
+        }
+    }
+    p->s++;
+    if (p->icase){
+        for (int b = 'a'; b <= 'z'; b++){
+            int u = toupper(b);
+            if ((set->bits[b / 64] >> (b % 64) | set->bits[u / 64] >> (u % 64)) & 1){
+                set->bits[b / 64] |= (uint64_t)1 << (b % 64);
+                set->bits[u / 64] |= (uint64_t)1 << (u % 64);
+            }
+        }
+    }
+    if (negate){
+        for (int i = 0; i < 4; i++){
+            set->bits[i] = ~set->bits[i];
+        }
+    }
+    set->bits[0] &= ~(uint64_t)1;
+    return node;
+}
+
+/**
+ *
+ * \brief: adds a node to the syntax tree
+ *
+ * \param p - parser state
+ * \param kind - the kind of node
+ * \param left - first child, -1 if none
+ * \param right - second child, -1 if none
+ *
+ * \return the node, -1 if the tree became too large for the NFA
+ *
+ */
+
+static int rx_node(struct rx_parser *p, enum rx_kind kind, int left, int right){
+    if (p->nnodes == REGEX_NODES_MAX){
+        return -1;
+    }
+    if (p->nnodes == p->cap){
+        p->cap = p->cap ? p->cap * 2 : 64;
+        p->nodes = xrealloc(p->nodes, (size_t)p->cap * sizeof(*p->nodes));
+    }
+    struct rx_node *n = &p->nodes[p->nnodes];
+    n->kind = kind;
+    n->left = left;
+    n->right = right;
+    n->set = -1;
+    n->min = 0;
+    n->max = 0;
+    return p->nnodes++;
+}
+
+/**
+ *
+ * \brief: adds a node matching one byte, with -iregex also the other case of a letter
+ *
+ * \param p - parser state
+ * \param c - the byte, the caller may change the set afterwards
+ *
+ * \return the node, -1 if the tree became too large for the NFA
+ *
+ */
+
+static int rx_literal(struct rx_parser *p, unsigned char c){
+    int node = rx_node(p, RX_SET, -1, -1);
+    if (node < 0){
+        return -1;
+    }
+    struct regex *re = p->re;
+    re->sets = xrealloc(re->sets, (re->nsets + 1) * sizeof(*re->sets));
+    struct rx_set *set = &re->sets[re->nsets];
+    memset(set, 0, sizeof(*set));
+    set->bits[c / 64] |= (uint64_t)1 << (c % 64);
+    if (p->icase && isalpha(c)){
+        unsigned char other = islower(c) ? (unsigned char)toupper(c) : (unsigned char)tolower(c);
+        set->bits[other / 64] |= (uint64_t)1 << (other % 64);
+    }
+    p->nodes[node].set = (int)re->nsets++;
+    return node;
+}
+
+/**
+ *
+ * \brief: builds the NFA states of a node in front of the states that follow it
+ *
+ * The tree is compiled from the end, so the follower of every node is known when it is built.
+ * Counted repetitions are expanded into copies of their child.
+ *
+ * \param re - the expression, receives the states
+ * \param p - the parser holding the tree
+ * \param node - the node
+ * \param next - the state after the node
+ *
+ * \return the first state of the node, -1 if there are too many states
+ *
+ */
+
+static int rx_emit(struct regex *re, const struct rx_parser *p, int node, int next){
+    const struct rx_node *n = &p->nodes[node];
+    int state;
+    int other;
+    if (next < 0){
+        return -1;
+    }
+    switch (n->kind){
+        case RX_EMPTY:
+            return next;
+        case RX_SET:
+            return nfa_add(re, NFA_SET, n->set, next, -1);
+        case RX_BOL:
+            return nfa_add(re, NFA_BOL, -1, next, -1);
+        case RX_EOL:
+            return nfa_add(re, NFA_EOL, -1, next, -1);
+        case RX_CAT:
+            return rx_emit(re, p, n->left, rx_emit(re, p, n->right, next));
+        case RX_ALT:
+            state = rx_emit(re, p, n->left, next);
+            other = rx_emit(re, p, n->right, next);
+            return state < 0 || other < 0 ? -1 : nfa_add(re, NFA_SPLIT, -1, state, other);
+        case RX_REPEAT:
+            if (n->max == -1){		//a loop back to a split in front of the child
+                int loop = nfa_add(re, NFA_SPLIT, -1, -1, next);
+                if (loop < 0 || (state = rx_emit(re, p, n->left, loop)) < 0){
+                    return -1;
+                }
+                re->nfa[loop].out = state;
+                next = loop;
+            }
+            for (int i = n->min; i < n->max && next >= 0; i++){		//the optional copies, each may skip the rest
+                state = rx_emit(re, p, n->left, next);
+                next = state < 0 ? -1 : nfa_add(re, NFA_SPLIT, -1, state, next);
+            }
+            for (int i = 0; i < n->min && next >= 0; i++){
+                next = rx_emit(re, p, n->left, next);
+            }
+            return next;
+    }
+    return -1;
+}
+
+/**
+ *
+ * \brief: adds a state to the NFA
+ *
+ * \return the state, -1 if the NFA is full
+ *
+ */
+
+static int nfa_add(struct regex *re, enum nfa_op op, int set, int out, int out1){
+    if (re->nnfa == REGEX_NFA_MAX){
+        return -1;
+    }
+    struct nfa_state *st = &re->nfa[re->nnfa];
+    st->op = op;
+    st->set = set;
+    st->out = out;
+    st->out1 = out1;
+    return re->nnfa++;
+}
+
+/**
+ *
+ * \brief: finds the literals every match of a node contains
+ *
+ * prefix and suffix are what every match starts and ends with, required occurs somewhere in
+ * every match. For -iregex only sets holding the two cases of one letter count as literals,
+ * in lower case. Literals longer than REGEX_LIT_MAX are cut, which keeps them true.
+ *
+ * \param re - the expression, holds the byte sets
+ * \param p - the parser holding the tree
+ * \param node - the node
+ * \param lit - receives the literals
+ *
+ */
+
+static void rx_literals(const struct regex *re, const struct rx_parser *p, int node, struct rx_lit *lit){
+    const struct rx_node *n = &p->nodes[node];
+    struct rx_lit a;
+    struct rx_lit b;
+    memset(lit, 0, sizeof(*lit));
+    switch (n->kind){
+        case RX_EMPTY:
+            lit->exact = 1;
+            lit->fixed = 1;
+            break;
+        case RX_BOL:
+        case RX_EOL:		//not exact, "x^" matches nothing
+            lit->fixed = 1;
+            break;
+        case RX_SET: {
+            const struct rx_set *set = &re->sets[n->set];
+            int count = 0;
+            int byte = 0;
+            for (int c = 0; c < 256; c++){
+                if (set->bits[c / 64] >> (c % 64) & 1){
+                    count++;
+                    byte = c;
+                }
+            }
+            int upper = toupper(byte) & 0xff;
+            if (count == 1 || (count == 2 && re->icase && islower(byte) && set->bits[upper / 64] >> (upper % 64) & 1)){		//the upper case letter comes first
+                lit->exact = 1;
+                lit->fixed = 1;
+                lit->prefix[0] = lit->suffix[0] = lit->required[0] = (char)byte;
+                lit->prefixlen = lit->suffixlen = lit->requiredlen = 1;
+            }
+            break;
+        }
+        case RX_CAT: {
+            char joined[2 * REGEX_LIT_MAX];
+            rx_literals(re, p, n->left, &a);
+            rx_literals(re, p, n->right, &b);
+            lit->fixed = a.fixed && b.fixed && a.prefixlen + b.prefixlen <= REGEX_LIT_MAX;
+            lit->exact = lit->fixed && a.exact && b.exact;
+            memcpy(lit->prefix, a.prefix, a.prefixlen);
+            lit->prefixlen = a.prefixlen;
+            if (a.fixed){
+                size_t add = b.prefixlen < REGEX_LIT_MAX - a.prefixlen ? b.prefixlen : REGEX_LIT_MAX - a.prefixlen;
+                memcpy(lit->prefix + a.prefixlen, b.prefix, add);
+                lit->prefixlen += add;
+            }
+            if (b.fixed){		//the end of a, then all of b, cut at the front
+                size_t keep = a.suffixlen < REGEX_LIT_MAX - b.suffixlen ? a.suffixlen : REGEX_LIT_MAX - b.suffixlen;
+                memcpy(lit->suffix, a.suffix + a.suffixlen - keep, keep);
+                memcpy(lit->suffix + keep, b.suffix, b.suffixlen);
+                lit->suffixlen = keep + b.suffixlen;
+            }
+            else {
+                memcpy(lit->suffix, b.suffix, b.suffixlen);
+                lit->suffixlen = b.suffixlen;
+            }
+            memcpy(joined, a.suffix, a.suffixlen);		//what a ends with runs into what b starts with
+            memcpy(joined + a.suffixlen, b.prefix, b.prefixlen);
+            size_t len = a.suffixlen + b.prefixlen < REGEX_LIT_MAX ? a.suffixlen + b.prefixlen : REGEX_LIT_MAX;
+            const char *best = joined;
+            if (a.requiredlen > len){
+                best = a.required;
+                len = a.requiredlen;
+            }
+            if (b.requiredlen > len){
+                best = b.required;
+                len = b.requiredlen;
+            }
+            memcpy(lit->required, best, len);
+            lit->requiredlen = len;
+            break;
+        }
+        case RX_ALT:
+            rx_literals(re, p, n->left, &a);
+            rx_literals(re, p, n->right, &b);
+            lit->fixed = a.fixed && b.fixed && a.prefixlen == b.prefixlen && memcmp(a.prefix, b.prefix, a.prefixlen) == 0;
+            lit->exact = lit->fixed && a.exact && b.exact;
+            while (lit->prefixlen < a.prefixlen && lit->prefixlen < b.prefixlen && a.prefix[lit->prefixlen] == b.prefix[lit->prefixlen]){
+                lit->prefixlen++;
+            }
+            memcpy(lit->prefix, a.prefix, lit->prefixlen);
+            while (lit->suffixlen < a.suffixlen && lit->suffixlen < b.suffixlen &&
+                   a.suffix[a.suffixlen - 1 - lit->suffixlen] == b.suffix[b.suffixlen - 1 - lit->suffixlen]){
+                lit->suffixlen++;
+            }
+            memcpy(lit->suffix, a.suffix + a.suffixlen - lit->suffixlen, lit->suffixlen);
+            if (lit->prefixlen >= lit->suffixlen){
+                memcpy(lit->required, lit->prefix, lit->prefixlen);
+                lit->requiredlen = lit->prefixlen;
+            }
+            else {
+                memcpy(lit->required, lit->suffix, lit->suffixlen);
+                lit->requiredlen = lit->suffixlen;
+            }
+            break;
+        case RX_REPEAT:
+            if (n->max == 0){		//matches the empty string only
+                lit->exact = 1;
+                lit->fixed = 1;
+            }
+            else if (n->min > 0){
+                rx_literals(re, p, n->left, lit);
+                lit->fixed &= n->min == 1 && n->max == 1;
+                lit->exact &= lit->fixed;
+            }
+            break;
+    }
+}
+
+/**
+ *
+ * \brief: splits the byte values into classes none of the sets of the NFA tells apart
+ *
+ * The DFA keeps one transition per class instead of 256 per state.
+ *
+ * \param re - the expression
+ *
+ */
+
+static void rx_classes(struct regex *re){
+    int map[512];
+    memset(re->classes, 0, sizeof(re->classes));
+    re->nclasses = 1;
+    for (size_t i = 0; i < re->nsets; i++){		//every set splits the classes into bytes in it and bytes not in it
+        int n = 0;
+        memset(map, 0xff, sizeof(map));
+        for (int b = 0; b < 256; b++){
+            int k = re->classes[b] * 2 + (int)(re->sets[i].bits[b / 64] >> (b % 64) & 1);
+            if (map[k] < 0){
+                map[k] = n++;
+            }
+            re->classes[b] = (unsigned char)map[k];
+        }
+        re->nclasses = n;
+    }
+    for (int b = 255; b >= 0; b--){
+        re->rep[re->classes[b]] = (unsigned char)b;
+    }
+}
+
+/**
+ *
+ * \brief: matches a whole path against a -regex
+ *
+ * The literals are checked first, memmem and memcmp reject most paths before the DFA runs.
+ *
+ * \param re - the expression
+ * \param d - the DFA of the walker
+ * \param str - the path
+ * \param len - its length
+ *
+ * \return 1 if the path matches, 0 otherwise
+ *
+ */
+
+static int match_regex(const struct regex *re, struct dfa *d, const char *str, size_t len){
+    if (re->prefixlen > len || re->suffixlen > len){
+        return 0;
+    }
+    if (re->icase){
+        if (strncasecmp(str, re->prefix, re->prefixlen) != 0 ||
+            strncasecmp(str + len - re->suffixlen, re->suffix, re->suffixlen) != 0 ||
+            (re->requiredlen > 0 && strcasestr(str, re->required) == NULL)){
+            return 0;
+        }
+    }
+    else if (memcmp(str, re->prefix, re->prefixlen) != 0 ||
+             memcmp(str + len - re->suffixlen, re->suffix, re->suffixlen) != 0 ||
+             (re->requiredlen > 0 && memmem(str, len, re->required, re->requiredlen) == NULL)){
+        return 0;
+    }
+    if (re->exact){
+        return len == re->prefixlen;
+    }
+    if (re->nfa == NULL){		//leftmost longest: a match of the whole path is the one found
+        regmatch_t m;
+        return regexec(&re->compiled, str, 1, &m, 0) == 0 && m.rm_so == 0 && (size_t)m.rm_eo == len;
+    }
+    return dfa_match(re, d, str, len);
+}
+
+/**
+ *
+ * \brief: runs the DFA over a path, the missing transitions are built on the way
+ *
+ * \param re - the expression
+ * \param d - the DFA of the walker
+ * \param str - the path
+ * \param len - its length
+ *
+ * \return 1 if the path matches, 0 otherwise
+ *
+ */
+
+static int dfa_match(const struct regex *re, struct dfa *d, const char *str, size_t len){
+    if (d->next == NULL){
+        d->next = xmalloc((size_t)REGEX_DFA_STATES * (size_t)re->nclasses * sizeof(*d->next));
+        d->accept = xmalloc(REGEX_DFA_STATES);
+        d->off = xmalloc((REGEX_DFA_STATES + 1) * sizeof(*d->off));
+        d->table = xmalloc(2 * REGEX_DFA_STATES * sizeof(*d->table));
+        d->work = xmalloc((size_t)re->nnfa * sizeof(*d->work));
+        d->keep = xmalloc((size_t)re->nnfa * sizeof(*d->keep));
+        d->stack = xmalloc((4 * (size_t)re->nnfa + 2) * sizeof(*d->stack));
+        d->mark = xmalloc(2 * (size_t)re->nnfa * sizeof(*d->mark));
+        memset(d->mark, 0, 2 * (size_t)re->nnfa * sizeof(*d->mark));
+        d->gen = 0;
+        d->sets = NULL;
+        d->sets_cap = 0;
+        dfa_reset(re, d);
+    }
+    int state = d->start;
+    for (size_t i = 0; i < len; i++){
+        int cls = re->classes[(unsigned char)str[i]];
+        int to = d->next[(size_t)state * (size_t)re->nclasses + (size_t)cls];
+        if (to < 0){
+            to = dfa_step(re, d, state, cls);
+        }
+        if (to == 0){		//no NFA state is left
+            return 0;
+        }
+        state = to;
+    }
+    return d->accept[state];
+}
+
+/**
+ *
+ * \brief: builds the transition of a state on a byte class
+ *
+ * If the cache is full it starts over with the start state and the new state only, the
+ * caller goes on from the state returned.
+ *
+ * \param re - the expression
+ * \param d - the DFA of the walker
+ * \param from - the state
+ * \param cls - the byte class
+ *
+ * \return the state reached
+ *
+ */
+
+static int dfa_step(const struct regex *re, struct dfa *d, int from, int cls){
+    unsigned char byte = re->rep[cls];
+    int accept = 0;
+    dfa_generation(re, d);
+    d->nwork = 0;
+    for (size_t i = d->off[from]; i < d->off[from + 1]; i++){
+        const struct nfa_state *st = &re->nfa[d->sets[i]];
+        if (re->sets[st->set].bits[byte / 64] >> (byte % 64) & 1){
+            dfa_closure(re, d, st->out, 0, &accept);
+        }
+    }
+    int to = dfa_add(re, d, accept);
+    if (to < 0){
+        int n = d->nwork;
+        memcpy(d->keep, d->work, (size_t)n * sizeof(*d->work));
+        dfa_reset(re, d);
+        memcpy(d->work, d->keep, (size_t)n * sizeof(*d->work));
+        d->nwork = n;
+        return dfa_add(re, d, accept);
+    }
+    d->next[(size_t)from * (size_t)re->nclasses + (size_t)cls] = to;
+    return to;
+}
+
+/**
+ *
+ * \brief: empties the cache of a DFA, only the dead state and the start state are built again
+ *
+ * \param re - the expression
+ * \param d - the DFA of the walker
+ *
+ */
+
+static void dfa_reset(const struct regex *re, struct dfa *d){
+    int accept = 0;
+    memset(d->table, 0, 2 * REGEX_DFA_STATES * sizeof(*d->table));
+    d->nstates = 0;
+    d->off[0] = 0;
+    d->nwork = 0;
+    dfa_add(re, d, 0);
+    for (int c = 0; c < re->nclasses; c++){		//the dead state stays dead
+        d->next[c] = 0;
+    }
+    dfa_generation(re, d);
+    dfa_closure(re, d, re->start, 1, &accept);
+    d->start = dfa_add(re, d, accept);
+}
+
+/**
+ * \brief starts a new generation of the marks of the closure, they are cleared when the counter wraps
+ */
+
+static void dfa_generation(const struct regex *re, struct dfa *d){
+    if (++d->gen == 0){
+        memset(d->mark, 0, 2 * (size_t)re->nnfa * sizeof(*d->mark));
+        d->gen = 1;
+    }
+}
+
+/**
+ *
+ * \brief: adds the NFA states reachable from a state without consuming a byte to the work list
+ *
+ * Past a $ only the match state counts, no byte may follow. A ^ is only passed before the
+ * first byte.
+ *
+ * \param re - the expression
+ * \param d - the DFA of the walker, its marks belong to the current step
+ * \param state - the NFA state
+ * \param bol - 1 before the first byte
+ * \param accept - set to 1 if the match state is reached
+ *
+ */
+
+static void dfa_closure(const struct regex *re, struct dfa *d, int state, int bol, int *accept){
+    int top = 0;
+    d->stack[top++] = state * 2;
+    while (top > 0){
+        int item = d->stack[--top];
+        int s = item / 2;
+        int end = item % 2;		//1 once a $ was passed
+        if (d->mark[item] == d->gen){
+            continue;
+        }
+        d->mark[item] = d->gen;
+        const struct nfa_state *st = &re->nfa[s];
+        switch (st->op){
+            case NFA_SET:
+                if (!end){
+                    d->work[d->nwork++] = s;
+                }
+                break;
+            case NFA_MATCH:
+                *accept = 1;
+                break;
+            case NFA_SPLIT:
+                d->stack[top++] = st->out1 * 2 + end;
+                d->stack[top++] = st->out * 2 + end;
+                break;
+            case NFA_BOL:
+                if (bol){
+                    d->stack[top++] = st->out * 2 + end;
+                }
+                break;
+            case NFA_EOL:
+                d->stack[top++] = st->out * 2 + 1;
+                break;
+        }
+    }
+}
+
+/**
+ *
+ * \brief: looks the work list up among the states, a new state is added if it is missing
+ *
+ * \param re - the expression
+ * \param d - the DFA of the walker
+ * \param accept - 1 if the path matches when it ends in the state
+ *
+ * \return the state, -1 if the cache is full
+ *
+ */
+
+static int dfa_add(const struct regex *re, struct dfa *d, int accept){
+    size_t n = (size_t)d->nwork;
+    uint32_t hash = 2166136261u ^ (uint32_t)accept;
+    for (size_t i = 1; i < n; i++){		//insertion sort, the lists are short and mostly sorted
+        int v = d->work[i];
+        size_t j = i;
+        while (j > 0 && d->work[j - 1] > v){
+            d->work[j] = d->work[j - 1];
+            j--;
+        }
+        d->work[j] = v;
+    }
+    for (size_t i = 0; i < n; i++){
+        hash = (hash ^ (uint32_t)d->work[i]) * 16777619u;
+    }
+    size_t slot = hash & (2 * REGEX_DFA_STATES - 1);
+    for (; d->table[slot] != 0; slot = (slot + 1) & (2 * REGEX_DFA_STATES - 1)){
+        int s = d->table[slot] - 1;
+        if (d->accept[s] == accept && d->off[s + 1] - d->off[s] == n && (n == 0 || memcmp(d->sets + d->off[s], d->work, n * sizeof(*d->work)) == 0)){
+            return s;
+        }
+    }
+    if (d->nstates == REGEX_DFA_STATES){
+        return -1;
+    }
+    int s = d->nstates++;
+    if (d->off[s] + n > d->sets_cap){
+        d->sets_cap = (d->off[s] + n) * 2;
+        d->sets = xrealloc(d->sets, d->sets_cap * sizeof(*d->sets));
+    }
+    if (n > 0){
+        memcpy(d->sets + d->off[s], d->work, n * sizeof(*d->work));
+    }
+    d->off[s + 1] = d->off[s] + n;
+    d->accept[s] = (char)accept;
+    memset(d->next + (size_t)s * (size_t)re->nclasses, 0xff, (size_t)re->nclasses * sizeof(*d->next));
+    d->table[slot] = s + 1;
+    return s;
+}
+
+/**
+ * \brief releases the DFA of a walker
+ */
+
+static void dfa_free(struct dfa *d){
+    free(d->next);
+    free(d->accept);
+    free(d->off);
+    free(d->sets);
+    free(d->table);
+    free(d->work);
+    free(d->keep);
+    free(d->stack);
+    free(d->mark);
+}
+
+/**
+ * \brief releases a compiled -regex
+ */
+
+static void regex_free(struct regex *re){
+    if (re == NULL){
+        return;
+    }
+    regfree(&re->compiled);
+    free(re->nfa);
+    free(re->sets);
+    free(re);
+}
+
+/**
+ *
+ * \brief: compiles the argument of -contains
+ *
+ * \param value - the string the files are searched for
+ *
+ * \return the compiled string
+ *
+ */
+
+static struct needles *compile_needles(const char *value){
+    struct needles *nd = xmalloc(sizeof(*nd));
+    memset(nd, 0, sizeof(*nd));
+    if ((nd->str = strdup(value)) == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    nd->len = strlen(value);
+    nd->count = 1;
+    nd->maxlen = nd->len > 0 ? nd->len : 1;
+    nd->match_all = nd->len == 0;
+    return nd;
+}
+
+/**
+ *
+ * \brief: reads the strings of -contains-from, one per line
+ *
+ * Empty lines are ignored. A single string is searched like that of -contains,
+ * several ones go into an Aho-Corasick automaton, which finds any of them in one pass.
+ *
+ * \param file - the file of strings
+ *
+ * \return the compiled strings
+ *
+ */
+
+static struct needles *load_needles(const char *file){
+    struct needles *nd;
+    FILE *fp;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    if ((fp = fopen(file, "re")) == NULL){
+        compile_error(errno, "%s", file);
+    }
+    nd = xmalloc(sizeof(*nd));
+    memset(nd, 0, sizeof(*nd));
+    nd->maxlen = 1;
+    while ((len = getline(&line, &size, fp)) != -1){
+        if (len > 0 && line[len - 1] == '\n'){
+            line[--len] = '\0';
+        }
+        if (len == 0){
+            continue;
+        }
+        if (nd->count == 0){		//the first string is kept in case it stays the only one
+            nd->str = xmalloc((size_t)len + 1);
+            memcpy(nd->str, line, (size_t)len + 1);
+            nd->len = (size_t)len;
+        }
+        else {
+            int node;
+            if (nd->count == 1){
+                node = trie_add(&nd->trie, nd->str, nd->len, 0);
+                nd->trie.nodes[node].term = 1;
+            }
+            node = trie_add(&nd->trie, line, (size_t)len, 0);		//may move the nodes
+            nd->trie.nodes[node].term = 1;
+        }
+        nd->count++;
+        if ((size_t)len > nd->maxlen){
+            nd->maxlen = (size_t)len;
+        }
+    }
+    int err = ferror(fp) ? errno : 0;
+    free(line);
+    fclose(fp);
+    if (err != 0){
+        needles_free(nd);
+        compile_error(err, "%s", file);
+    }
+    trie_link(&nd->trie);
+    return nd;
+}
+
+/**
+ * \brief releases the strings of -contains or -contains-from
+ */
+
+static void needles_free(struct needles *nd){
+    if (nd == NULL){
+        return;
+    }
+    free(nd->str);
+    trie_free(&nd->trie);
+    free(nd);
+}
+
+/**
+ *
+ * \brief: checks whether a block of a file contains any of the strings
+ *
+ * \param nd - the strings
+ * \param buf - the block
+ * \param len - its length
+ *
+ * \return 1 if one of them occurs, 0 otherwise
+ *
+ */
+
+static int match_needles(const struct needles *nd, const char *buf, size_t len){
+    const struct trie *t = &nd->trie;
+    int node = 0;
+    if (t->nodes == NULL){
+        return nd->count > 0 && search_string(buf, len, nd->str, nd->len) != NULL;
+    }
+    for (size_t i = 0; i < len; i++){
+        unsigned char byte = (unsigned char)buf[i];
+        int next;
+        while ((next = trie_child(t, node, byte)) == 0 && node != 0){
+            node = t->nodes[node].fail;
+        }
+        node = next;
+        if (t->nodes[node].term){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ *
+ * \brief: finds the first occurrence of a string, like memmem
+ *
+ * With SSE2, 16 positions are tested at once for the first and the last byte of the
+ * string and only those where both match are compared, which skips text quickly even
+ * if the first byte is common. The rest of the block goes to memmem.
+ *
+ * \param hay - the text
+ * \param len - its length
+ * \param str - the string
+ * \param n - its length
+ *
+ * \return the first occurrence, NULL if there is none
+ *
+ */
+
+static const char *search_string(const char *hay, size_t len, const char *str, size_t n){
+    size_t i = 0;
+    if (n < 2 || n > len){
+        return n == 0 ? hay : n > len ? NULL : memchr(hay, str[0], len);
+    }
+#ifdef __SSE2__
+    __m128i first = _mm_set1_epi8(str[0]);
+    __m128i last = _mm_set1_epi8(str[n - 1]);
+    for (; i + n + 15 <= len; i += 16){
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + n - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask != 0){
+            unsigned k = (unsigned)__builtin_ctz(mask);
+            if (memcmp(hay + i + k + 1, str + 1, n - 2) == 0){
+                return hay + i + k;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    return memmem(hay + i, len - i, str, n);
+}
+
+/**
+ *
+ * \brief: checks if evaluating the expression always needs the stat data of the entry
+ *
+ * Only the nodes that are evaluated for every entry are looked at: the first child of
+ * -a and -o and the child of !, options like -uring in front of a -a are skipped since
+ * they always match. -type is not counted since getdents64 usually answers it.
+ *
+ * \param e - the expression
+ *
+ * \return 1 if the stat data is always needed, 0 otherwise
+ *
+ */
+
+static int expr_needs_stat(const struct expr *e){
+    switch (e->kind){
+        case EXPR_AND:
+            for (size_t i = 0; i + 1 < e->nkids && e->kids[i]->kind == EXPR_TRUE; i++){
+                if (expr_needs_stat(e->kids[i + 1])){
+                    return 1;
+                }
+            }
+            return expr_needs_stat(e->kids[0]);
+        case EXPR_OR:
+        case EXPR_NOT:
+            return expr_needs_stat(e->kids[0]);
+        case EXPR_USER:
+        case EXPR_GROUP:
+        case EXPR_NOUSER:
+        case EXPR_NOGROUP:
+        case EXPR_SIZE:
+        case EXPR_TIME:
+        case EXPR_PERM:
+        case EXPR_INUM:
+        case EXPR_LINKS:
+        case EXPR_EMPTY:
+        case EXPR_LS:
+            return 1;
+        case EXPR_PRINTF:
+            return e->arg.printf.fmt->stat_mask != 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ *
+ * \brief: reorders the children of -a and -o that have no side effects, cheap and selective tests first
+ *
+ * A run of children between two actions (or -prune) is sorted by cost per decided item: for -a by
+ * cost / (1 - pass), for -o by cost / pass, so name and type checks come before the stat based tests
+ * and those before the user and group lookups. Since none of them has a side effect and -a and -o
+ * are commutative on such children, the result is the same as in the order given, only items
+ * lstat cannot read may be reported fewer times. With -reorder adaptive a node with such a run
+ * gets a group, the walkers keep their own order of it and revise it from the pass rates they see.
+ *
+ * \param plan - receives the groups
+ * \param e - the expression, the children are sorted in place
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void optimize_expr(struct plan *plan, struct expr *e){
+    for (size_t i = 0; i < e->nkids; i++){
+        optimize_expr(plan, e->kids[i]);
+    }
+    expr_estimate(e);
+    if ((e->kind != EXPR_AND && e->kind != EXPR_OR) || e->nkids < 2 || plan->reorder == 0){
+        return;
+    }
+    size_t *perm = xmalloc(e->nkids * sizeof(*perm));
+    double *key = xmalloc(e->nkids * sizeof(*key));
+    struct expr **kids = xmalloc(e->nkids * sizeof(*kids));
+    int movable = 0;
+    for (size_t i = 0; i < e->nkids; i++){
+        perm[i] = i;
+        key[i] = order_key(e, e->kids[i]->cost, e->kids[i]->pass);
+        movable |= i > 0 && e->kids[i]->pure && e->kids[i - 1]->pure;
+    }
+    order_sort(e, perm, key);
+    for (size_t i = 0; i < e->nkids; i++){
+        kids[i] = e->kids[perm[i]];
+    }
+    memcpy(e->kids, kids, e->nkids * sizeof(*kids));
+    free(kids);
+    free(key);
+    free(perm);
+    expr_estimate(e);		//the cost depends on the order
+    if (movable && plan->reorder == 2){
+        plan->groups = xrealloc(plan->groups, (plan->ngroups + 1) * sizeof(*plan->groups));
+        e->group = (int)plan->ngroups;
+        plan->groups[plan->ngroups++] = e;
+    }
+}
+
+/**
+ *
+ * \brief: estimates cost and pass rate of a node from its kind, the children are estimated already
+ *
+ * The costs are rough relative figures: a byte compare is about 1, a stat call about 500.
+ * The pass rates are guesses as well, the walkers replace them by measured ones.
+ *
+ * \param e - the node
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void expr_estimate(struct expr *e){
+    double reach = 1.0;
+    e->pure = 1;
+    e->cost = 0.0;
+    e->pass = 1.0;
+    switch (e->kind){
+        case EXPR_AND:
+        case EXPR_OR:
+            for (size_t i = 0; i < e->nkids; i++){
+                const struct expr *kid = e->kids[i];
+                e->pure &= kid->pure;
+                e->cost += reach * kid->cost;
+                reach *= e->kind == EXPR_AND ? kid->pass : 1.0 - kid->pass;
+            }
+            e->pass = e->kind == EXPR_AND ? reach : 1.0 - reach;
+            break;
+        case EXPR_NOT:
+            e->pure = e->kids[0]->pure;
+            e->cost = e->kids[0]->cost;
+            e->pass = 1.0 - e->kids[0]->pass;
+            break;
+        case EXPR_NAME:
+        case EXPR_PATH:
+            switch (e->arg.pat->kind){
+                case MATCH_EXACT:
+                    e->cost = 4.0;
+                    e->pass = 0.01;
+                    break;
+                case MATCH_PREFIX:
+                case MATCH_SUFFIX:
+                    e->cost = 6.0;
+                    e->pass = 0.1;
+                    break;
+                case MATCH_CONTAINS:
+                    e->cost = 12.0;
+                    e->pass = 0.1;
+                    break;
+                case MATCH_GLOB:
+                    e->cost = 60.0;
+                    e->pass = 0.1;
+                    break;
+            }
+            if (e->kind == EXPR_PATH){		//the whole path is longer than the name
+                e->cost *= 2.0;
+            }
+            break;
+        case EXPR_NAME_FROM:
+            e->cost = 40.0;
+            e->pass = 0.05;
+            break;
+        case EXPR_PATH_FROM:
+            e->cost = 80.0;
+            e->pass = 0.05;
+            break;
+        case EXPR_REGEX:		//a DFA step per byte of the path, unless a literal rejects it first
+            e->cost = e->arg.regex->exact ? 8.0 : e->arg.regex->nfa != NULL ? 80.0 : 800.0;
+            e->pass = 0.05;
+            break;
+        case EXPR_CONTAINS:		//opening and reading the file, it comes after everything else
+            e->cost = 20000.0;
+            e->pass = 0.1;
+            break;
+        case EXPR_TYPE:
+            e->cost = 2.0;		//getdents64 reports it nearly always
+            e->pass = e->arg.type == S_IFREG ? 0.8 : e->arg.type == S_IFDIR ? 0.15 : 0.05;
+            break;
+        case EXPR_USER:
+        case EXPR_GROUP:
+        case EXPR_LINKS:
+            e->cost = 500.0;
+            e->pass = 0.5;
+            break;
+        case EXPR_SIZE:
+        case EXPR_TIME:
+        case EXPR_PERM:
+            e->cost = 500.0;
+            e->pass = 0.3;
+            break;
+        case EXPR_INUM:
+            e->cost = 500.0;
+            e->pass = e->arg.range.lo == e->arg.range.hi ? 0.001 : 0.5;
+            break;
+        case EXPR_EMPTY:
+            e->cost = 550.0;		//directories are opened as well
+            e->pass = 0.05;
+            break;
+        case EXPR_NOUSER:
+        case EXPR_NOGROUP:
+            e->cost = 600.0;		//the stat call and a lookup of the id, mostly answered by the cache
+            e->pass = 0.01;
+            break;
+        case EXPR_PRINT:
+        case EXPR_LS:
+        case EXPR_PRUNE:
+            e->pure = 0;
+            e->cost = 100.0;
+            break;
+        case EXPR_PRINTF:
+            e->pure = 0;
+            e->cost = e->arg.printf.fmt->stat_mask != 0 ? 600.0 : 150.0;
+            break;
+        case EXPR_EXEC:
+            e->pure = 0;
+            e->cost = e->arg.exec->batch ? 200.0 : 1000000.0;
+            e->pass = e->arg.exec->batch ? 1.0 : 0.9;
+            break;
+        case EXPR_TRUE:
+            break;
+    }
+}
+
+/**
+ *
+ * \brief: sort key of a child of -a or -o, the smaller the earlier it is evaluated
+ *
+ * \param e - the -a or -o node
+ * \param cost - cost of the child
+ * \param pass - share of the items the child matches
+ *
+ * \return the expected cost of deciding the node for one item through this child
+ *
+ */
+
+static double order_key(const struct expr *e, double cost, double pass){
+    double decides = e->kind == EXPR_AND ? 1.0 - pass : pass;
+    if (decides <= 0.0){
+        return cost > 0.0 ? HUGE_VAL : 0.0;
+    }
+    return cost / decides;
+}
+
+/**
+ *
+ * \brief: sorts each run of children without side effects by their keys, the others keep their place
+ *
+ * The sort is stable, so children with equal keys stay in the order given or last chosen.
+ *
+ * \param e - the -a or -o node
+ * \param perm - the order of the children, sorted in place
+ * \param key - sort key per child, indexed by the child
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void order_sort(const struct expr *e, size_t *perm, const double *key){
+    size_t start = 0;
+    while (start < e->nkids){
+        size_t end = start;
+        while (end < e->nkids && e->kids[perm[end]]->pure){
+            end++;
+        }
+        for (size_t i = start + 1; i < end; i++){		//the runs are short, insertion sort
+            size_t k = perm[i];
+            size_t j = i;
+            while (j > start && key[perm[j - 1]] > key[k]){
+                perm[j] = perm[j - 1];
+                j--;
+            }
+            perm[j] = k;
+        }
+        start = end + 1;		//skips the child with side effects
+    }
+}
+
+/**
+ *
+ * \brief: sets up the evaluation order of a walker for a group, starting from the sorted children
+ *
+ * \param o - the order
+ * \param e - the node of the group
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void order_init(struct order *o, const struct expr *e){
+    o->perm = xmalloc(e->nkids * sizeof(*o->perm));
+    o->evals = xmalloc(e->nkids * sizeof(*o->evals));
+    o->passes = xmalloc(e->nkids * sizeof(*o->passes));
+    o->key = xmalloc(e->nkids * sizeof(*o->key));
+    for (size_t i = 0; i < e->nkids; i++){
+        o->perm[i] = i;
+        o->evals[i] = 0;
+        o->passes[i] = 0;
+    }
+    o->count = 0;
+    o->next = ORDER_FIRST;
+}
+
+/**
+ *
+ * \brief: sorts the children of a group again with the pass rates measured so far
+ *
+ * Children that were not evaluated since the last revision keep their estimate. A child is only
+ * evaluated if the ones before it did not decide the node, so the rates are conditional on that,
+ * which is what matters for the order. The interval to the next revision grows fourfold up to ORDER_MAX.
+ *
+ * \param e - the node of the group
+ * \param o - the order of the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void order_revise(const struct expr *e, struct order *o){
+    for (size_t i = 0; i < e->nkids; i++){
+        const struct expr *kid = e->kids[i];
+        double pass = kid->pass;
+        if (o->evals[i] > 0){
+            pass = ((double)o->passes[i] + 0.5) / ((double)o->evals[i] + 1.0);
+        }
+        o->key[i] = order_key(e, kid->cost, pass);
+        o->evals[i] /= 2;
+        o->passes[i] /= 2;
+    }
+    order_sort(e, o->perm, o->key);
+    o->next = o->count + (o->count < ORDER_MAX / 4 ? o->count * 3 : ORDER_MAX);
+}
+
+/**
+ *
+ * \brief: evaluates a reordered -a or -o in the order of the walker and counts the pass rates
+ *
+ * \param e - the node
+ * \param ent - the item
+ * \param w - the walker
+ *
+ * \return 1 if the entry matches the node, 0 otherwise
+ *
+ */
+
+static int eval_ordered(const struct expr *e, struct find_entry *ent, struct walker *w){
+    struct order *o = &w->orders[e->group];
+    int decides = e->kind == EXPR_OR;		//the result that ends the evaluation early
+    if (++o->count == o->next){
+        order_revise(e, o);
+    }
+    for (size_t i = 0; i < e->nkids; i++){
+        size_t k = o->perm[i];
+        int r = eval_expr(e->kids[k], ent, w);
+        o->evals[k]++;
+        o->passes[k] += (uint64_t)r;
+        if (r == decides){
+            return decides;
+        }
+    }
+    return !decides;
+}
+
+
+/**
+ *
+ *\brief: do_dir function is responsible of reading a directory and everything below it
+ * it's parameters are passed from the function do_entry :
+ * the walk keeps an explicit stack of directories instead of recursing, so a deep tree neither
+ * grows the C stack nor, thanks to the descriptor budget (-fd-budget), the number of open files.
+ * Each directory is read completely with getdents64 into the large buffer of the walker and its
+ * items are checked in place, then its subdirectories are read one after the other.
+ * Lookups use the directory descriptor, so the kernel never has to resolve the whole path again.
+ * In breadth first order (-order bfs) the subdirectories are queued by path instead.
+ *
+ *
+ * \param dir is the directory item
+ * \param w is the walker, its path buffer holds the path of dir and is restored before returning,
+ *   except in breadth first order
+ *\return: void function no return value
+ *
+ */
+
+static void do_dir(struct find_entry *dir, struct walker *w) {
+    size_t bottom = w->nframes;
+    int depth = w->depth;
+    if (dir_push(w, dir->dirfd, dir->name, dir->depth)){
+        while (w->nframes > bottom){
+            walk_step(w);
+        }
+    }
+    while (w->bfs.count > 0){		//only filled in breadth first order
+        struct task task = w->bfs.items[w->bfs.head];
+        w->bfs.head = (w->bfs.head + 1) % w->bfs.cap;
+        w->bfs.count--;
+        path_set(&w->pb, task.path);
+        w->dev = task.dev;
+        w->root = task.root;
+        if (dir_push(w, AT_FDCWD, task.path, task.depth)){
+            while (w->nframes > bottom){		//only subdirectories with long paths are on the name stack
+                walk_step(w);
+            }
+        }
+        free(task.path);
+    }
+    w->depth = depth;
+}
+
+/**
+ *
+ * \brief: does one step of the walk, reads the next subdirectory of the innermost directory or leaves it
+ *
+ * All state of the walk is kept in the walker, so it can be continued at any time.
+ *
+ * \param w - the walker, it has at least one frame
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void walk_step(struct walker *w){
+    struct pathbuf *pb = &w->pb;
+    size_t top = w->nframes - 1;
+    struct frame *f = &w->frames[top];
+
+    pb->len = f->pathlen;
+    pb->buf[f->pathlen] = '\0';
+    if (f->next == f->end){		//all subdirectories are done
+        w->pending.len = f->base;
+        if (f->fd != -1){
+            frame_close(w, top, 0);
+        }
+        w->nframes--;
+        return;
+    }
+    if (f->fd == -1 && !frame_reopen(w, top)){
+        f->next = f->end;
+        return;
+    }
+    size_t off = f->next;
+    f->next += strlen(w->pending.buf + off) + 1;
+    path_push(pb, w->pending.buf + off);
+    if (dir_push(w, f->fd, w->pending.buf + off, f->depth + 1)){
+        f = &w->frames[top];		//the stack may have moved
+        if (f->next == f->end && f->fd != -1){		//the last subdirectory is open, the parent is not needed anymore
+            frame_close(w, top, 0);
+        }
+    }
+}
+
+/**
+ *
+ * \brief: opens a directory, checks all of its items and puts it on the stack of the walk
+ *
+ * The names of its subdirectories are left on the name stack of the walker. Directories
+ * without subdirectories are closed right away, and if the walk holds more descriptors than
+ * the budget allows, the outermost open directory gives its descriptor back.
+ *
+ * \param w - the walker, its path buffer holds the path of the directory
+ * \param dirfd - descriptor of the parent, AT_FDCWD if the path buffer is opened
+ * \param name - name of the directory relative to dirfd
+ * \param depth - depth of the directory
+ *
+ * \return 1 if the directory was pushed, 0 if it could not be opened
+ *
+ */
+
+static int dir_push(struct walker *w, int dirfd, const char *name, int depth){
+    struct pathbuf *pb = &w->pb;
+    struct stat st;
+    int batched = 0;
+    if (walk_stopped(w->plan)){		//the caller has all it wanted, the rest of the tree is not read
+        return 0;
+    }
+    int fd = dirfd == AT_FDCWD ? open_long(AT_FDCWD, pb->buf) : openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1){
+        if (errno == EMFILE || errno == ENFILE){		//unreadable directories are skipped silently, but not for this
+            error(0, errno, "%s", pb->buf);
+        }
+        return 0;
+    }
+    if (w->nframes == w->cap_frames){
+        w->cap_frames = w->cap_frames ? w->cap_frames * 2 : DEQUE_INITIAL;
+        w->frames = xrealloc(w->frames, w->cap_frames * sizeof(*w->frames));
+    }
+    size_t top = w->nframes++;
+    struct frame *f = &w->frames[top];
+    if (w->stats != NULL){
+        w->stats->dirs++;
+    }
+    f->fd = fd;
+    f->depth = depth;
+    f->pathlen = pb->len;
+    f->base = w->pending.len;
+    w->open_fds++;
+    if (w->low_fd > top){
+        w->low_fd = top;
+    }
+    while (w->open_fds > (size_t)w->plan->fd_budget){		//the top one is never closed here, the budget is at least 1
+        while (w->frames[w->low_fd].fd == -1){
+            w->low_fd++;
+        }
+        frame_close(w, w->low_fd, 1);
+    }
+
+    w->depth = depth + 1;
+    if (w->plan->watch != NULL && w->since.tv_sec == 0 && w->since.tv_nsec == 0){		//watched before it is read, so nothing is missed
+        watch_add(w->plan->watch, fd, pb->buf, depth, w->dev);
+    }
+    if (w->dirbuf == NULL){
+        w->dirbuf = xmalloc(w->plan->dirbuf_size);
+    }
+    if (w->plan->uring && w->plan->stat_always && !atomic_load(&uring_broken)){
+        if (w->ring == NULL){
+            w->ring = uring_open(URING_BATCH);
+        }
+        batched = w->ring != NULL && !w->ring->broken;
+    }
+    int cached = dir_cache != NULL ? dircache_get(w, fd, &st) : -1;
+    if (cached == 1){		//unchanged since a query before listed it
+        if (w->dirsort != NULL){
+            dirsort_add(w, w->listing.buf, w->listing.len);
+        }
+        else {
+            do_chunk(fd, w->listing.buf, w->listing.len, batched, w);
+        }
+    }
+    w->listing.len = 0;
+    while (cached != 1){
+        uint64_t start = w->stats != NULL ? stats_ticks() : 0;
+        ssize_t n = getdents64(fd, w->dirbuf, w->plan->dirbuf_size);
+        if (w->stats != NULL){
+            w->stats->getdents++;
+            w->stats->getdents_ticks += stats_ticks() - start;
+        }
+        if (n == 0){
+            if (cached == 0){
+                dircache_put(&st, w->listing.buf, w->listing.len);
+            }
+            break;
+        }
+        if (n == -1){
+            error(0,errno, "Fault while reading directory: %s", pb->buf);
+            break;
+        }
+        if (cached == 0){
+            if (w->listing.len + (size_t)n > w->listing.cap){
+                size_t cap = w->listing.cap ? w->listing.cap : OUTBUF_SIZE;
+                while (w->listing.len + (size_t)n > cap){
+                    cap *= 2;
+                }
+                w->listing.buf = xrealloc(w->listing.buf, cap);
+                w->listing.cap = cap;
+            }
+            memcpy(w->listing.buf + w->listing.len, w->dirbuf, (size_t)n);
+            w->listing.len += (size_t)n;
+        }
+        if (w->dirsort != NULL){
+            dirsort_add(w, w->dirbuf, (size_t)n);
+        }
+        else {
+            do_chunk(fd, w->dirbuf, (size_t)n, batched, w);
+        }
+    }
+    if (w->dirsort != NULL){
+        dirsort_run(fd, batched, w);
+    }
+    f = &w->frames[top];
+    f->next = f->base;
+    f->end = w->pending.len;
+    if (f->next == f->end){
+        frame_close(w, top, 0);
+    }
+    return 1;
+}
+
+/**
+ *
+ * \brief: looks up the listing of an open directory in the cache of -daemon
+ *
+ * A listing is only valid while the modification and the change time of the directory are
+ * the ones it was read at.
+ *
+ * \param w - the walker, a listing found is copied into w->listing
+ * \param fd - the directory
+ * \param st - receives the status of the directory
+ *
+ * \return 1 if the listing was found, 0 if not and *st is valid, -1 if the status could not be read
+ *
+ */
+
+static int dircache_get(struct walker *w, int fd, struct stat *st){
+    struct dircache *dc = dir_cache;
+    int found = 0;
+    if (fstat(fd, st) == -1){
+        return -1;
+    }
+    pthread_mutex_lock(&dc->lock);
+    struct dirlist *e = dc->nchains > 0 ? dc->chains[dircache_chain(dc, st->st_dev, st->st_ino)] : NULL;
+    while (e != NULL && (e->dev != st->st_dev || e->ino != st->st_ino)){
+        e = e->next;
+    }
+    if (e != NULL && (e->mtime.tv_sec != st->st_mtim.tv_sec || e->mtime.tv_nsec != st->st_mtim.tv_nsec
+            || e->ctime.tv_sec != st->st_ctim.tv_sec || e->ctime.tv_nsec != st->st_ctim.tv_nsec)){
+        dircache_drop(dc, e);
+    }
+    else if (e != NULL){
+        if (e->len > w->listing.cap){
+            w->listing.buf = xrealloc(w->listing.buf, e->len);
+            w->listing.cap = e->len;
+        }
+        memcpy(w->listing.buf, e->recs, e->len);
+        w->listing.len = e->len;
+        if (e != dc->newest){		//moves to the end of the order of use
+            e->newer->older = e->older;
+            if (e->older != NULL){
+                e->older->newer = e->newer;
+            }
+            else {
+                dc->oldest = e->newer;
+            }
+            e->older = dc->newest;
+            e->newer = NULL;
+            dc->newest->newer = e;
+            dc->newest = e;
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&dc->lock);
+    if (found && w->stats != NULL){
+        w->stats->cached++;
+    }
+    return found;
+}
+
+/**
+ *
+ * \brief: keeps the listing of a directory read to its end for the queries after this one
+ *
+ * Directories changed in the last DIRCACHE_RACY_SEC seconds are not kept: a change in the
+ * same tick of the file system clock as the read would not show in the times.
+ *
+ * \param st - status of the directory before it was read
+ * \param recs - its getdents64 records
+ * \param len - their size
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void dircache_put(const struct stat *st, const char *recs, size_t len){
+    struct dircache *dc = dir_cache;
+    time_t now = time(NULL);
+    if (now - st->st_mtim.tv_sec < DIRCACHE_RACY_SEC || now - st->st_ctim.tv_sec < DIRCACHE_RACY_SEC || len > dc->budget){
+        return;
+    }
+    struct dirlist *e = xmalloc(sizeof(*e));
+    e->dev = st->st_dev;
+    e->ino = st->st_ino;
+    e->mtime = st->st_mtim;
+    e->ctime = st->st_ctim;
+    e->len = len;
+    e->recs = xmalloc(len > 0 ? len : 1);
+    if (len > 0){
+        memcpy(e->recs, recs, len);
+    }
+    pthread_mutex_lock(&dc->lock);
+    struct dirlist *old = dc->nchains > 0 ? dc->chains[dircache_chain(dc, e->dev, e->ino)] : NULL;
+    while (old != NULL && (old->dev != e->dev || old->ino != e->ino)){
+        old = old->next;
+    }
+    if (old != NULL){		//another walker of -j read it at the same time
+        dircache_drop(dc, old);
+    }
+    while (dc->oldest != NULL && dc->bytes + len > dc->budget){
+        dircache_drop(dc, dc->oldest);
+    }
+    if (dc->count + 1 > dc->nchains){
+        struct dirlist **chains = dc->chains;
+        size_t nchains = dc->nchains;
+        dc->nchains = nchains ? nchains * 2 : DIRCACHE_INITIAL;
+        dc->chains = xmalloc(dc->nchains * sizeof(*dc->chains));
+        memset(dc->chains, 0, dc->nchains * sizeof(*dc->chains));
+        for (size_t i = 0; i < nchains; i++){
+            while (chains[i] != NULL){
+                struct dirlist *m = chains[i];
+                size_t k = dircache_chain(dc, m->dev, m->ino);
+                chains[i] = m->next;
+                m->next = dc->chains[k];
+                dc->chains[k] = m;
+            }
+        }
+        free(chains);
+    }
+    size_t k = dircache_chain(dc, e->dev, e->ino);
+    e->next = dc->chains[k];
+    dc->chains[k] = e;
+    e->older = dc->newest;
+    e->newer = NULL;
+    if (dc->newest != NULL){
+        dc->newest->newer = e;
+    }
+    else {
+        dc->oldest = e;
+    }
+    dc->newest = e;
+    dc->count++;
+    dc->bytes += len;
+    pthread_mutex_unlock(&dc->lock);
+}
+
+/**
+ *
+ * \brief: removes a listing from the cache of -daemon and frees it
+ *
+ * \param dc - the cache, the caller holds its lock
+ * \param e - the listing
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void dircache_drop(struct dircache *dc, struct dirlist *e){
+    struct dirlist **link = &dc->chains[dircache_chain(dc, e->dev, e->ino)];
+    while (*link != e){
+        link = &(*link)->next;
+    }
+    *link = e->next;
+    if (e->older != NULL){
+        e->older->newer = e->newer;
+    }
+    else {
+        dc->oldest = e->newer;
+    }
+    if (e->newer != NULL){
+        e->newer->older = e->older;
+    }
+    else {
+        dc->newest = e->older;
+    }
+    dc->count--;
+    dc->bytes -= e->len;
+    free(e->recs);
+    free(e);
+}
+
+/**
+ *
+ * \brief: hash chain of a directory in the cache of -daemon
+ *
+ * \param dc - the cache, it has chains
+ * \param dev - device of the directory
+ * \param ino - inode of the directory
+ *
+ * \return index of the chain
+ *
+ */
+
+static size_t dircache_chain(const struct dircache *dc, dev_t dev, ino_t ino){
+    return (((uint64_t)dev * 0x9E3779B97F4A7C15ull) ^ (uint64_t)ino) * 0x9E3779B97F4A7C15ull >> 32 & (dc->nchains - 1);
+}
+
+/**
+ *
+ * \brief: frees all listings of the cache of -daemon
+ *
+ * \param dc - the cache
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void dircache_free(struct dircache *dc){
+    while (dc->oldest != NULL){
+        dircache_drop(dc, dc->oldest);
+    }
+    free(dc->chains);
+    dc->chains = NULL;
+    dc->nchains = 0;
+}
+
+/**
+ *
+ * \brief: closes the descriptor of a directory on the stack
+ *
+ * \param w - the walker
+ * \param i - index of the frame
+ * \param reopen - 1 if the directory is opened again later, its identity is remembered to check that
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void frame_close(struct walker *w, size_t i, int reopen){
+    struct frame *f = &w->frames[i];
+    struct stat st;
+    if (reopen && fstat(f->fd, &st) == 0){
+        f->dev = st.st_dev;
+        f->ino = st.st_ino;
+    }
+    if (close(f->fd) == -1) {
+        error(0,errno, "close");
+        exit(1);
+    }
+    f->fd = -1;
+    w->open_fds--;
+}
+
+/**
+ *
+ * \brief: opens a directory of the stack again after it gave its descriptor back
+ *
+ * The path is resolved from the nearest outer directory that is still open. If another
+ * directory is found there now, the rest of the old one is skipped.
+ *
+ * \param w - the walker, its path buffer holds the path of the directory
+ * \param i - index of the frame
+ *
+ * \return 1 if it is open again, 0 otherwise
+ *
+ */
+
+static int frame_reopen(struct walker *w, size_t i){
+    struct pathbuf *pb = &w->pb;
+    struct frame *f = &w->frames[i];
+    struct stat st;
+    int dirfd = AT_FDCWD;
+    char *rel = pb->buf;
+    size_t j = i;
+
+    while (j > 0 && w->frames[j - 1].fd == -1){
+        j--;
+    }
+    if (j > 0){
+        size_t len = w->frames[j - 1].pathlen;
+        dirfd = w->frames[j - 1].fd;
+        rel = pb->buf + len + (pb->buf[len - 1] == '/' ? 0 : 1);		//the separator path_push put behind it
+    }
+    f->fd = open_long(dirfd, rel);
+    if (f->fd == -1 || fstat(f->fd, &st) == -1 || st.st_dev != f->dev || st.st_ino != f->ino){
+        error(0, f->fd == -1 ? errno : 0, "%s changed during the walk, skipping the rest of it", pb->buf);
+        if (f->fd != -1){
+            close(f->fd);
+            f->fd = -1;
+        }
+        return 0;
+    }
+    w->open_fds++;
+    if (w->low_fd > i){
+        w->low_fd = i;
+    }
+    if (w->stats != NULL){
+        w->stats->reopens++;
+    }
+    return 1;
+}
+
+/**
+ *
+ * \brief: opens a directory whose path may be longer than PATH_MAX
+ *
+ * Long paths are opened one component at a time, none of them may be a symbolic link.
+ *
+ * \param dirfd - directory the path is relative to
+ * \param path - the path, it is changed while walking it and restored
+ *
+ * \return the descriptor or -1 with errno set
+ *
+ */
+
+static int open_long(int dirfd, char *path){
+    const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    int fd = dirfd;
+    char *comp = path;
+    if (strlen(path) < PATH_MAX){
+        return openat(dirfd, path, flags);
+    }
+    if (*comp == '/' && (fd = open("/", flags)) == -1){
+        return -1;
+    }
+    for (;;){
+        while (*comp == '/'){
+            comp++;
+        }
+        char *slash = strchr(comp, '/');
+        if (slash != NULL){
+            *slash = '\0';
+        }
+        int next = openat(fd, comp, flags);
+        int err = errno;
+        if (slash != NULL){
+            *slash = '/';
+        }
+        if (fd != dirfd){
+            close(fd);
+        }
+        if (next == -1){
+            errno = err;
+            return -1;
+        }
+        fd = next;
+        if (slash == NULL || slash[strspn(slash, "/")] == '\0'){
+            return fd;
+        }
+        comp = slash + 1;
+    }
+}
+
+/**
+ *
+ * \brief: checks the items in a buffer of getdents64 records
+ *
+ * The records are parsed in place, the names are not copied. With io_uring the items
+ * are collected into batches and checked once their stat data arrives.
+ *
+ * \param fd - descriptor of the directory
+ * \param buf - the records, from getdents64 or the cache of -daemon
+ * \param len - number of valid bytes in the buffer
+ * \param batched - 1 if the stat data is fetched through io_uring
+ * \param w - the walker, its path buffer holds the path of the directory
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void do_chunk(int fd, const char *buf, size_t len, int batched, struct walker *w){
+    struct batch *b = w->batch;
+    size_t pos = 0;
+    if (batched && b == NULL){
+        b = w->batch = xmalloc(sizeof(*b));
+    }
+    if (batched){
+        b->count = 0;
+    }
+
+    while (pos < len){
+        const struct dirent64 *d = (const struct dirent64 *)(buf + pos);
+        const char *name = d->d_name;
+        pos += d->d_reclen;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))){ //ignore if the directory is "." or ".."
+            continue;
+        }
+        do_item(fd, name, d->d_type, batched, w);
+    }
+    if (batched && w->batch->count > 0){		//run_batch may have replaced the batch
+        run_batch(fd, w);
+    }
+}
+
+/**
+ *
+ * \brief: checks one item of the directory being read, or adds it to the batch of io_uring
+ *
+ * \param fd - descriptor of the directory
+ * \param name - name of the item, it stays valid until the batch ran
+ * \param d_type - its type reported by getdents64
+ * \param batched - 1 if the stat data is fetched through io_uring
+ * \param w - the walker, its path buffer holds the path of the directory
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void do_item(int fd, const char *name, unsigned char d_type, int batched, struct walker *w){
+    struct pathbuf *pb = &w->pb;
+    if (batched){
+        struct batch *b = w->batch;
+        b->name[b->count] = name;
+        b->d_type[b->count] = d_type;
+        if (++b->count == URING_BATCH){
+            run_batch(fd, w);
+        }
+        return;
+    }
+    size_t plen = path_push(pb, name);	//the path is only built for output and error messages
+    struct find_entry ent = {pb->buf, fd, name, d_type, w->plan->stat_mask, 0, {0}, w->depth, 0};	//the type from getdents64 often spares the stat call
+    if (do_visit(&ent, w)){
+        defer_dir(&ent, w);
+    }
+    pb->len = plen;
+    pb->buf[plen] = '\0';
+}
+
+/**
+ *
+ * \brief: copies the names in a buffer of getdents64 records for -sort name
+ *
+ * The first 8 bytes of each name are kept next to its offset as a big endian number, so
+ * comparing them compares the names and the sort rarely looks at the names themselves.
+ *
+ * \param w - the walker
+ * \param buf - the records
+ * \param len - number of valid bytes in the buffer
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void dirsort_add(struct walker *w, const char *buf, size_t len){
+    struct dirsort *ds = w->dirsort;
+    size_t pos = 0;
+    while (pos < len){
+        const struct dirent64 *d = (const struct dirent64 *)(buf + pos);
+        const char *name = d->d_name;
+        pos += d->d_reclen;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))){
+            continue;
+        }
+        size_t n = strlen(name) + 1;
+        if (ds->names.len + n > ds->names.cap){
+            size_t cap = ds->names.cap ? ds->names.cap : PATH_INITIAL;
+            while (ds->names.len + n > cap){
+                cap *= 2;
+            }
+            ds->names.buf = xrealloc(ds->names.buf, cap);
+            ds->names.cap = cap;
+        }
+        if (ds->count == ds->cap){
+            ds->cap = ds->cap ? ds->cap * 2 : DEQUE_INITIAL;
+            ds->refs = xrealloc(ds->refs, ds->cap * sizeof(*ds->refs));
+        }
+        struct nameref *r = &ds->refs[ds->count++];
+        r->prefix = 0;
+        for (size_t i = 0; i < 8; i++){
+            r->prefix = r->prefix << 8 | (i < n ? (unsigned char)name[i] : 0);
+        }
+        r->off = ds->names.len;
+        r->d_type = d->d_type;
+        memcpy(ds->names.buf + ds->names.len, name, n);
+        ds->names.len += n;
+    }
+}
+
+/**
+ *
+ * \brief: sorts the names of the directory read for -sort name and checks the items in that order
+ *
+ * Its subdirectories are deferred in the same order, so the whole walk comes out sorted.
+ *
+ * \param fd - descriptor of the directory
+ * \param batched - 1 if the stat data is fetched through io_uring
+ * \param w - the walker, its path buffer holds the path of the directory
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void dirsort_run(int fd, int batched, struct walker *w){
+    struct dirsort *ds = w->dirsort;
+    if (batched && w->batch == NULL){
+        w->batch = xmalloc(sizeof(*w->batch));
+    }
+    if (batched){
+        w->batch->count = 0;
+    }
+    qsort_r(ds->refs, ds->count, sizeof(*ds->refs), name_ref_cmp, ds->names.buf);
+    for (size_t i = 0; i < ds->count; i++){
+        do_item(fd, ds->names.buf + ds->refs[i].off, ds->refs[i].d_type, batched, w);
+    }
+    if (batched && w->batch->count > 0){
+        run_batch(fd, w);
+    }
+    ds->names.len = 0;
+    ds->count = 0;
+}
+
+/**
+ *
+ * \brief: qsort_r comparison of two names of a directory, byte by byte like strcmp
+ *
+ * \param a - the first nameref
+ * \param b - the second nameref
+ * \param base - the names buffer
+ *
+ * \return less than, equal to or greater than 0
+ *
+ */
+
+static int name_ref_cmp(const void *a, const void *b, void *base){
+    const struct nameref *x = a;
+    const struct nameref *y = b;
+    if (x->prefix != y->prefix){
+        return x->prefix < y->prefix ? -1 : 1;
+    }
+    if ((x->prefix & 0xff) == 0){		//both names end within the prefix
+        return 0;
+    }
+    return strcmp((const char *)base + x->off + 8, (const char *)base + y->off + 8);
+}
+
+/**
+ *
+ * \brief: remembers a checked directory, it is read once the current directory is done
+ *
+ * In the parallel walk the directory becomes a task right away, in breadth first order
+ * it is queued behind the directories found before. Directories with a path longer than
+ * PATH_MAX are always read below their parent by the same walker.
+ *
+ * \param ent - the checked directory
+ * \param w - the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void defer_dir(struct find_entry *ent, struct walker *w){
+    if (w->pb.len >= PATH_MAX){		//opening it by path would cost one lookup per component, it stays here
+        namestack_push(&w->pending, ent->name);
+        return;
+    }
+    if (w->pool != NULL){
+        pool_push(w, ent->path, ent->depth);
+        return;
+    }
+    if (w->plan->bfs){
+        char *copy = strdup(ent->path);
+        if (copy == NULL){
+            error(EXIT_FAILURE, errno, "strdup");
+        }
+        deque_push(&w->bfs, copy, ent->depth, w->dev, w->root);
+        return;
+    }
+    namestack_push(&w->pending, ent->name);
+}
+
+/**
+ *
+ * \brief: replaces the content of the path buffer with a start point
+ *
+ * \param pb - the path buffer
+ * \param path - the start point
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void path_set(struct pathbuf *pb, const char *path){
+    size_t len = strlen(path);
+    if (pb->cap < len + 1){
+        pb->cap = len + 1 > PATH_INITIAL ? len + 1 : PATH_INITIAL;
+        pb->buf = xrealloc(pb->buf, pb->cap);
+    }
+    memcpy(pb->buf, path, len + 1);
+    pb->len = len;
+}
+
+/**
+ *
+ * \brief: appends "/name" to the path buffer and grows it if needed, no slash is doubled
+ *
+ * \param pb - the path buffer
+ * \param name - the name of the item to append
+ *
+ * \return the previous length, passing it back to the buffer cuts the name off again
+ *
+ */
+
+static size_t path_push(struct pathbuf *pb, const char *name){
+    size_t old = pb->len;
+    size_t namelen = strlen(name);
+    size_t sep = old > 0 && pb->buf[old - 1] == '/' ? 0 : 1;		//start points like "/" or "dir/" already end in one
+    if (old + namelen + 2 > pb->cap){
+        while (old + namelen + 2 > pb->cap){
+            pb->cap *= 2;
+        }
+        pb->buf = xrealloc(pb->buf, pb->cap);
+    }
+    pb->buf[old] = '/';
+    memcpy(pb->buf + old + sep, name, namelen + 1);
+    pb->len = old + namelen + sep;
+    return old;
+}
+
+
+/**
+ *
+ * \brief: submits the statx requests of the collected batch and checks each entry when its completion arrives
+ *
+ * Up to URING_BATCH statx requests are in flight at once, the entries are checked in the order
+ * the completions arrive. If the ring fails, what is in flight is still waited for and the
+ * entries without a completion fall back to the synchronous call; requests that cannot be
+ * waited for anymore keep the batch, the walker goes on with a new one.
+ *
+ * \param fd - descriptor of the directory the names are relative to
+ * \param w - the walker holding the batch, its path buffer holds the path of the directory
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void run_batch(int fd, struct walker *w){
+    struct batch *b = w->batch;
+    struct uring *ring = w->ring;
+    size_t count = b->count;
+    size_t sent = 0;
+    size_t done = 0;
+
+    memset(b->finished, 0, count);
+    if (!ring->broken){
+        unsigned tail = *ring->sq_tail;
+        for (size_t i = 0; i < count; i++){
+            unsigned idx = tail & *ring->sq_mask;
+            struct io_uring_sqe *sqe = &ring->sqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = fd;
+            sqe->addr = (unsigned long)b->name[i];
+            sqe->len = w->plan->stat_mask;
+            sqe->off = (unsigned long)&b->stx[i];
+            sqe->statx_flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+            sqe->user_data = i;
+            ring->sq_array[idx] = idx;
+            tail++;
+        }
+        atomic_store_explicit((_Atomic unsigned *)ring->sq_tail, tail, memory_order_release);
+        int n = uring_enter(ring, (unsigned)count, 0);
+        if (n == -1 || (size_t)n < count){		//the rest stays in the queue, the ring is not entered with it again
+            uring_fail(ring, n == -1 ? errno : 0);
+        }
+        sent = n == -1 ? 0 : (size_t)n;
+        if (w->stats != NULL){
+            w->stats->batched += sent;
+        }
+    }
+
+    while (done < sent){
+        unsigned head = *ring->cq_head;
+        unsigned ctail = atomic_load_explicit((_Atomic unsigned *)ring->cq_tail, memory_order_acquire);
+        if (head == ctail){
+            if (uring_enter(ring, 0, 1) == -1){
+                uring_fail(ring, errno);
+                w->batch = xmalloc(sizeof(*w->batch));		//the requests in flight may still write into the old one, it is not freed
+                break;
+            }
+            continue;
+        }
+        while (head != ctail){
+            const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            size_t i = (size_t)cqe->user_data;
+            int res = cqe->res;
+            head++;
+            done++;
+            if (res == -EINVAL || res == -EOPNOTSUPP){		//the kernel cannot do it after all
+                uring_fail(ring, -res);
+                res = 1;
+            }
+            b->finished[i] = 1;
+            batch_visit(fd, w, b, i, res);
+        }
+        atomic_store_explicit((_Atomic unsigned *)ring->cq_head, head, memory_order_release);
+    }
+    for (size_t i = 0; done < count && i < count; i++){
+        if (!b->finished[i]){
+            batch_visit(fd, w, b, i, 1);
+        }
+    }
+    w->batch->count = 0;
+}
+
+/**
+ *
+ * \brief: checks an entry of a batch of io_uring
+ *
+ * \param fd - descriptor of the directory the names are relative to
+ * \param w - the walker, its path buffer holds the path of the directory
+ * \param b - the batch
+ * \param i - index of the entry
+ * \param res - result of its statx request, 0 if b->stx holds the data, 1 if there is none and it is fetched synchronously
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void batch_visit(int fd, struct walker *w, const struct batch *b, size_t i, int res){
+    struct pathbuf *pb = &w->pb;
+    size_t len = path_push(pb, b->name[i]);
+    struct find_entry ent = {pb->buf, fd, b->name[i], b->d_type[i], w->plan->stat_mask, 0, {0}, w->depth, 0};
+    if (res == 0){
+        statx_to_stat(&b->stx[i], &ent.st);
+        ent.have_stat = 1;
+    }
+    else if (res < 0){
+        error(0, -res, "lstat failed: %s", pb->buf);
+        ent.have_stat = -1;
+    }
+    if (do_visit(&ent, w)){		//entries without stat data fall back to the synchronous call
+        defer_dir(&ent, w);
+    }
+    pb->len = len;
+    pb->buf[len] = '\0';
+}
+
+/**
+ *
+ * \brief: stops batching on a ring that failed, its walker fetches stat data synchronously from then on
+ *
+ * \param ring - the ring
+ * \param err - errno of the failure, 0 if there is none
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void uring_fail(struct uring *ring, int err){
+    if (!ring->broken){
+        error(0, err, "warning: io_uring failed, fetching file information without it");
+    }
+    ring->broken = 1;
+}
+
+/**
+ *
+ * \brief: turns -uring off for the whole process, the first caller prints why
+ *
+ * \param why - the reason
+ * \param err - errno of the failure, 0 if there is none
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void uring_unusable(const char *why, int err){
+    if (atomic_exchange(&uring_broken, 1) == 0){
+        error(0, err, "warning: %s, -uring is ignored", why);
+    }
+}
+
+/**
+ *
+ * \brief: sets up an io_uring instance and maps its rings
+ *
+ * \param entries - size of the submission queue
+ *
+ * \return the ring or NULL if io_uring is not available, then -uring is turned off for good
+ *
+ */
+
+static struct uring *uring_open(unsigned entries){
+    struct io_uring_params params;
+    struct uring *ring;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd == -1){
+        uring_unusable("io_uring is not available", errno);
+        return NULL;
+    }
+    size_t probelen = sizeof(struct io_uring_probe) + (IORING_OP_STATX + 1) * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = xmalloc(probelen);
+    memset(probe, 0, probelen);
+    int statx_ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_STATX + 1) == 0
+            && probe->last_op >= IORING_OP_STATX && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    if (!statx_ok){		//kernels without the probe have no statx either
+        uring_unusable("io_uring cannot fetch file information on this kernel", 0);
+        close(fd);
+        return NULL;
+    }
+    ring = xmalloc(sizeof(*ring));
+    ring->fd = fd;
+    ring->broken = 0;
+    ring->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ring = mmap(NULL, ring->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = mmap(NULL, ring->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED){
+        uring_unusable("io_uring mmap", errno);
+        uring_close(ring);
+        return NULL;
+    }
+    ring->sq_head = (unsigned *)((char *)ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((char *)ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned *)((char *)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+    return ring;
+}
+
+/**
+ *
+ * \brief: unmaps the rings and closes an io_uring instance
+ *
+ * \param ring - the ring, NULL is ignored
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void uring_close(struct uring *ring){
+    if (ring == NULL){
+        return;
+    }
+    if (ring->sq_ring != MAP_FAILED){
+        munmap(ring->sq_ring, ring->sq_ring_len);
+    }
+    if (ring->cq_ring != MAP_FAILED){
+        munmap(ring->cq_ring, ring->cq_ring_len);
+    }
+    if (ring->sqes != MAP_FAILED){
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    close(ring->fd);
+    free(ring);
+}
+
+/**
+ *
+ * \brief: submits queued requests and optionally waits for completions
+ *
+ * \param ring - the ring
+ * \param submit - number of new submission queue entries
+ * \param wait - number of completions to wait for
+ *
+ * \return the number of entries submitted, -1 with errno set otherwise
+ *
+ */
+
+static int uring_enter(struct uring *ring, unsigned submit, unsigned wait){
+    long rc;
+    do {
+        rc = syscall(__NR_io_uring_enter, ring->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (rc == -1 && errno == EINTR);
+    return (int)rc;
+}
+
+/**
+ *
+ * \brief: sets up the per thread state of a walk
+ *
+ * \param w - the walker
+ * \param plan - the compiled command line
+ * \param pool - shared state of the parallel walk, NULL for the sequential walk
+ * \param id - index of the walker in the pool
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void walker_init(struct walker *w, const struct plan *plan, struct pool *pool, int id){
+    memset(w, 0, sizeof(*w));
+    w->plan = plan;
+    w->pool = pool;
+    w->id = id;
+    w->ls_minute = -1;
+    w->fmt_minute = -1;
+    w->out = xmalloc(plan->noutputs * sizeof(*w->out));
+    for (size_t i = 0; i < plan->noutputs; i++){
+        w->out[i].cap = OUTBUF_SIZE;
+        w->out[i].buf = xmalloc(OUTBUF_SIZE);
+        w->out[i].len = 0;
+    }
+    if (plan->stats){
+        w->stats = xmalloc(sizeof(*w->stats));
+        stats_init(w->stats, plan->nnodes);
+        if (id == 0){		//the first walker runs on the calling thread, walk_worker binds the others
+            thread_stats = w->stats;
+        }
+    }
+    if (plan->ngroups > 0){
+        w->orders = xmalloc(plan->ngroups * sizeof(*w->orders));
+        for (size_t i = 0; i < plan->ngroups; i++){
+            order_init(&w->orders[i], plan->groups[i]);
+        }
+    }
+    if (plan->nexecs > 0){
+        w->batches = xmalloc(plan->nexecs * sizeof(*w->batches));
+        memset(w->batches, 0, plan->nexecs * sizeof(*w->batches));
+    }
+    if (plan->nregexes > 0){		//the DFAs are built on their first path
+        w->dfas = xmalloc(plan->nregexes * sizeof(*w->dfas));
+        memset(w->dfas, 0, plan->nregexes * sizeof(*w->dfas));
+    }
+}
+
+/**
+ *
+ * \brief: writes the buffered output of a walker and releases its resources
+ *
+ * \param w - the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void walker_free(struct walker *w){
+    for (size_t i = 0; i < w->plan->nexecs; i++){		//before the output is flushed for the last time, the commands flush it first
+        exec_flush(w, i);
+        free(w->batches[i].args);
+    }
+    free(w->batches);
+    sort_finish(w);
+    iter_flush(w);
+    for (size_t i = 0; i < w->plan->noutputs; i++){
+        out_flush(w, i);
+        free(w->out[i].buf);
+    }
+    free(w->out);
+    free(w->line.buf);
+    free(w->pb.buf);
+    uring_close(w->ring);
+    free(w->batch);
+    free(w->dirbuf);
+    free(w->pending.buf);
+    free(w->frames);
+    free(w->bfs.items);
+    for (size_t i = 0; w->orders != NULL && i < w->plan->ngroups; i++){
+        free(w->orders[i].perm);
+        free(w->orders[i].evals);
+        free(w->orders[i].passes);
+        free(w->orders[i].key);
+    }
+    free(w->orders);
+    for (size_t i = 0; w->dfas != NULL && i < w->plan->nregexes; i++){
+        dfa_free(&w->dfas[i]);
+    }
+    free(w->dfas);
+    free(w->readbuf);
+    free(w->listing.buf);
+    if (w->dirsort != NULL){
+        free(w->dirsort->names.buf);
+        free(w->dirsort->refs);
+        free(w->dirsort);
+    }
+    if (w->stats != NULL){
+        if (thread_stats == w->stats){
+            thread_stats = NULL;
+        }
+        stats_merge(w->plan, w->stats);
+        free(w->stats->evals);
+        free(w->stats);
+    }
+}
+
+/**
+ *
+ * \brief: walks the start points with plan->jobs threads
+ *
+ * The start points are checked by the calling thread, every directory found becomes a task
+ * in the deque of the worker that found it. Workers without tasks steal from the others.
+ * Each worker has its own output buffers holding whole records, so lines never interleave.
+ *
+ * \param plan - the compiled command line
+ * \param reads - the readers of -contains, NULL if the workers read the files themselves
+ * \param sort - collects the results for -sort, NULL to write them right away
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void walk_parallel(const struct plan *plan, struct readpool *reads, struct sorter *sort){
+    struct pool pool;
+    struct walker *workers = xmalloc((size_t)plan->jobs * sizeof(*workers));
+    pthread_t *threads = xmalloc((size_t)plan->jobs * sizeof(*threads));
+
+    pool.nworkers = plan->jobs;
+    pool.deques = xmalloc((size_t)plan->jobs * sizeof(*pool.deques));
+    atomic_init(&pool.pending, 0);
+    pthread_mutex_init(&pool.idle_lock, NULL);
+    pthread_cond_init(&pool.idle_cond, NULL);
+    pool.idle = 0;
+    for (int i = 0; i < plan->jobs; i++){
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+        pool.deques[i].items = NULL;
+        pool.deques[i].head = 0;
+        pool.deques[i].count = 0;
+        pool.deques[i].cap = 0;
+        walker_init(&workers[i], plan, &pool, i);
+        workers[i].reads = reads;
+        workers[i].sort = sort;
+    }
+
+    for (size_t i = 0; i < plan->npaths; i++){		//the start points seed the deque of the first worker
+        path_set(&workers[0].pb, plan->paths[i]);
+        struct find_entry ent = {workers[0].pb.buf, AT_FDCWD, plan->paths[i], DT_UNKNOWN, plan->stat_mask, 0, {0}, 0, 0};
+        if (entry_stat(&ent) != NULL){		//a missing start point is always reported
+            workers[0].dev = ent.st.st_dev;
+            workers[0].root = plan->paths[i];
+            do_entry(&ent, &workers[0]);
+        }
+    }
+
+    exit_walkers = workers;
+    exit_nwalkers = plan->jobs;
+    for (int i = 1; i < plan->jobs; i++){
+        int rc = pthread_create(&threads[i], NULL, walk_worker, &workers[i]);
+        if (rc != 0){
+            error(EXIT_FAILURE, rc, "pthread_create");
+        }
+    }
+    walk_worker(&workers[0]);
+    for (int i = 1; i < plan->jobs; i++){
+        pthread_join(threads[i], NULL);
+    }
+
+    exit_nwalkers = 0;
+    for (int i = 0; i < plan->jobs; i++){
+        walker_free(&workers[i]);
+        free(pool.deques[i].items);
+        pthread_mutex_destroy(&pool.deques[i].lock);
+    }
+    pthread_mutex_destroy(&pool.idle_lock);
+    pthread_cond_destroy(&pool.idle_cond);
+    free(pool.deques);
+    free(threads);
+    free(workers);
+}
+
+/**
+ *
+ * \brief: main loop of a worker thread, reads directories until no task is left anywhere
+ *
+ * \param arg - the walker of the thread
+ *
+ * \return NULL
+ *
+ */
+
+static void *walk_worker(void *arg){
+    struct walker *w = arg;
+    struct pool *pool = w->pool;
+    thread_stats = w->stats;
+    for (;;){
+        struct task task;
+        if (pool_take(w, &task)){
+            path_set(&w->pb, task.path);
+            w->dev = task.dev;
+            w->root = task.root;
+            struct find_entry dir = {w->pb.buf, AT_FDCWD, task.path, DT_DIR, w->plan->stat_mask, 0, {0}, task.depth, 0};
+            do_dir(&dir, w);
+            free(task.path);
+            if (atomic_fetch_sub(&pool->pending, 1) == 1){		//the last task is done, wake everybody up to exit
+                pthread_mutex_lock(&pool->idle_lock);
+                pthread_cond_broadcast(&pool->idle_cond);
+                pthread_mutex_unlock(&pool->idle_lock);
+            }
+            continue;
+        }
+        pthread_mutex_lock(&pool->idle_lock);
+        if (atomic_load(&pool->pending) == 0){
+            pthread_mutex_unlock(&pool->idle_lock);
+            break;
+        }
+        struct timespec until;		//the timeout covers a task pushed between pool_take and here
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += IDLE_WAIT_NS;
+        if (until.tv_nsec >= 1000000000L){
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pool->idle++;
+        pthread_cond_timedwait(&pool->idle_cond, &pool->idle_lock, &until);
+        pool->idle--;
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return NULL;
+}
+
+/**
+ *
+ * \brief: starts the threads reading the files of -contains, each with a walker of its own
+ *
+ * \param plan - the compiled command line
+ * \param sort - collects the results for -sort, NULL to write them right away
+ *
+ * \return the pool, handed to the walkers
+ *
+ */
+
+static struct readpool *reads_start(const struct plan *plan, struct sorter *sort){
+    struct readpool *rp = xmalloc(sizeof(*rp));
+    rp->head = 0;
+    rp->count = 0;
+    rp->done = 0;
+    rp->nreaders = plan->contains_jobs;
+    pthread_mutex_init(&rp->lock, NULL);
+    pthread_cond_init(&rp->more, NULL);
+    pthread_cond_init(&rp->room, NULL);
+    rp->readers = xmalloc((size_t)rp->nreaders * sizeof(*rp->readers));
+    rp->walkers = xmalloc((size_t)rp->nreaders * sizeof(*rp->walkers));
+    for (int i = 0; i < rp->nreaders; i++){
+        walker_init(&rp->walkers[i], plan, NULL, i + 1);		//not 0, the thread binds its counters itself
+        rp->walkers[i].sort = sort;
+        rp->readers[i].w = &rp->walkers[i];
+        rp->readers[i].pool = rp;
+        int rc = pthread_create(&rp->readers[i].thread, NULL, read_worker, &rp->readers[i]);
+        if (rc != 0){
+            error(EXIT_FAILURE, rc, "pthread_create");
+        }
+    }
+    return rp;
+}
+
+/**
+ *
+ * \brief: waits until the readers checked every file handed to them and releases them
+ *
+ * \param rp - the pool, may be NULL
+ *
+ */
+
+static void reads_stop(struct readpool *rp){
+    if (rp == NULL){
+        return;
+    }
+    pthread_mutex_lock(&rp->lock);
+    rp->done = 1;
+    pthread_cond_broadcast(&rp->more);
+    pthread_mutex_unlock(&rp->lock);
+    for (int i = 0; i < rp->nreaders; i++){
+        pthread_join(rp->readers[i].thread, NULL);
+        walker_free(&rp->walkers[i]);
+    }
+    pthread_mutex_destroy(&rp->lock);
+    pthread_cond_destroy(&rp->more);
+    pthread_cond_destroy(&rp->room);
+    free(rp->readers);
+    free(rp->walkers);
+    free(rp);
+}
+
+/**
+ *
+ * \brief: hands a regular file to the readers, waits while READ_QUEUE files are waiting already
+ *
+ * \param rp - the pool
+ * \param ent - the file, its path and stat data are copied
+ * \param root - its start point
+ *
+ */
+
+static void reads_push(struct readpool *rp, const struct find_entry *ent, const char *root){
+    char *path = strdup(ent->path);
+    if (path == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    pthread_mutex_lock(&rp->lock);
+    while (rp->count == READ_QUEUE){
+        pthread_cond_wait(&rp->room, &rp->lock);
+    }
+    struct readtask *t = &rp->items[(rp->head + rp->count) % READ_QUEUE];
+    t->path = path;
+    t->depth = ent->depth;
+    t->d_type = ent->d_type;
+    t->stat_mask = ent->stat_mask;
+    t->have_stat = ent->have_stat;
+    if (ent->have_stat == 1){
+        t->st = ent->st;
+    }
+    t->root = root;
+    rp->count++;
+    pthread_cond_signal(&rp->more);
+    pthread_mutex_unlock(&rp->lock);
+}
+
+/**
+ *
+ * \brief: main loop of a reader, evaluates the expression on the files handed over until the walk ended
+ *
+ * \param arg - the reader
+ *
+ * \return NULL
+ *
+ */
+
+static void *read_worker(void *arg){
+    struct reader *r = arg;
+    struct readpool *rp = r->pool;
+    struct walker *w = r->w;
+    thread_stats = w->stats;
+    for (;;){
+        pthread_mutex_lock(&rp->lock);
+        while (rp->count == 0 && !rp->done){
+            pthread_cond_wait(&rp->more, &rp->lock);
+        }
+        if (rp->count == 0){
+            pthread_mutex_unlock(&rp->lock);
+            break;
+        }
+        struct readtask t = rp->items[rp->head];
+        rp->head = (rp->head + 1) % READ_QUEUE;
+        rp->count--;
+        pthread_cond_signal(&rp->room);
+        pthread_mutex_unlock(&rp->lock);
+        if (!walk_stopped(w->plan)){
+            struct find_entry ent = {t.path, AT_FDCWD, t.path, t.d_type, t.stat_mask, t.have_stat, {0}, t.depth, 0};
+            if (t.have_stat == 1){
+                ent.st = t.st;
+            }
+            w->root = t.root;
+            w->effects = 0;
+            w->deferred = 0;
+            w->replay = 1;
+            eval_expr(w->plan->root, &ent, w);
+            if (w->sort != NULL){
+                sort_add(w, &ent);
+            }
+        }
+        free(t.path);
+    }
+    return NULL;
+}
+
+/**
+ *
+ * \brief: sets up the collection of the results for -sort
+ *
+ * Each walker and reader gets an equal share of -sort-mem. Once its results fill it, they
+ * are sorted and written to a temporary file as a run.
+ *
+ * \param plan - the compiled command line
+ *
+ * \return the sorter, handed to the walkers
+ *
+ */
+
+static struct sorter *sort_start(const struct plan *plan){
+    struct sorter *s = xmalloc(sizeof(*s));
+    size_t walkers = (size_t)plan->jobs;
+    if (plan->contains && plan->contains_jobs > 0){
+        walkers += (size_t)plan->contains_jobs;
+    }
+    s->key = plan->sort;
+    s->share = plan->sort_mem / walkers;
+    pthread_mutex_init(&s->lock, NULL);
+    s->runs = NULL;
+    s->nruns = 0;
+    s->cap = 0;
+    return s;
+}
+
+/**
+ *
+ * \brief: moves what the evaluation of an item wrote to stdout or handed to the sink into the sort buffer
+ *
+ * The record gets the sort key, the start point and the path, which decide its place.
+ * Items without a result are not kept.
+ *
+ * \param w - the walker
+ * \param ent - the item just evaluated
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_add(struct walker *w, struct find_entry *ent){
+    struct sortbuf *b = &w->sorted;
+    struct outbuf *ob = &w->out[0];
+    const struct plan *plan = w->plan;
+    struct stat *st;
+    if (ob->len == 0 && b->emits.len == 0){
+        return;
+    }
+    if (w->root != b->root || b->recs.buf == NULL){		//the start point of the last result mostly
+        b->root = w->root;
+        b->rootidx = 0;
+        b->rootlen = 0;
+        for (size_t k = 0; w->root != NULL && k < plan->npaths; k++){
+            if (plan->paths[k] == w->root){
+                b->rootidx = (uint32_t)k;
+                break;
+            }
+        }
+        if (w->root != NULL){
+            b->rootlen = strlen(w->root);
+            while (b->rootlen > 1 && w->root[b->rootlen - 1] == '/'){
+                b->rootlen--;
+            }
+        }
+    }
+    size_t pathlen = strlen(ent->path);
+    size_t rel = 0;
+    if (w->root != NULL && b->rootlen <= pathlen && memcmp(ent->path, w->root, b->rootlen) == 0){
+        rel = b->rootlen;
+        while (rel < pathlen && ent->path[rel] == '/'){
+            rel++;
+        }
+    }
+    uint64_t key = 0;
+    if (w->sort->key != SORT_NAME && (st = entry_stat(ent)) != NULL){
+        if (w->sort->key == SORT_SIZE){
+            key = (uint64_t)st->st_size;
+        }
+        else {
+            key = ((uint64_t)st->st_mtim.tv_sec * NSEC_PER_SEC + (uint64_t)st->st_mtim.tv_nsec) ^ (1ULL << 63);		//negative times first
+        }
+    }
+    size_t size = sizeof(struct sortrec) + pathlen + 1 + ob->len + b->emits.len;
+    size_t aligned = (size + 7) & ~(size_t)7;
+    if (b->recs.len + aligned > b->recs.cap){
+        size_t cap = b->recs.cap ? b->recs.cap : OUTBUF_SIZE;
+        while (b->recs.len + aligned > cap){
+            cap *= 2;
+        }
+        b->recs.buf = xrealloc(b->recs.buf, cap);
+        b->recs.cap = cap;
+    }
+    if (b->count == b->cap){
+        b->cap = b->cap ? b->cap * 2 : DEQUE_INITIAL;
+        b->refs = xrealloc(b->refs, b->cap * sizeof(*b->refs));
+    }
+    struct sortrec *rec = (struct sortrec *)(b->recs.buf + b->recs.len);
+    char *p = (char *)(rec + 1);
+    rec->key = key;
+    rec->root = b->rootidx;
+    rec->rel = (uint32_t)rel;
+    rec->pathlen = (uint32_t)pathlen;
+    rec->textlen = (uint32_t)ob->len;
+    rec->emitlen = (uint32_t)b->emits.len;
+    rec->pad = 0;
+    memcpy(p, ent->path, pathlen + 1);
+    memcpy(p + pathlen + 1, ob->buf, ob->len);
+    if (b->emits.len > 0){
+        memcpy(p + pathlen + 1 + ob->len, b->emits.buf, b->emits.len);
+    }
+    b->refs[b->count].key = key;
+    b->refs[b->count].off = b->recs.len;
+    b->count++;
+    b->recs.len += aligned;
+    ob->len = 0;
+    b->emits.len = 0;
+    if (b->recs.len + b->count * sizeof(*b->refs) >= w->sort->share){
+        sort_spill(w);
+    }
+}
+
+/**
+ *
+ * \brief: sorts the results of a walker and writes them to a temporary file as a run
+ *
+ * \param w - the walker, its sort buffer is empty again afterwards
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_spill(struct walker *w){
+    struct sortbuf *b = &w->sorted;
+    struct sorter *s = w->sort;
+    FILE *fp = sort_tmpfile();
+    qsort_r(b->refs, b->count, sizeof(*b->refs), sort_ref_cmp, b->recs.buf);
+    for (size_t i = 0; i < b->count; i++){
+        sort_put((const struct sortrec *)(b->recs.buf + b->refs[i].off), fp, NULL);
+    }
+    if (fflush(fp) != 0 || fseek(fp, 0, SEEK_SET) != 0){
+        error(EXIT_FAILURE, errno, "writing a sorted run");
+    }
+    b->recs.len = 0;
+    b->count = 0;
+    pthread_mutex_lock(&s->lock);
+    if (s->nruns == s->cap){
+        s->cap = s->cap ? s->cap * 2 : DEQUE_INITIAL;
+        s->runs = xrealloc(s->runs, s->cap * sizeof(*s->runs));
+    }
+    memset(&s->runs[s->nruns], 0, sizeof(s->runs[0]));
+    s->runs[s->nruns++].fp = fp;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ *
+ * \brief: hands the results a walker still holds to the sorter as a run in memory
+ *
+ * Afterwards the walker writes to stdout again, walker_free flushes what is left.
+ *
+ * \param w - the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_finish(struct walker *w){
+    struct sortbuf *b = &w->sorted;
+    struct sorter *s = w->sort;
+    if (s == NULL){
+        return;
+    }
+    free(b->emits.buf);
+    memset(&b->emits, 0, sizeof(b->emits));
+    if (b->count > 0){
+        qsort_r(b->refs, b->count, sizeof(*b->refs), sort_ref_cmp, b->recs.buf);
+        pthread_mutex_lock(&s->lock);
+        if (s->nruns == s->cap){
+            s->cap = s->cap ? s->cap * 2 : DEQUE_INITIAL;
+            s->runs = xrealloc(s->runs, s->cap * sizeof(*s->runs));
+        }
+        memset(&s->runs[s->nruns], 0, sizeof(s->runs[0]));
+        s->runs[s->nruns++].mem = *b;
+        pthread_mutex_unlock(&s->lock);
+        memset(b, 0, sizeof(*b));
+    }
+    free(b->recs.buf);
+    free(b->refs);
+    memset(b, 0, sizeof(*b));
+    w->sort = NULL;
+}
+
+/**
+ *
+ * \brief: merges the sorted runs of the walk and writes the results to stdout or hands them to the sink
+ *
+ * At most SORT_FANIN runs are merged at once, more are first merged into longer runs in
+ * temporary files, so the number of open files stays bounded.
+ *
+ * \param plan - the compiled command line
+ * \param s - the sorter, may be NULL, it is released
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_output(const struct plan *plan, struct sorter *s){
+    struct walker w;
+    if (s == NULL){
+        return;
+    }
+    while (s->nruns > SORT_FANIN){
+        FILE *fp = sort_tmpfile();
+        sort_merge(plan, s->runs, SORT_FANIN, fp, NULL);
+        if (fflush(fp) != 0 || fseek(fp, 0, SEEK_SET) != 0){
+            error(EXIT_FAILURE, errno, "writing a sorted run");
+        }
+        memmove(&s->runs[1], &s->runs[SORT_FANIN], (s->nruns - SORT_FANIN) * sizeof(*s->runs));
+        s->nruns -= SORT_FANIN - 1;
+        memset(&s->runs[0], 0, sizeof(s->runs[0]));
+        s->runs[0].fp = fp;
+    }
+    walker_init(&w, plan, NULL, 0);
+    exit_walkers = &w;
+    exit_nwalkers = 1;
+    sort_merge(plan, s->runs, s->nruns, NULL, &w);
+    walker_free(&w);
+    exit_nwalkers = 0;
+    pthread_mutex_destroy(&s->lock);
+    free(s->runs);
+    free(s);
+}
+
+/**
+ *
+ * \brief: merges sorted runs with a binary heap of their current results and releases them
+ *
+ * \param plan - the compiled command line, the merge ends early once the walk is stopped
+ * \param runs - the runs
+ * \param n - their number
+ * \param to - file of the merged run, NULL to write the results out
+ * \param w - walker writing them, NULL if to is given
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_merge(const struct plan *plan, struct sortrun *runs, size_t n, FILE *to, struct walker *w){
+    size_t *heap = xmalloc((n ? n : 1) * sizeof(*heap));
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++){
+        sort_next(&runs[i]);
+        if (runs[i].head != NULL){
+            heap[count++] = i;
+        }
+    }
+    for (size_t i = count / 2; i-- > 0;){
+        sort_sift(runs, heap, count, i);
+    }
+    while (count > 0 && (to != NULL || !walk_stopped(plan))){
+        struct sortrun *r = &runs[heap[0]];
+        sort_put(r->head, to, w);
+        sort_next(r);
+        if (r->head == NULL){
+            heap[0] = heap[--count];
+        }
+        sort_sift(runs, heap, count, 0);
+    }
+    for (size_t i = 0; i < n; i++){
+        if (runs[i].fp != NULL){
+            fclose(runs[i].fp);
+        }
+        free(runs[i].mem.recs.buf);
+        free(runs[i].mem.refs);
+        free(runs[i].rec.buf);
+    }
+    free(heap);
+}
+
+/**
+ *
+ * \brief: moves a run down the heap of the merge until its current result is in place
+ *
+ * \param runs - the runs
+ * \param heap - indexes of the runs with results left, the smallest result on top
+ * \param count - number of those
+ * \param i - position of the run that moved
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_sift(struct sortrun *runs, size_t *heap, size_t count, size_t i){
+    for (;;){
+        size_t min = i;
+        for (size_t c = 2 * i + 1; c <= 2 * i + 2 && c < count; c++){
+            int rc = sort_cmp(runs[heap[c]].head, runs[heap[min]].head);
+            if (rc < 0 || (rc == 0 && heap[c] < heap[min])){		//equal results keep the order of the runs
+                min = c;
+            }
+        }
+        if (min == i){
+            return;
+        }
+        size_t t = heap[i];
+        heap[i] = heap[min];
+        heap[min] = t;
+        i = min;
+    }
+}
+
+/**
+ *
+ * \brief: moves a run to its next result
+ *
+ * \param run - the run, its head is NULL once it is used up
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_next(struct sortrun *run){
+    if (run->fp == NULL){
+        run->head = run->pos < run->mem.count ? (struct sortrec *)(run->mem.recs.buf + run->mem.refs[run->pos++].off) : NULL;
+        return;
+    }
+    struct sortrec rec;
+    run->head = NULL;
+    if (fread(&rec, sizeof(rec), 1, run->fp) != 1){
+        if (ferror(run->fp)){
+            error(EXIT_FAILURE, errno, "reading a sorted run");
+        }
+        return;
+    }
+    size_t body = (size_t)rec.pathlen + 1 + rec.textlen + rec.emitlen;
+    if (run->rec.cap < sizeof(rec) + body){
+        run->rec.cap = sizeof(rec) + body > OUTBUF_SIZE ? sizeof(rec) + body : OUTBUF_SIZE;
+        free(run->rec.buf);
+        run->rec.buf = xmalloc(run->rec.cap);
+    }
+    memcpy(run->rec.buf, &rec, sizeof(rec));
+    if (fread(run->rec.buf + sizeof(rec), 1, body, run->fp) != body){
+        error(EXIT_FAILURE, ferror(run->fp) ? errno : 0, "reading a sorted run");
+    }
+    run->head = (struct sortrec *)run->rec.buf;
+}
+
+/**
+ *
+ * \brief: writes a result to a run, or writes its text to stdout and hands its items to the sink
+ *
+ * \param rec - the result
+ * \param to - file of a run, NULL to write the result out
+ * \param w - the walker writing it, NULL if to is given
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void sort_put(const struct sortrec *rec, FILE *to, struct walker *w){
+    const char *path = (const char *)(rec + 1);
+    const char *text = path + rec->pathlen + 1;
+    if (to != NULL){
+        if (fwrite(rec, sizeof(*rec) + rec->pathlen + 1 + rec->textlen + rec->emitlen, 1, to) != 1){
+            error(EXIT_FAILURE, errno, "writing a sorted run");
+        }
+        return;
+    }
+    if (rec->textlen > 0){
+        char *p = out_reserve(w, 0, rec->textlen);
+        memcpy(p, text, rec->textlen);
+        out_commit(w, 0, p + rec->textlen);
+    }
+    for (size_t off = 0; off < rec->emitlen; off += sizeof(struct find_entry)){
+        struct find_entry ent;
+        memcpy(&ent, text + rec->textlen + off, sizeof(ent));
+        ent.path = path;
+        ent.name = path;
+        ent.dirfd = AT_FDCWD;
+        do_emit(w, &ent);
+    }
+}
+
+/**
+ *
+ * \brief: creates a temporary file for a sorted run in $TMPDIR or /tmp, it is unlinked right away
+ *
+ * \return the file opened for writing and reading back
+ *
+ */
+
+static FILE *sort_tmpfile(void){
+    const char *dir = getenv("TMPDIR");
+    if (dir == NULL || *dir == '\0'){
+        dir = "/tmp";
+    }
+    char *name = xmalloc(strlen(dir) + sizeof("/find.XXXXXX"));
+    sprintf(name, "%s/find.XXXXXX", dir);
+    int fd = mkstemp(name);
+    if (fd == -1){
+        error(EXIT_FAILURE, errno, "%s", name);
+    }
+    unlink(name);
+    free(name);
+    FILE *fp = fdopen(fd, "w+");
+    if (fp == NULL){
+        error(EXIT_FAILURE, errno, "fdopen");
+    }
+    return fp;
+}
+
+/**
+ *
+ * \brief: compares two results of -sort
+ *
+ * The key comes first, then the start point, then the path below it in the order of
+ * walk_cmp.
+ *
+ * \param a - the first result
+ * \param b - the second result
+ *
+ * \return less than, equal to or greater than 0
+ *
+ */
+
+static int sort_cmp(const struct sortrec *a, const struct sortrec *b){
+    if (a->key != b->key){
+        return a->key < b->key ? -1 : 1;
+    }
+    if (a->root != b->root){
+        return a->root < b->root ? -1 : 1;
+    }
+    return walk_cmp((const char *)(a + 1) + a->rel, (const char *)(b + 1) + b->rel);
+}
+
+/**
+ *
+ * \brief: qsort_r comparison of two results in the sort buffer of a walker
+ *
+ * \param a - the first sortref
+ * \param b - the second sortref
+ * \param base - the records of the buffer
+ *
+ * \return less than, equal to or greater than 0
+ *
+ */
+
+static int sort_ref_cmp(const void *a, const void *b, void *base){
+    const struct sortref *x = a;
+    const struct sortref *y = b;
+    if (x->key != y->key){		//the packed key decides most comparisons of -sort size and mtime
+        return x->key < y->key ? -1 : 1;
+    }
+    return sort_cmp((const struct sortrec *)((char *)base + x->off), (const struct sortrec *)((char *)base + y->off));
+}
+
+/**
+ *
+ * \brief: compares two paths below the same start point in the order of the sequential walk with -sort name
+ *
+ * The names of a directory are compared byte by byte, and the items of a directory come
+ * before everything below its subdirectories.
+ *
+ * \param p - the first path, relative to the start point
+ * \param q - the second path
+ *
+ * \return less than, equal to or greater than 0
+ *
+ */
+
+static int walk_cmp(const char *p, const char *q){
+    size_t i = 0;
+    size_t name = 0;		//start of the name the paths differ in
+    while (p[i] == q[i] && p[i] != '\0'){
+        if (p[i] == '/'){
+            name = i + 1;
+        }
+        i++;
+    }
+    if (p[i] == q[i]){
+        return 0;
+    }
+    int pdeep = strchr(p + name, '/') != NULL;
+    int qdeep = strchr(q + name, '/') != NULL;
+    if (pdeep != qdeep){
+        return pdeep - qdeep;
+    }
+    unsigned char pc = p[i] == '/' ? 0 : (unsigned char)p[i];		//a name ends at the slash
+    unsigned char qc = q[i] == '/' ? 0 : (unsigned char)q[i];
+    return pc < qc ? -1 : 1;
+}
+
+/**
+ *
+ * \brief: queues a directory at the bottom of the own deque
+ *
+ * \param w - the walker that found the directory
+ * \param path - whole path of the directory, it is copied
+ * \param depth - depth of the directory
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void pool_push(struct walker *w, const char *path, int depth){
+    struct pool *pool = w->pool;
+    struct deque *dq = &pool->deques[w->id];
+    char *copy = strdup(path);
+    if (copy == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    atomic_fetch_add(&pool->pending, 1);
+    pthread_mutex_lock(&dq->lock);
+    deque_push(dq, copy, depth, w->dev, w->root);
+    pthread_mutex_unlock(&dq->lock);
+
+    pthread_mutex_lock(&pool->idle_lock);
+    if (pool->idle > 0){
+        pthread_cond_signal(&pool->idle_cond);
+    }
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+/**
+ *
+ * \brief: appends a directory at the bottom of a deque, the caller holds its lock if it is shared
+ *
+ * \param dq - the deque
+ * \param path - whole path of the directory, the deque takes it over
+ * \param depth - depth of the directory
+ * \param dev - device of its start point
+ * \param root - its start point
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void deque_push(struct deque *dq, char *path, int depth, dev_t dev, const char *root){
+    if (dq->count == dq->cap){		//grow and unwrap the ring
+        size_t cap = dq->cap ? dq->cap * 2 : DEQUE_INITIAL;
+        struct task *items = xmalloc(cap * sizeof(*items));
+        for (size_t i = 0; i < dq->count; i++){
+            items[i] = dq->items[(dq->head + i) % dq->cap];
+        }
+        free(dq->items);
+        dq->items = items;
+        dq->head = 0;
+        dq->cap = cap;
+    }
+    dq->items[(dq->head + dq->count) % dq->cap].path = path;
+    dq->items[(dq->head + dq->count) % dq->cap].depth = depth;
+    dq->items[(dq->head + dq->count) % dq->cap].dev = dev;
+    dq->items[(dq->head + dq->count) % dq->cap].root = root;
+    dq->count++;
+}
+
+/**
+ *
+ * \brief: takes the next directory, newest first from the own deque, otherwise oldest first from another one
+ *
+ * Taking the newest own task keeps the walk depth first and the cache warm,
+ * stealing the oldest task of another worker takes the biggest subtree.
+ *
+ * \param w - the walker looking for work
+ * \param task - receives the directory, the caller frees its path
+ *
+ * \return 1 if a task was taken, 0 if all deques are empty
+ *
+ */
+
+static int pool_take(struct walker *w, struct task *task){
+    struct pool *pool = w->pool;
+    int found = 0;
+    struct deque *dq = &pool->deques[w->id];
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count > 0 && w->plan->bfs){		//breadth first order takes the oldest own task as well
+        *task = dq->items[dq->head];
+        dq->head = (dq->head + 1) % dq->cap;
+        dq->count--;
+        found = 1;
+    }
+    else if (dq->count > 0){
+        dq->count--;
+        *task = dq->items[(dq->head + dq->count) % dq->cap];
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+
+    for (int k = 1; !found && k < pool->nworkers; k++){
+        dq = &pool->deques[(w->id + k) % pool->nworkers];
+        pthread_mutex_lock(&dq->lock);
+        if (dq->count > 0){
+            *task = dq->items[dq->head];
+            dq->head = (dq->head + 1) % dq->cap;
+            dq->count--;
+            found = 1;
+        }
+        pthread_mutex_unlock(&dq->lock);
+    }
+    return found;
+}
+
+
+/*
+ *
+ * \brief: do_entry function takes a start point and the compiled command line
+ * it checks the item and descends into it if it is a directory.
+ *
+ *
+ * \param ent passes the item that should be checked
+ * \param w is the walker with the compiled command line and the path buffer
+ *
+ * \return: void function no value returned
+ * */
+
+static void do_entry(struct find_entry *ent, struct walker *w){
+    if (do_visit(ent, w)){
+        do_descend(ent, w);
+    }
+}
+
+/**
+ *
+ * \brief: checks an item and decides whether it is read as a directory
+ *
+ * The expression of the plan is evaluated, which runs the actions of the matching branches,
+ * unless the item is above -mindepth. Directories matching -skip-dir are left out altogether.
+ * The item is only passed to lstat if a predicate, the type check or -xdev needs it.
+ *
+ * \param ent is the item
+ * \param w is the walker
+ *
+ * \return 1 if the item is a directory that has to be read, 0 otherwise
+ *
+ */
+
+static int do_visit(struct find_entry *ent, struct walker *w){
+    const struct plan *plan = w->plan;
+    struct stat *st;
+    if (walk_stopped(plan)){
+        return 0;
+    }
+    if (w->stats != NULL){
+        w->stats->entries++;
+    }
+    if (plan->skip != NULL && ent->depth > 0){
+        const char *name = ent->dirfd == AT_FDCWD ? strrchr(ent->path, '/') + 1 : ent->name;		//records of an index only have their path
+        if (match_patset(plan->skip, name, strlen(name)) && entry_type(ent) == S_IFDIR){
+            return 0;
+        }
+    }
+    int changed = 1;
+    if (w->since.tv_sec != 0 || w->since.tv_nsec != 0){		//rescan of -watch: only items changed since the previous one
+        changed = (st = entry_stat(ent)) != NULL && (st->st_ctim.tv_sec > w->since.tv_sec
+            || (st->st_ctim.tv_sec == w->since.tv_sec && st->st_ctim.tv_nsec >= w->since.tv_nsec));
+    }
+    if (changed && ent->depth >= plan->mindepth){
+        w->effects = 0;
+        w->deferred = 0;
+        eval_expr(plan->root, ent, w);
+        if (w->sort != NULL){
+            sort_add(w, ent);
+        }
+    }
+    if (ent->prune || ent->depth >= plan->maxdepth || entry_type(ent) != S_IFDIR){
+        return 0;
+    }
+    if (plan->xdev && ent->depth > 0 && ((st = entry_stat(ent)) == NULL || st->st_dev != w->dev)){
+        return 0;		//a mount point is still checked, but not read
+    }
+    return 1;
+}
+
+/**
+ *
+ * \brief: reads a directory, or queues it in the parallel walk
+ *
+ * \param ent is the directory that has already been checked
+ * \param w is the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void do_descend(struct find_entry *ent, struct walker *w){
+    if (w->pool != NULL){		//in the parallel walk the directory becomes a task
+        pool_push(w, ent->path, ent->depth);
+    }
+    else {
+        do_dir(ent,w);
+    }
+}
+
+/**
+ *
+ * \brief: returns the stat data of an item and fetches it the first time it is needed
+ *
+ * The item is looked up relative to its directory with statx, which is only asked for
+ * the fields in the stat mask of the plan. Kernels without statx get fstatat instead.
+ * Symbolic links are never followed.
+ *
+ * \param ent - the item
+ *
+ * \return the stat data or NULL if the stat call failed
+ *
+ */
+
+static struct stat *entry_stat(struct find_entry *ent){
+    static atomic_int no_statx = 0;	//set once the kernel rejected statx
+    if (ent->have_stat == 0){
+        struct statx stx;
+        int rc = -1;
+        uint64_t start = thread_stats != NULL ? stats_ticks() : 0;
+        errno=0;
+        if (!no_statx){
+            rc = statx(ent->dirfd, ent->name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, ent->stat_mask, &stx);
+            if (rc == 0){
+                statx_to_stat(&stx, &ent->st);
+            }
+            else if (errno == ENOSYS){
+                no_statx = 1;
+            }
+        }
+        if (no_statx){
+            rc = fstatat(ent->dirfd, ent->name, &ent->st, AT_SYMLINK_NOFOLLOW);
+        }
+        if (thread_stats != NULL){
+            thread_stats->stats++;
+            thread_stats->stat_ticks += stats_ticks() - start;
+        }
+        if (rc == -1){
+            error(0,errno,"lstat failed: %s", ent->path);
+            ent->have_stat = -1;
+        }
+        else {
+            ent->have_stat = 1;
+        }
+    }
+    return ent->have_stat == 1 ? &ent->st : NULL;
+}
+
+/**
+ *
+ * \brief: copies the result of statx into a struct stat for the predicates
+ *
+ * Fields that were not requested are copied as well, the predicates only read requested ones.
+ *
+ * \param stx - result of statx
+ * \param st - receives the converted data
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void statx_to_stat(const struct statx *stx, struct stat *st){
+    memset(st, 0, sizeof(*st));
+    st->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    st->st_ino = stx->stx_ino;
+    st->st_mode = stx->stx_mode;
+    st->st_nlink = stx->stx_nlink;
+    st->st_uid = stx->stx_uid;
+    st->st_gid = stx->stx_gid;
+    st->st_rdev = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+    st->st_size = (off_t)stx->stx_size;
+    st->st_blksize = stx->stx_blksize;
+    st->st_blocks = (blkcnt_t)stx->stx_blocks;
+    st->st_atim.tv_sec = stx->stx_atime.tv_sec;
+    st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+    st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+    st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+    st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+    st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+
+/**
+ *
+ * \brief: returns the file type of an item, taken from getdents64 if the filesystem reported it
+ *
+ * \param ent - the item
+ *
+ * \return the S_IFMT bits of the item or 0 if the type cannot be determined
+ *
+ */
+
+static mode_t entry_type(struct find_entry *ent){
+    switch (ent->d_type){
+        case DT_DIR:  return S_IFDIR;
+        case DT_REG:  return S_IFREG;
+        case DT_LNK:  return S_IFLNK;
+        case DT_CHR:  return S_IFCHR;
+        case DT_BLK:  return S_IFBLK;
+        case DT_FIFO: return S_IFIFO;
+        case DT_SOCK: return S_IFSOCK;
+        default: break;
+    }
+    struct stat *st = entry_stat(ent);
+    return st != NULL ? (st->st_mode & S_IFMT) : 0;
+}
+
+/**
+ *
+ * \brief: evaluates one node of the compiled expression for an entry
+ *
+ * -a and -o short circuit like in POSIX find, actions always evaluate to true.
+ * Predicates that need inode data fail for items lstat cannot read.
+ *
+ * \param e - node to evaluate
+ * \param ent - the item
+ * \param w - the walker, the actions write into its output buffers
+ *
+ * \return 1 if the entry matches the node, 0 otherwise
+ *
+ */
+
+static int eval_expr(const struct expr *e, struct find_entry *ent, struct walker *w){
+    switch (e->kind){
+        case EXPR_AND:
+            if (e->group >= 0){
+                return eval_ordered(e, ent, w);
+            }
+            for (size_t i = 0; i < e->nkids; i++){
+                if (!eval_expr(e->kids[i], ent, w)){
+                    return 0;
+                }
+            }
+            return 1;
+        case EXPR_OR:
+            if (e->group >= 0){
+                return eval_ordered(e, ent, w);
+            }
+            for (size_t i = 0; i < e->nkids; i++){
+                if (eval_expr(e->kids[i], ent, w)){
+                    return 1;
+                }
+            }
+            return 0;
+        case EXPR_NOT:
+            return !eval_expr(e->kids[0], ent, w);
+        default:
+            if (w->deferred){		//the readers of -contains evaluate the item again
+                return 0;
+            }
+            if (w->stats == NULL || (w->replay && e->kind != EXPR_CONTAINS)){
+                return eval_primary(e, ent, w);
+            }
+            return eval_counted(e, ent, w);
+    }
+}
+
+/**
+ *
+ * \brief: evaluates a primary, the actions among them write their output
+ *
+ * \param e - the primary
+ * \param ent - the item
+ * \param w - the walker
+ *
+ * \return 1 if the item matches, 0 otherwise
+ *
+ */
+
+static int eval_primary(const struct expr *e, struct find_entry *ent, struct walker *w){
+    struct stat *st;
+    switch (e->kind){
+        case EXPR_AND:
+        case EXPR_OR:
+        case EXPR_NOT:
+            break;
+        case EXPR_NAME:
+        case EXPR_NAME_FROM:
+            return do_name(ent, e);
+        case EXPR_PATH:
+        case EXPR_PATH_FROM:
+            return do_path(ent->path, e);
+        case EXPR_REGEX:
+            return do_regex(ent->path, e, w);
+        case EXPR_CONTAINS:
+            return do_contains(ent, e, w);
+        case EXPR_TYPE:
+            return do_type(e->arg.type, ent);
+        case EXPR_USER:
+            return (st = entry_stat(ent)) != NULL && do_user(st, e->arg.uid);
+        case EXPR_GROUP:
+            return (st = entry_stat(ent)) != NULL && do_group(st, e->arg.gid);
+        case EXPR_NOUSER:
+            return (st = entry_stat(ent)) != NULL && do_nouser(st);
+        case EXPR_NOGROUP:
+            return (st = entry_stat(ent)) != NULL && do_nogroup(st);
+        case EXPR_SIZE:
+        case EXPR_TIME:
+        case EXPR_INUM:
+        case EXPR_LINKS:
+            return (st = entry_stat(ent)) != NULL && do_range(e, st);
+        case EXPR_PERM:
+            return (st = entry_stat(ent)) != NULL && do_perm(e, st);
+        case EXPR_EMPTY:
+            return (st = entry_stat(ent)) != NULL && do_empty(ent, st);
+        case EXPR_PRINT:
+            w->effects = 1;
+            if (w->plan->sink != NULL && e->arg.print.out == 0){		//the library takes the results of stdout
+                do_emit(w, ent);
+            }
+            else if (w->plan->format != FORMAT_TEXT){
+                do_record(w, e->arg.print.out, ent);
+            }
+            else {
+                do_print(w, e->arg.print.out, ent->path, e->arg.print.term);
+            }
+            return 1;
+        case EXPR_PRINTF:
+            w->effects = 1;
+            do_printf(w, e->arg.printf.out, e->arg.printf.fmt, ent);
+            return 1;
+        case EXPR_LS:
+            w->effects = 1;
+            if ((st = entry_stat(ent)) != NULL){
+                do_ls(w, e->arg.print.out, ent->path, st);
+            }
+            return 1;
+        case EXPR_PRUNE:
+            ent->prune = 1;
+            return 1;
+        case EXPR_EXEC:
+            w->effects = 1;
+            return do_exec(e->arg.exec, ent, w);
+        case EXPR_TRUE:
+            return 1;
+    }
+    error(EXIT_FAILURE, 0, "unknown expression node");
+    return 0;
+}
+
+/**
+ *
+ * \brief: evaluates a primary for -stats and counts how often it ran, matched and how long it took
+ *
+ * Every STATS_SAMPLE-th evaluation is timed, the report scales the time up.
+ *
+ * \param e - the primary
+ * \param ent - the item
+ * \param w - the walker, its counters are updated
+ *
+ * \return 1 if the item matches, 0 otherwise
+ *
+ */
+
+static int eval_counted(const struct expr *e, struct find_entry *ent, struct walker *w){
+    struct stats *st = w->stats;
+    int match;
+    if (e->id < 0){		//options always match, they are not listed
+        return 1;
+    }
+    if (st->evals[e->id]++ % STATS_SAMPLE != 0){		//reading the clock costs more than most primaries
+        match = eval_primary(e, ent, w);
+    }
+    else {
+        uint64_t start = stats_ticks();
+        match = eval_primary(e, ent, w);
+        st->ticks[e->id] += stats_ticks() - start;
+        st->timed[e->id]++;
+    }
+    if (w->deferred){		//counted by the reader that evaluates the item again
+        st->evals[e->id]--;
+        return 0;
+    }
+    st->passes[e->id] += (uint64_t)match;
+    return match;
+}
+
+/**
+ *
+ * \brief: a cheap timestamp for -stats, the time stamp counter where there is one
+ *
+ * \return the ticks, stats_report converts them to nanoseconds
+ *
+ */
+
+static uint64_t stats_ticks(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ *
+ * \brief: clears a set of -stats counters
+ *
+ * \param st - the counters
+ * \param nnodes - number of primaries of the plan
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void stats_init(struct stats *st, size_t nnodes){
+    memset(st, 0, sizeof(*st));
+    st->evals = xmalloc((4 * nnodes + 1) * sizeof(uint64_t));
+    memset(st->evals, 0, (4 * nnodes + 1) * sizeof(uint64_t));
+    st->passes = st->evals + nnodes;
+    st->ticks = st->passes + nnodes;
+    st->timed = st->ticks + nnodes;
+}
+
+/**
+ *
+ * \brief: gives a primary its place in the -stats counters
+ *
+ * \param plan - the plan the primary belongs to
+ * \param e - the primary
+ * \param arg - its name
+ * \param value - its argument, NULL if it takes none
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void stats_add_node(struct plan *plan, struct expr *e, const char *arg, const char *value){
+    size_t len = strlen(arg) + (value != NULL ? strlen(value) + 1 : 0);
+    e->label = xmalloc(len + 1);
+    snprintf(e->label, len + 1, value != NULL ? "%s %s" : "%s", arg, value);
+    e->id = (int)plan->nnodes;
+    plan->nodes = xrealloc(plan->nodes, (plan->nnodes + 1) * sizeof(*plan->nodes));
+    plan->nodes[plan->nnodes++] = e;
+}
+
+/**
+ *
+ * \brief: adds the counters of a walker that is done to the total
+ *
+ * \param plan - the plan
+ * \param st - the counters of the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void stats_merge(const struct plan *plan, const struct stats *st){
+    struct stats *t = &stats_total;
+    pthread_mutex_lock(&stats_lock);
+    t->dirs += st->dirs;
+    t->reopens += st->reopens;
+    t->cached += st->cached;
+    t->entries += st->entries;
+    t->getdents += st->getdents;
+    t->getdents_ticks += st->getdents_ticks;
+    t->stats += st->stats;
+    t->stat_ticks += st->stat_ticks;
+    t->batched += st->batched;
+    t->nss += st->nss;
+    t->nss_ticks += st->nss_ticks;
+    t->writes += st->writes;
+    t->write_bytes += st->write_bytes;
+    t->write_ticks += st->write_ticks;
+    t->execs += st->execs;
+    t->exec_ticks += st->exec_ticks;
+    t->reads += st->reads;
+    t->read_bytes += st->read_bytes;
+    t->read_ticks += st->read_ticks;
+    for (size_t i = 0; i < plan->nnodes; i++){
+        t->evals[i] += st->evals[i];
+        t->passes[i] += st->passes[i];
+        t->ticks[i] += st->ticks[i];
+        t->timed[i] += st->timed[i];
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/**
+ *
+ * \brief: prints the statistics of the walk to stderr, as a table or as one JSON object
+ *
+ * The ticks are converted to nanoseconds with the rate measured over the whole walk,
+ * the times of the primaries are estimated from the timed sample. They include the stat calls and lookups they caused, the times of
+ * parallel walkers add up, so they can exceed the wall clock time.
+ *
+ * \param plan - the plan, nothing is printed without -stats
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void stats_report(const struct plan *plan){
+    const struct stats *t = &stats_total;
+    struct timespec now;
+    if (!plan->stats){
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double wall = (double)(now.tv_sec - stats_start_time.tv_sec) * 1e9 + (double)(now.tv_nsec - stats_start_time.tv_nsec);
+    uint64_t ticks = stats_ticks() - stats_start_ticks;
+    double ns = ticks > 0 ? wall / (double)ticks : 1;		//nanoseconds per tick
+
+    if (plan->stats == 2){
+        fprintf(stderr, "{\"seconds\":%.6f,\"threads\":%d,\"dirs\":%" PRIu64 ",\"reopens\":%" PRIu64 ",\"cached\":%" PRIu64 ",\"entries\":%" PRIu64,
+            wall / 1e9, plan->jobs, t->dirs, t->reopens, t->cached, t->entries);
+        fprintf(stderr, ",\"getdents\":{\"calls\":%" PRIu64 ",\"ns\":%.0f}", t->getdents, (double)t->getdents_ticks * ns);
+        fprintf(stderr, ",\"stat\":{\"calls\":%" PRIu64 ",\"ns\":%.0f,\"uring\":%" PRIu64 "}", t->stats, (double)t->stat_ticks * ns, t->batched);
+        fprintf(stderr, ",\"nss\":{\"calls\":%" PRIu64 ",\"ns\":%.0f}", t->nss, (double)t->nss_ticks * ns);
+        fprintf(stderr, ",\"output\":{\"writes\":%" PRIu64 ",\"bytes\":%" PRIu64 ",\"ns\":%.0f}", t->writes, t->write_bytes, (double)t->write_ticks * ns);
+        fprintf(stderr, ",\"exec\":{\"commands\":%" PRIu64 ",\"ns\":%.0f}", t->execs, (double)t->exec_ticks * ns);
+        fprintf(stderr, ",\"contents\":{\"files\":%" PRIu64 ",\"bytes\":%" PRIu64 ",\"ns\":%.0f}", t->reads, t->read_bytes, (double)t->read_ticks * ns);
+        fprintf(stderr, ",\"predicates\":[");
+        for (size_t i = 0; i < plan->nnodes; i++){
+            fprintf(stderr, "%s{\"expr\":", i > 0 ? "," : "");
+            stats_json_string(stderr, plan->nodes[i]->label);
+            double total = t->timed[i] ? (double)t->ticks[i] * ns * (double)t->evals[i] / (double)t->timed[i] : 0;
+            fprintf(stderr, ",\"evals\":%" PRIu64 ",\"passed\":%" PRIu64 ",\"ns\":%.0f}", t->evals[i], t->passes[i], total);
+        }
+        fprintf(stderr, "]}\n");
+        return;
+    }
+    fprintf(stderr, "find statistics: %.3f s, %d thread%s\n", wall / 1e9, plan->jobs, plan->jobs > 1 ? "s" : "");
+    fprintf(stderr, "  %-22s %12" PRIu64 "  (%" PRIu64 " reopened)\n", "directories opened", t->dirs, t->reopens);
+    fprintf(stderr, "  %-22s %12" PRIu64 "\n", "listed from the cache", t->cached);
+    fprintf(stderr, "  %-22s %12" PRIu64 "\n", "entries checked", t->entries);
+    fprintf(stderr, "  %-22s %12" PRIu64 "  %10.3f ms\n", "getdents64 calls", t->getdents, (double)t->getdents_ticks * ns / 1e6);
+    fprintf(stderr, "  %-22s %12" PRIu64 "  %10.3f ms\n", "stat calls", t->stats, (double)t->stat_ticks * ns / 1e6);
+    fprintf(stderr, "  %-22s %12" PRIu64 "\n", "statx through io_uring", t->batched);
+    fprintf(stderr, "  %-22s %12" PRIu64 "  %10.3f ms\n", "user/group lookups", t->nss, (double)t->nss_ticks * ns / 1e6);
+    fprintf(stderr, "  %-22s %12" PRIu64 "  %10.3f ms  %" PRIu64 " bytes\n", "output writes", t->writes, (double)t->write_ticks * ns / 1e6, t->write_bytes);
+    fprintf(stderr, "  %-22s %12" PRIu64 "  %10.3f ms\n", "commands started", t->execs, (double)t->exec_ticks * ns / 1e6);
+    fprintf(stderr, "  %-22s %12" PRIu64 "  %10.3f ms  %" PRIu64 " bytes\n", "files read", t->reads, (double)t->read_ticks * ns / 1e6, t->read_bytes);
+    fprintf(stderr, "  %-22s %12s %12s %7s %10s %12s\n", "primary", "evaluated", "passed", "rate", "ns/eval", "total ms");
+    for (size_t i = 0; i < plan->nnodes; i++){
+        double total = t->timed[i] ? (double)t->ticks[i] * ns * (double)t->evals[i] / (double)t->timed[i] : 0;
+        fprintf(stderr, "  %-22.22s %12" PRIu64 " %12" PRIu64 " %6.1f%% %10.1f %12.3f\n", plan->nodes[i]->label, t->evals[i], t->passes[i],
+            t->evals[i] ? 100.0 * (double)t->passes[i] / (double)t->evals[i] : 0.0, t->evals[i] ? total / (double)t->evals[i] : 0.0, total / 1e6);
+    }
+}
+
+/**
+ *
+ * \brief: writes a string as a JSON string literal
+ *
+ * \param fp - the stream
+ * \param str - the string, bytes above 0x7f are passed through
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void stats_json_string(FILE *fp, const char *str){
+    putc('"', fp);
+    for (const unsigned char *c = (const unsigned char *)str; *c != '\0'; c++){
+        if (*c == '"' || *c == '\\'){
+            fprintf(fp, "\\%c", *c);
+        }
+        else if (*c < 0x20){
+            fprintf(fp, "\\u%04x", *c);
+        }
+        else {
+            putc(*c, fp);
+        }
+    }
+    putc('"', fp);
+}
+
+/**
+ *
+ * \brief: writes the index of the start points (-build-index)
+ *
+ * If the file already holds an index, directories whose modification time did not change
+ * are not read again: their items are copied from the old index and only subdirectories
+ * are looked at, as a new item in them would have changed their own time. Directories
+ * changed within DIRCACHE_RACY_SEC of the start of the old build are read again, like in
+ * the cache of -daemon, an item added in the same timestamp tick would be missed. Like locate,
+ * the stat data of files in unchanged directories is taken over as it was.
+ * The new index is written under a temporary name and renamed over the old one.
+ *
+ * \param plan - the compiled command line
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void build_index(const struct plan *plan){
+    struct index_build ib;
+    int fd;
+
+    memset(&ib, 0, sizeof(ib));
+    ib.plan = plan;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    ib.built = (uint64_t)now.tv_sec * NSEC_PER_SEC + (uint64_t)now.tv_nsec;
+    ib.old = index_open(plan->index_out, 1);
+    ib.cur.ix = ib.old;
+    ib.tmpname = xmalloc(strlen(plan->index_out) + 8);
+    sprintf(ib.tmpname, "%s.XXXXXX", plan->index_out);
+    if ((fd = mkstemp(ib.tmpname)) == -1 || (ib.fp = fdopen(fd, "w")) == NULL){
+        error(EXIT_FAILURE, errno, "%s", ib.tmpname);
+    }
+    struct index_header header;
+    memset(&header, 0, sizeof(header));		//the real header is written at the end
+    fwrite(&header, sizeof(header), 1, ib.fp);
+    walker_init(&ib.w, plan, NULL, 0);
+    ib.w.dirbuf = xmalloc(plan->dirbuf_size);
+
+    for (size_t i = 0; i < plan->npaths; i++){
+        struct index_rec r;
+        char *root = index_path(plan->paths[i]);
+        path_set(&ib.w.pb, root);
+        free(root);
+        struct find_entry ent = {ib.w.pb.buf, AT_FDCWD, ib.w.pb.buf, DT_UNKNOWN, INDEX_MASK | STATX_CTIME, 0, {0}, 0, 0};
+        if (entry_stat(&ent) == NULL){
+            exit_status = 1;
+            continue;
+        }
+        index_rec_set(&r, &ent.st, INDEX_NONE, 0);
+        ib.dev = ent.st.st_dev;
+        uint32_t rec = index_add(&ib, ib.w.pb.buf, &r);
+        if (index_descend(&ib, rec) && index_push(&ib, AT_FDCWD, ib.w.pb.buf, rec)){
+            while (ib.w.nframes > 0){
+                index_step(&ib);
+            }
+        }
+    }
+    index_write(&ib, plan->index_out);
+
+    if (ib.old != NULL){
+        index_close(ib.old);
+    }
+    free(ib.cur.path.buf);
+    free(ib.recs);
+    free(ib.restarts);
+    free(ib.prev.buf);
+    walker_free(&ib.w);
+    free(ib.tmpname);
+}
+
+/**
+ *
+ * \brief: opens a directory, adds its items to the index and puts it on the directory stack
+ *
+ * All items of one directory are added before any subdirectory is read, so they form
+ * one contiguous run of records that a refresh can copy. The names of its subdirectories
+ * are left on the name stack, index_step reads them; like dir_push the outermost open
+ * directory gives its descriptor back when the walk holds more than -fd-budget.
+ *
+ * \param ib - the index being built, its path buffer holds the path of the directory
+ * \param dirfd - descriptor of the parent directory, AT_FDCWD if the path buffer is opened
+ * \param name - name of the directory relative to dirfd
+ * \param rec - record of the directory
+ *
+ * \return 1 if the directory was pushed, 0 if it could not be opened
+ *
+ */
+
+static int index_push(struct index_build *ib, int dirfd, const char *name, uint32_t rec){
+    struct walker *w = &ib->w;
+    uint32_t old = INDEX_NONE;
+    int fd = dirfd == AT_FDCWD ? open_long(AT_FDCWD, w->pb.buf) : openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1){
+        index_error(w->pb.buf, errno);
+        return 0;
+    }
+    if (w->nframes == w->cap_frames){
+        w->cap_frames = w->cap_frames ? w->cap_frames * 2 : DEQUE_INITIAL;
+        w->frames = xrealloc(w->frames, w->cap_frames * sizeof(*w->frames));
+    }
+    size_t top = w->nframes++;
+    struct frame *f = &w->frames[top];
+    f->fd = fd;
+    f->depth = (int)ib->recs[rec].depth;
+    f->pathlen = w->pb.len;
+    f->base = w->pending.len;
+    f->child = ib->recs[rec].first = (uint32_t)ib->count;
+    w->open_fds++;
+    if (w->low_fd > top){
+        w->low_fd = top;
+    }
+    while (w->open_fds > (size_t)ib->plan->fd_budget){
+        while (w->frames[w->low_fd].fd == -1){
+            w->low_fd++;
+        }
+        frame_close(w, w->low_fd, 1);
+    }
+
+    if (ib->old != NULL){
+        old = index_find_dir(ib->old, &ib->cur, w->pb.buf);
+    }
+    uint64_t racy = ib->old != NULL && ib->old->built > DIRCACHE_RACY_SEC * NSEC_PER_SEC ? ib->old->built - DIRCACHE_RACY_SEC * NSEC_PER_SEC : 0;		//0 reads every directory
+    if (old != INDEX_NONE && ib->old->u32[COL_FIRST][old] != INDEX_NONE
+        && ib->old->u64[COL_MTIME - COL_SIZE][old] == ib->recs[rec].mtime
+        && ib->old->u64[COL_DEV - COL_SIZE][old] == ib->recs[rec].dev
+        && ib->recs[rec].mtime < racy && ib->recs[rec].ctime < racy){		//changed well before the old build, its listing is complete
+        index_copy(ib, fd, old, rec);
+    }
+    else {
+        index_read(ib, fd, rec);
+    }
+    f = &w->frames[top];
+    f->next = f->base;
+    f->end = w->pending.len;
+    if (f->next == f->end){
+        frame_close(w, top, 0);
+    }
+    return 1;
+}
+
+/**
+ *
+ * \brief: reads the next subdirectory of the innermost directory of the index being built, or leaves it
+ *
+ * \param ib - the index being built, its walker has at least one frame
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_step(struct index_build *ib){
+    struct walker *w = &ib->w;
+    struct pathbuf *pb = &w->pb;
+    size_t top = w->nframes - 1;
+    struct frame *f = &w->frames[top];
+
+    pb->len = f->pathlen;
+    pb->buf[f->pathlen] = '\0';
+    if (f->next == f->end){
+        w->pending.len = f->base;
+        if (f->fd != -1){
+            frame_close(w, top, 0);
+        }
+        w->nframes--;
+        return;
+    }
+    if (f->fd == -1 && !frame_reopen(w, top)){		//its records stay, the directories below it are left out
+        exit_status = 1;
+        f->next = f->end;
+        return;
+    }
+    size_t off = f->next;		//the names were pushed in the order of the records
+    f->next += strlen(w->pending.buf + off) + 1;
+    while (!index_descend(ib, f->child)){
+        f->child++;
+    }
+    uint32_t rec = f->child++;
+    path_push(pb, w->pending.buf + off);
+    if (index_push(ib, f->fd, w->pending.buf + off, rec)){
+        f = &w->frames[top];		//the stack may have moved
+        if (f->next == f->end && f->fd != -1){
+            frame_close(w, top, 0);
+        }
+    }
+}
+
+/**
+ *
+ * \brief: reports a directory -build-index cannot read, the index is incomplete then
+ *
+ * Directories that are not readable or went away are left out silently, like in the walk.
+ *
+ * \param path - the directory
+ * \param err - errno of the failure
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_error(const char *path, int err){
+    if (err != EACCES && err != ENOENT){
+        error(0, err, "%s", path);
+        exit_status = 1;
+    }
+}
+
+/**
+ *
+ * \brief: adds the items of a changed or new directory, read with getdents64
+ *
+ * \param ib - the index being built
+ * \param fd - descriptor of the directory
+ * \param rec - record of the directory
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_read(struct index_build *ib, int fd, uint32_t rec){
+    for (;;){
+        ssize_t n = getdents64(fd, ib->w.dirbuf, ib->plan->dirbuf_size);
+        if (n == 0){
+            break;
+        }
+        if (n == -1){
+            index_error(ib->w.pb.buf, errno);
+            break;
+        }
+        for (size_t pos = 0; pos < (size_t)n; ){
+            struct dirent64 *d = (struct dirent64 *)(ib->w.dirbuf + pos);
+            const char *name = d->d_name;
+            pos += d->d_reclen;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))){ //ignore if the directory is "." or ".."
+                continue;
+            }
+            index_child(ib, fd, name, d->d_type, rec, NULL);
+        }
+    }
+}
+
+/**
+ *
+ * \brief: adds the items of an unchanged directory from the old index
+ *
+ * Only subdirectories are looked up again, they are needed with their current time.
+ *
+ * \param ib - the index being built, its path buffer holds the path of the directory
+ * \param fd - descriptor of the directory
+ * \param old - record of the directory in the old index
+ * \param rec - record of the directory in the new index
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_copy(struct index_build *ib, int fd, uint32_t old, uint32_t rec){
+    const struct index *ix = ib->old;
+    size_t skip = ib->w.pb.len + (ib->w.pb.buf[ib->w.pb.len - 1] == '/' ? 0 : 1);		//same rule as path_push
+    size_t j = ix->u32[COL_FIRST][old];
+
+    index_seek(&ib->cur, j);
+    for (; j < ix->count && ix->u32[COL_PARENT][j] == old; j++){
+        const char *path = index_next(&ib->cur);
+        struct index_rec r;
+        index_rec_get(ix, j, &r);
+        index_child(ib, fd, path + skip, S_ISDIR(r.mode) ? DT_DIR : DT_UNKNOWN, rec, S_ISDIR(r.mode) ? NULL : &r);
+    }
+}
+
+/**
+ *
+ * \brief: adds one item of a directory to the index
+ *
+ * Directories matching -skip-dir are left out, directories to be read are pushed on the name stack.
+ *
+ * \param ib - the index being built, its path buffer holds the path of the directory
+ * \param fd - descriptor of the directory
+ * \param name - name of the item
+ * \param d_type - DT_* value of the item, DT_UNKNOWN if not known
+ * \param parent - record of the directory
+ * \param old - the record in the old index to take over, NULL to fetch the stat data
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_child(struct index_build *ib, int fd, const char *name, unsigned char d_type, uint32_t parent, const struct index_rec *old){
+    const struct plan *plan = ib->plan;
+    uint32_t depth = ib->recs[parent].depth + 1;
+    size_t len = path_push(&ib->w.pb, name);
+    struct index_rec r;
+
+    if (old != NULL){
+        r = *old;
+        r.parent = parent;
+        r.first = INDEX_NONE;
+    }
+    else {
+        struct find_entry ent = {ib->w.pb.buf, fd, name, d_type, INDEX_MASK | STATX_CTIME, 0, {0}, (int)depth, 0};		//the change time tells racy directories apart
+        if (entry_stat(&ent) == NULL){
+            ib->w.pb.len = len;
+            ib->w.pb.buf[len] = '\0';
+            return;
+        }
+        index_rec_set(&r, &ent.st, parent, depth);
+    }
+    if (!(S_ISDIR(r.mode) && plan->skip != NULL && match_patset(plan->skip, name, strlen(name)))){
+        uint32_t rec = index_add(ib, ib->w.pb.buf, &r);
+        if (index_descend(ib, rec)){
+            namestack_push(&ib->w.pending, name);
+        }
+    }
+    ib->w.pb.len = len;
+    ib->w.pb.buf[len] = '\0';
+}
+
+/**
+ *
+ * \brief: fills a record from stat data
+ *
+ * \param r - the record
+ * \param st - the stat data
+ * \param parent - record of the directory, INDEX_NONE for start points
+ * \param depth - depth of the item
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_rec_set(struct index_rec *r, const struct stat *st, uint32_t parent, uint32_t depth){
+    r->mode = st->st_mode;
+    r->uid = st->st_uid;
+    r->gid = st->st_gid;
+    r->depth = depth;
+    r->parent = parent;
+    r->first = INDEX_NONE;
+    r->size = (uint64_t)st->st_size;
+    r->mtime = (uint64_t)st->st_mtim.tv_sec * 1000000000u + (uint64_t)st->st_mtim.tv_nsec;
+    r->dev = st->st_dev;
+    r->ctime = (uint64_t)st->st_ctim.tv_sec * 1000000000u + (uint64_t)st->st_ctim.tv_nsec;
+}
+
+/**
+ *
+ * \brief: reads a record of a mapped index
+ *
+ * \param ix - the index
+ * \param rec - number of the record
+ * \param r - receives the columns
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_rec_get(const struct index *ix, size_t rec, struct index_rec *r){
+    r->mode = ix->u32[COL_MODE][rec];
+    r->uid = ix->u32[COL_UID][rec];
+    r->gid = ix->u32[COL_GID][rec];
+    r->depth = ix->u32[COL_DEPTH][rec];
+    r->parent = ix->u32[COL_PARENT][rec];
+    r->first = ix->u32[COL_FIRST][rec];
+    r->size = ix->u64[COL_SIZE - COL_SIZE][rec];
+    r->mtime = ix->u64[COL_MTIME - COL_SIZE][rec];
+    r->dev = ix->u64[COL_DEV - COL_SIZE][rec];
+    r->ctime = 0;
+}
+
+/**
+ *
+ * \brief: returns one column of a record
+ *
+ */
+
+static uint64_t index_field(const struct index_rec *r, int col){
+    switch (col){
+        case COL_MODE:
+            return r->mode;
+        case COL_UID:
+            return r->uid;
+        case COL_GID:
+            return r->gid;
+        case COL_DEPTH:
+            return r->depth;
+        case COL_PARENT:
+            return r->parent;
+        case COL_FIRST:
+            return r->first;
+        case COL_SIZE:
+            return r->size;
+        case COL_MTIME:
+            return r->mtime;
+        default:
+            return r->dev;
+    }
+}
+
+/**
+ *
+ * \brief: checks if a directory of the index being built is read, honouring -maxdepth and -xdev
+ *
+ * \return 1 if the record is a directory to read, 0 otherwise
+ *
+ */
+
+static int index_descend(const struct index_build *ib, uint32_t rec){
+    const struct index_rec *r = &ib->recs[rec];
+    return S_ISDIR(r->mode) && r->depth < (uint32_t)ib->plan->maxdepth && (!ib->plan->xdev || r->dev == ib->dev);
+}
+
+/**
+ *
+ * \brief: appends a record, its path is written right away, the columns at the end
+ *
+ * \param ib - the index being built
+ * \param path - whole path of the item
+ * \param r - its stat data
+ *
+ * \return the number of the record
+ *
+ */
+
+static uint32_t index_add(struct index_build *ib, const char *path, const struct index_rec *r){
+    size_t len = strlen(path);
+    size_t shared = 0;
+    if (ib->count == ib->cap){
+        if (ib->count >= INDEX_NONE - 1){
+            error(EXIT_FAILURE, 0, "too many items for one index");
+        }
+        ib->cap = ib->cap ? ib->cap * 2 : PATH_INITIAL;
+        ib->recs = xrealloc(ib->recs, ib->cap * sizeof(*ib->recs));
+        ib->restarts = xrealloc(ib->restarts, (ib->cap / INDEX_RESTART + 1) * sizeof(*ib->restarts));
+    }
+    if (ib->count % INDEX_RESTART == 0){
+        ib->restarts[ib->count / INDEX_RESTART] = ib->paths_len;
+    }
+    else {
+        while (shared < len && shared < ib->prev.len && path[shared] == ib->prev.buf[shared]){
+            shared++;
+        }
+    }
+    ib->paths_len += index_put_varint(ib->fp, shared);
+    ib->paths_len += index_put_varint(ib->fp, len - shared);
+    fwrite(path + shared, 1, len - shared, ib->fp);
+    ib->paths_len += len - shared;
+    path_set(&ib->prev, path);
+    ib->recs[ib->count] = *r;
+    return (uint32_t)ib->count++;
+}
+
+/**
+ *
+ * \brief: writes a number as LEB128
+ *
+ * \return the number of bytes written
+ *
+ */
+
+static size_t index_put_varint(FILE *fp, uint64_t v){
+    size_t n = 1;
+    while (v >= 0x80){
+        putc_unlocked((int)((v & 0x7f) | 0x80), fp);
+        v >>= 7;
+        n++;
+    }
+    putc_unlocked((int)v, fp);
+    return n;
+}
+
+/**
+ *
+ * \brief: writes the restart points, the columns and the header and moves the file into place
+ *
+ * \param ib - the index being built
+ * \param file - the name of the index
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_write(struct index_build *ib, const char *file){
+    static const char zeros[8];
+    struct index_header header;
+    size_t nrestarts = (ib->count + INDEX_RESTART - 1) / INDEX_RESTART;
+    uint64_t off = sizeof(header) + ib->paths_len;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.restart = INDEX_RESTART;
+    header.count = ib->count;
+    header.paths_off = sizeof(header);
+    header.paths_len = ib->paths_len;
+    header.built = ib->built;
+    fwrite(zeros, 1, (size_t)(-off & 7), ib->fp);		//every section starts 8 byte aligned
+    off += -off & 7;
+    header.restarts_off = off;
+    fwrite(ib->restarts, sizeof(*ib->restarts), nrestarts, ib->fp);
+    off += nrestarts * sizeof(*ib->restarts);
+    for (int col = 0; col < INDEX_NCOLS; col++){
+        header.col_off[col] = off;
+        for (size_t i = 0; i < ib->count; i++){
+            uint64_t value = index_field(&ib->recs[i], col);
+            if (col < COL_SIZE){
+                uint32_t narrow = (uint32_t)value;
+                fwrite(&narrow, sizeof(narrow), 1, ib->fp);
+            }
+            else {
+                fwrite(&value, sizeof(value), 1, ib->fp);
+            }
+        }
+        off += ib->count * (col < COL_SIZE ? sizeof(uint32_t) : sizeof(uint64_t));
+        fwrite(zeros, 1, (size_t)(-off & 7), ib->fp);
+        off += -off & 7;
+    }
+    if (fseek(ib->fp, 0, SEEK_SET) == -1 || fwrite(&header, sizeof(header), 1, ib->fp) != 1
+        || ferror(ib->fp) || fclose(ib->fp) == EOF){
+        unlink(ib->tmpname);
+        error(EXIT_FAILURE, errno, "%s", ib->tmpname);
+    }
+    if (rename(ib->tmpname, file) == -1){
+        unlink(ib->tmpname);
+        error(EXIT_FAILURE, errno, "%s", file);
+    }
+}
+
+/**
+ *
+ * \brief: maps an index file and checks its header
+ *
+ * \param file - the name of the index
+ * \param quiet - 1 to return NULL instead of terminating if the file is missing, not an index or corrupt
+ *
+ * \return the mapped index
+ *
+ */
+
+static struct index *index_open(const char *file, int quiet){
+    struct index_header header;
+    struct index *ix;
+    struct stat st;
+    void *map;
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1 || fstat(fd, &st) == -1){
+        if (quiet){
+            if (fd != -1){
+                close(fd);
+            }
+            return NULL;
+        }
+        error(EXIT_FAILURE, errno, "%s", file);
+    }
+    size_t len = (size_t)st.st_size;
+    map = len >= sizeof(header) ? mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    int valid = map != MAP_FAILED;
+    if (valid){
+        memcpy(&header, map, sizeof(header));
+        size_t nrestarts = header.restart > 0 ? (header.count + header.restart - 1) / header.restart : 0;
+        valid = memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0 && header.version == INDEX_VERSION
+            && header.restart > 0 && header.count < INDEX_NONE
+            && header.paths_off <= len && header.paths_len <= len - header.paths_off
+            && header.restarts_off % 8 == 0 && header.restarts_off <= len && nrestarts <= (len - header.restarts_off) / 8;
+        for (int col = 0; valid && col < INDEX_NCOLS; col++){
+            size_t width = col < COL_SIZE ? sizeof(uint32_t) : sizeof(uint64_t);
+            valid = header.col_off[col] % 8 == 0 && header.col_off[col] <= len && header.count <= (len - header.col_off[col]) / width;
+        }
+    }
+    if (!valid){
+        if (map != MAP_FAILED){
+            munmap(map, len);
+        }
+        if (quiet){
+            return NULL;
+        }
+        error(EXIT_FAILURE, 0, "%s: not an index of this program", file);
+    }
+    ix = xmalloc(sizeof(*ix));
+    memset(ix, 0, sizeof(*ix));
+    ix->map = map;
+    ix->len = len;
+    ix->count = header.count;
+    ix->restart = header.restart;
+    ix->paths = (const unsigned char *)map + header.paths_off;
+    ix->paths_len = header.paths_len;
+    ix->restarts = (const uint64_t *)((const char *)map + header.restarts_off);
+    ix->built = header.built;
+    for (int col = 0; col < COL_SIZE; col++){
+        ix->u32[col] = (const uint32_t *)((const char *)map + header.col_off[col]);
+    }
+    for (int col = COL_SIZE; col < INDEX_NCOLS; col++){
+        ix->u64[col - COL_SIZE] = (const uint64_t *)((const char *)map + header.col_off[col]);
+    }
+    if (!index_check(ix)){
+        index_close(ix);
+        if (quiet){
+            return NULL;
+        }
+        error(EXIT_FAILURE, 0, "the index is corrupt");
+    }
+    return ix;
+}
+
+/**
+ *
+ * \brief: checks the records link up as -build-index writes them
+ *
+ * Every record comes after its directory, one level deeper, and the records of a directory
+ * start behind it. walk_index, index_copy and index_find_dir index the columns with these values.
+ *
+ * \param ix - the mapped index
+ *
+ * \return 1 if they do, 0 if the index is corrupt
+ *
+ */
+
+static int index_check(const struct index *ix){
+    const uint32_t *parent = ix->u32[COL_PARENT];
+    const uint32_t *depth = ix->u32[COL_DEPTH];
+    const uint32_t *first = ix->u32[COL_FIRST];
+    for (size_t i = 0; i < ix->count; i++){
+        int valid = parent[i] == INDEX_NONE ? depth[i] == 0
+            : parent[i] < i && S_ISDIR(ix->u32[COL_MODE][parent[i]]) && depth[i] == depth[parent[i]] + 1;
+        if (!valid || (first[i] != INDEX_NONE && (first[i] <= i || first[i] > ix->count))){		//an empty directory last in the index starts at count
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ *
+ * \brief: unmaps an index
+ *
+ */
+
+static void index_close(struct index *ix){
+    munmap(ix->map, ix->len);
+    free(ix->dirs);
+    free(ix);
+}
+
+/**
+ *
+ * \brief: positions a cursor so that index_next decodes the given record
+ *
+ * \param c - the cursor
+ * \param rec - the record
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void index_seek(struct index_cursor *c, size_t rec){
+    size_t block = rec / c->ix->restart;
+    c->rec = block * c->ix->restart;
+    c->off = c->rec < c->ix->count ? c->ix->restarts[block] : c->ix->paths_len;
+    c->path.len = 0;
+    while (c->rec < rec){
+        index_next(c);
+    }
+}
+
+/**
+ *
+ * \brief: decodes the path of the next record
+ *
+ * \param c - the cursor
+ *
+ * \return the path, valid until the cursor moves again
+ *
+ */
+
+static const char *index_next(struct index_cursor *c){
+    const struct index *ix = c->ix;
+    uint64_t len[2];
+    for (int k = 0; k < 2; k++){		//shared prefix and length of the rest
+        int shift = 0;
+        len[k] = 0;
+        do {
+            if (c->off >= ix->paths_len || shift > 63){
+                error(EXIT_FAILURE, 0, "the index is corrupt");
+            }
+            len[k] |= (uint64_t)(ix->paths[c->off] & 0x7f) << shift;
+            shift += 7;
+        } while (ix->paths[c->off++] & 0x80);
+    }
+    if (len[0] > c->path.len || len[1] > ix->paths_len - c->off){
+        error(EXIT_FAILURE, 0, "the index is corrupt");
+    }
+    if (len[0] + len[1] + 1 > c->path.cap){
+        c->path.cap = len[0] + len[1] + 1 > PATH_INITIAL ? len[0] + len[1] + 1 : PATH_INITIAL;
+        c->path.buf = xrealloc(c->path.buf, c->path.cap);
+    }
+    memcpy(c->path.buf + len[0], ix->paths + c->off, len[1]);
+    c->off += len[1];
+    c->path.len = len[0] + len[1];
+    c->path.buf[c->path.len] = '\0';
+    c->rec++;
+    return c->path.buf;
+}
+
+/**
+ *
+ * \brief: looks a directory up in the old index by its path
+ *
+ * The table from path to record is built on the first call.
+ *
+ * \param ix - the old index
+ * \param c - a cursor on it
+ * \param path - whole path of the directory
+ *
+ * \return the record or INDEX_NONE
+ *
+ */
+
+static uint32_t index_find_dir(struct index *ix, struct index_cursor *c, const char *path){
+    size_t i;
+    if (ix->dirs == NULL){
+        size_t ndirs = 0;
+        for (i = 0; i < ix->count; i++){
+            ndirs += S_ISDIR(ix->u32[COL_MODE][i]);
+        }
+        for (ix->dirs_cap = STRSET_INITIAL; ix->dirs_cap < 2 * ndirs; ix->dirs_cap *= 2){
+        }
+        ix->dirs = xmalloc(ix->dirs_cap * sizeof(*ix->dirs));
+        for (i = 0; i < ix->dirs_cap; i++){
+            ix->dirs[i].rec = INDEX_NONE;
+        }
+        index_seek(c, 0);
+        for (size_t rec = 0; rec < ix->count; rec++){
+            const char *p = index_next(c);
+            if (S_ISDIR(ix->u32[COL_MODE][rec])){
+                uint64_t hash = strset_hash(p, c->path.len);
+                for (i = hash & (ix->dirs_cap - 1); ix->dirs[i].rec != INDEX_NONE; i = (i + 1) & (ix->dirs_cap - 1)){
+                }
+                ix->dirs[i].hash = hash;
+                ix->dirs[i].rec = (uint32_t)rec;
+            }
+        }
+    }
+    uint64_t hash = strset_hash(path, strlen(path));
+    for (i = hash & (ix->dirs_cap - 1); ix->dirs[i].rec != INDEX_NONE; i = (i + 1) & (ix->dirs_cap - 1)){
+        if (ix->dirs[i].hash == hash){
+            index_seek(c, ix->dirs[i].rec);
+            if (strcmp(index_next(c), path) == 0){
+                return ix->dirs[i].rec;
+            }
+        }
+    }
+    return INDEX_NONE;
+}
+
+/**
+ *
+ * \brief: evaluates the expression over the records of an index instead of the file system (-db)
+ *
+ * The stat data comes from the columns. Only if the expression needs fields the index does not
+ * hold, like -ls does, the items are looked up on disk. Start points select the part of the
+ * index below them, matched by their absolute path, see index_path. A directory that is pruned
+ * or not read for another reason hides the records below it.
+ *
+ * \param plan - the compiled command line
+ * \param w - the walker
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void walk_index(const struct plan *plan, struct walker *w){
+    struct index *ix = index_open(plan->db, 0);
+    struct index_cursor c = {ix, 0, 0, {NULL, 0, 0}};
+    unsigned char *cut = xmalloc(ix->count ? ix->count : 1);		//1 for records below a directory that was not read
+    char **roots = xmalloc((plan->npaths + 1) * sizeof(*roots));		//the start points as the index has them
+    size_t *splen = xmalloc((plan->npaths + 1) * sizeof(*splen));
+    long *top = xmalloc((plan->npaths + 1) * sizeof(*top));		//depth of each start point in the index
+    int have_stat = (plan->stat_mask & ~INDEX_MASK) == 0;
+
+    memset(cut, 0, ix->count);
+    for (size_t k = 0; k < plan->npaths; k++){
+        roots[k] = index_path(plan->paths[k]);
+        splen[k] = strlen(roots[k]);
+        top[k] = -1;
+    }
+    index_seek(&c, 0);
+    for (size_t i = 0; i < ix->count && !walk_stopped(plan); i++){
+        const char *path = index_next(&c);
+        uint32_t parent = ix->u32[COL_PARENT][i];
+        long depth = ix->u32[COL_DEPTH][i];
+        if (parent != INDEX_NONE && cut[parent]){
+            cut[i] = 1;
+            continue;
+        }
+        const char *root = NULL;		//a whole index has no start point
+        if (plan->npaths > 0){
+            size_t k;
+            for (k = 0; k < plan->npaths; k++){
+                size_t n = splen[k];
+                if (c.path.len < n || memcmp(path, roots[k], n) != 0){
+                    continue;
+                }
+                if (c.path.len == n){
+                    top[k] = depth;		//the start point itself
+                    break;
+                }
+                if ((path[n] == '/' || path[n - 1] == '/') && top[k] != -1){
+                    break;		//below it, "/" is the only start point ending in a slash
+                }
+            }
+            if (k == plan->npaths){
+                continue;
+            }
+            depth -= top[k];
+            root = plan->paths[k];
+            if (strcmp(roots[k], root) != 0){		//shown as it was given, like the walk would
+                const char *rest = path + splen[k];
+                path_set(&w->pb, root);
+                if (*rest == '/'){
+                    rest++;
+                }
+                if (*rest != '\0'){
+                    path_push(&w->pb, rest);
+                }
+                path = w->pb.buf;
+            }
+        }
+        if (depth == 0){
+            w->dev = (dev_t)ix->u64[COL_DEV - COL_SIZE][i];
+            w->root = root;
+        }
+        struct find_entry ent = {path, AT_FDCWD, path, DT_UNKNOWN, plan->stat_mask, 0, {0}, (int)depth, 0};
+        if (have_stat){
+            memset(&ent.st, 0, sizeof(ent.st));
+            ent.st.st_mode = ix->u32[COL_MODE][i];
+            ent.st.st_uid = ix->u32[COL_UID][i];
+            ent.st.st_gid = ix->u32[COL_GID][i];
+            ent.st.st_size = (off_t)ix->u64[COL_SIZE - COL_SIZE][i];
+            ent.st.st_mtim.tv_sec = (time_t)(ix->u64[COL_MTIME - COL_SIZE][i] / 1000000000u);
+            ent.st.st_mtim.tv_nsec = (long)(ix->u64[COL_MTIME - COL_SIZE][i] % 1000000000u);
+            ent.st.st_dev = (dev_t)ix->u64[COL_DEV - COL_SIZE][i];
+            ent.have_stat = 1;
+        }
+        if (!do_visit(&ent, w) && S_ISDIR(ix->u32[COL_MODE][i])){
+            cut[i] = 1;
+        }
+    }
+    for (size_t k = 0; k < plan->npaths; k++){
+        size_t j = 0;
+        while (j < k && strcmp(roots[j], roots[k]) != 0){		//the same directory given twice is shown once
+            j++;
+        }
+        if (top[j] == -1 && !walk_stopped(plan)){
+            error(0, 0, "%s: not in index", plan->paths[k]);
+            exit_status = 1;
+        }
+    }
+    for (size_t k = 0; k < plan->npaths; k++){
+        free(roots[k]);
+    }
+    free(c.path.buf);
+    free(cut);
+    free(roots);
+    free(splen);
+    free(top);
+    index_close(ix);
+}
+
+/**
+ *
+ * \brief: the form of a start point in an index, the same for -build-index and -db
+ *
+ * The directory of the start point is resolved with realpath, its last component is kept as
+ * it is, so a symbolic link given as start point stays a link like in the walk. ".", "..",
+ * "./x", "x/" and "x//" of the same directory all give the same path. Start points that do
+ * not exist are made absolute without resolving anything.
+ *
+ * \param path - the start point as given
+ *
+ * \return the absolute path without "." and ".." components or trailing slashes, to be freed
+ *
+ */
+
+static char *index_path(const char *path){
+    struct pathbuf pb = {NULL, 0, 0};
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/'){
+        len--;
+    }
+    size_t cut = len;
+    while (cut > 0 && path[cut - 1] != '/'){
+        cut--;
+    }
+    char *last = strndup(path + cut, len - cut);
+    char *dir = strndup(path, cut > 0 ? cut : 0);
+    if (last == NULL || dir == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    if (strcmp(last, ".") == 0 || strcmp(last, "..") == 0){		//resolved with the directory
+        char *both = xmalloc(cut + 3);
+        sprintf(both, "%s%s", dir, last);
+        free(dir);
+        dir = both;
+        last[0] = '\0';
+    }
+    char *real = realpath(dir[0] != '\0' ? dir : ".", NULL);
+    if (real != NULL){
+        path_set(&pb, real);
+        free(real);
+    }
+    else {		//does not exist, only the spelling is cleaned up
+        char *cwd = dir[0] == '/' ? NULL : getcwd(NULL, 0);
+        path_set(&pb, "/");
+        for (int part = 0; part < 2; part++){
+            char *spec = part == 0 ? cwd : dir;
+            char *save = NULL;
+            for (char *comp = spec != NULL ? strtok_r(spec, "/", &save) : NULL; comp != NULL; comp = strtok_r(NULL, "/", &save)){
+                if (strcmp(comp, ".") == 0){
+                    continue;
+                }
+                if (strcmp(comp, "..") == 0){
+                    while (pb.len > 1 && pb.buf[pb.len - 1] != '/'){
+                        pb.len--;
+                    }
+                    if (pb.len > 1){
+                        pb.len--;
+                    }
+                    pb.buf[pb.len] = '\0';
+                    continue;
+                }
+                path_push(&pb, comp);
+            }
+        }
+        free(cwd);
+    }
+    if (last[0] != '\0'){
+        path_push(&pb, last);
+    }
+    free(dir);
+    free(last);
+    return pb.buf;
+}
+
+/**
+ *
+ * \brief: pushes a name on a name stack
+ *
+ * \param ns - the stack
+ * \param name - the name, it is copied
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void namestack_push(struct namestack *ns, const char *name){
+    size_t namelen = strlen(name) + 1;
+    if (ns->len + namelen > ns->cap){
+        ns->cap = ns->cap ? ns->cap * 2 : PATH_INITIAL;
+        while (ns->len + namelen > ns->cap){
+            ns->cap *= 2;
+        }
+        ns->buf = xrealloc(ns->buf, ns->cap);
+    }
+    memcpy(ns->buf + ns->len, name, namelen);
+    ns->len += namelen;
+}
+
+/**
+ *
+ * \brief: sets up -watch, watches are added while the directories are read
+ *
+ * \return the watch state
+ *
+ */
+
+static struct watch *watch_open(void){
+    struct watch *wt = xmalloc(sizeof(*wt));
+    memset(wt, 0, sizeof(*wt));
+    if ((wt->fd = inotify_init1(IN_CLOEXEC)) == -1){
+        int err = errno;
+        free(wt);
+        compile_error(err, "inotify_init1");
+    }
+    pthread_mutex_init(&wt->lock, NULL);
+    clock_gettime(CLOCK_REALTIME, &wt->since);		//the first rescan catches what changed during the first walk
+    return wt;
+}
+
+/**
+ *
+ * \brief: watches a directory that is being read
+ *
+ * The watch goes through the descriptor, so paths longer than PATH_MAX work as well.
+ * Once the kernel runs out of watches the directory is rescanned periodically instead.
+ *
+ * \param wt - the watch state
+ * \param fd - descriptor of the open directory
+ * \param path - its whole path
+ * \param depth - its depth
+ * \param dev - device of its start point
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void watch_add(struct watch *wt, int fd, const char *path, int depth, dev_t dev){
+    char proc[32];
+    snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+    int wd = inotify_add_watch(wt->fd, proc, WATCH_MASK);
+    if (wd == -1 && errno == ENOENT){		//no /proc
+        wd = inotify_add_watch(wt->fd, path, WATCH_MASK | IN_DONT_FOLLOW);
+    }
+    pthread_mutex_lock(&wt->lock);
+    if (wd == -1){
+        if (errno == ENOSPC || errno == ENOMEM){
+            watch_rescan_add(wt, path, depth, dev);
+        }
+        else {
+            error(0, errno, "inotify_add_watch: %s", path);
+        }
+        pthread_mutex_unlock(&wt->lock);
+        return;
+    }
+    if ((size_t)wd >= wt->cap){
+        size_t cap = wt->cap ? wt->cap : STRSET_INITIAL;
+        while ((size_t)wd >= cap){
+            cap *= 2;
+        }
+        wt->dirs = xrealloc(wt->dirs, cap * sizeof(*wt->dirs));
+        memset(wt->dirs + wt->cap, 0, (cap - wt->cap) * sizeof(*wt->dirs));
+        wt->cap = cap;
+    }
+    free(wt->dirs[wd].path);		//a directory read twice keeps its descriptor
+    if ((wt->dirs[wd].path = strdup(path)) == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    wt->dirs[wd].depth = depth;
+    wt->dirs[wd].dev = dev;
+    pthread_mutex_unlock(&wt->lock);
+}
+
+/**
+ *
+ * \brief: remembers a subtree for the periodic rescan, unless it is part of one already
+ *
+ * The caller holds the lock.
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void watch_rescan_add(struct watch *wt, const char *path, int depth, dev_t dev){
+    size_t len = strlen(path);
+    for (size_t i = 0; i < wt->nrescan; i++){
+        size_t rlen = strlen(wt->rescan[i].path);
+        if (rlen <= len && memcmp(wt->rescan[i].path, path, rlen) == 0 && (path[rlen] == '\0' || path[rlen] == '/' || path[rlen - 1] == '/')){
+            return;
+        }
+    }
+    if (wt->nrescan == 0){
+        error(0, 0, "out of inotify watches, %s and others are rescanned every %d seconds", path, WATCH_RESCAN_SEC);
+    }
+    wt->rescan = xrealloc(wt->rescan, (wt->nrescan + 1) * sizeof(*wt->rescan));
+    if ((wt->rescan[wt->nrescan].path = strdup(path)) == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    wt->rescan[wt->nrescan].depth = depth;
+    wt->rescan[wt->nrescan].dev = dev;
+    wt->nrescan++;
+}
+
+/**
+ *
+ * \brief: drops the watches of a directory that was moved away and of everything below it
+ *
+ * If it was moved inside the watched tree, the event for its new name reads it again.
+ *
+ * \param wt - the watch state
+ * \param path - its old path
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void watch_forget(struct watch *wt, const char *path){
+    size_t len = strlen(path);
+    for (size_t wd = 0; wd < wt->cap; wd++){
+        const char *p = wt->dirs[wd].path;
+        if (p != NULL && strncmp(p, path, len) == 0 && (p[len] == '\0' || p[len] == '/' || path[len - 1] == '/')){
+            inotify_rm_watch(wt->fd, (int)wd);
+            free(wt->dirs[wd].path);
+            wt->dirs[wd].path = NULL;
+        }
+    }
+}
+
+/**
+ *
+ * \brief: reports changes until the program is killed, or the library walk is ended (-watch)
+ *
+ * Created, moved in and written items are checked against the expression as their events
+ * arrive, new directories are read and watched as well. A new regular file is checked when
+ * it is closed after writing, not when it is created, so it is not reported twice. Subtrees without watches are
+ * rescanned every WATCH_RESCAN_SEC seconds and report the items whose status changed since
+ * the previous rescan. The output is written after every round of events. With a sink the
+ * loop wakes up every WATCH_STOP_MS milliseconds to see whether the caller ended the walk.
+ *
+ * \param plan - the compiled command line, the first walk is done
+ *
+ * \return: only if the walk of find_walk or of an iterator was ended
+ *
+ */
+
+static void watch_run(const struct plan *plan){
+    struct watch *wt = plan->watch;
+    struct walker w;
+    char buf[WATCH_BUF] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct timespec next;
+
+    walker_init(&w, plan, NULL, 0);
+    exit_walkers = &w;
+    exit_nwalkers = 1;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    next.tv_sec += WATCH_RESCAN_SEC;
+    while (!walk_stopped(plan)){
+        struct pollfd pfd = {wt->fd, POLLIN, 0};
+        struct timespec now;
+        int timeout = -1;
+
+        for (size_t i = 0; i < plan->nexecs; i++){		//the changes seen so far are handed over before waiting
+            exec_flush(&w, i);
+        }
+        for (size_t i = 0; i < plan->noutputs; i++){
+            out_flush(&w, i);
+        }
+        iter_flush(&w);
+        if (wt->nrescan > 0){
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long ms = (next.tv_sec - now.tv_sec) * 1000 + (next.tv_nsec - now.tv_nsec) / 1000000;
+            timeout = ms > 0 ? (int)ms : 0;
+        }
+        if (plan->sink != NULL && (timeout == -1 || timeout > WATCH_STOP_MS)){
+            timeout = WATCH_STOP_MS;
+        }
+        if (poll(&pfd, 1, timeout) == -1 && errno != EINTR){
+            error(EXIT_FAILURE, errno, "poll");
+        }
+        if (pfd.revents & POLLIN){
+            ssize_t n = read(wt->fd, buf, sizeof(buf));
+            if (n == -1 && errno != EINTR && errno != EAGAIN){
+                error(EXIT_FAILURE, errno, "inotify");
+            }
+            for (ssize_t pos = 0; pos < n; ){
+                const struct inotify_event *ev = (const struct inotify_event *)(buf + pos);
+                pos += (ssize_t)(sizeof(*ev) + ev->len);
+                watch_event(wt, ev, &w);
+            }
+        }
+        if (wt->nrescan > 0){
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec >= next.tv_nsec)){
+                struct timespec since = wt->since;
+                clock_gettime(CLOCK_REALTIME, &wt->since);
+                for (size_t i = 0; i < wt->nrescan; i++){
+                    watch_rescan(&w, &wt->rescan[i], since);
+                }
+                next = now;
+                next.tv_sec += WATCH_RESCAN_SEC;
+            }
+        }
+    }
+    walker_free(&w);
+    exit_nwalkers = 0;
+}
+
+/**
+ *
+ * \brief: handles one inotify event
+ *
+ * \param wt - the watch state
+ * \param ev - the event
+ * \param w - the walker of the watch loop
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void watch_event(struct watch *wt, const struct inotify_event *ev, struct walker *w){
+    const struct plan *plan = w->plan;
+    struct watch_dir *dir;
+
+    if (ev->mask & IN_Q_OVERFLOW){		//events were lost, look at everything that changed since the last rescan
+        struct timespec since = wt->since;
+        error(0, 0, "inotify queue overflow, rescanning");
+        clock_gettime(CLOCK_REALTIME, &wt->since);
+        for (size_t i = 0; i < plan->npaths; i++){
+            struct watch_dir root = {plan->paths[i], 0, 0};
+            struct stat st;
+            if (lstat(plan->paths[i], &st) == 0 && S_ISDIR(st.st_mode)){
+                root.dev = st.st_dev;
+                watch_rescan(w, &root, since);
+            }
+        }
+        return;
+    }
+    if (ev->wd < 0 || (size_t)ev->wd >= wt->cap || (dir = &wt->dirs[ev->wd])->path == NULL){
+        return;
+    }
+    if (ev->mask & IN_IGNORED){		//the directory is gone
+        free(dir->path);
+        dir->path = NULL;
+        return;
+    }
+    if (ev->len == 0){
+        return;
+    }
+    path_set(&w->pb, dir->path);
+    path_push(&w->pb, ev->name);
+    if ((ev->mask & IN_MOVED_FROM)){
+        if (ev->mask & IN_ISDIR){
+            watch_forget(wt, w->pb.buf);
+        }
+        return;
+    }
+
+    struct find_entry ent = {w->pb.buf, AT_FDCWD, w->pb.buf, DT_UNKNOWN, plan->stat_mask, 0, {0}, dir->depth + 1, 0};
+    if (fstatat(AT_FDCWD, w->pb.buf, &ent.st, AT_SYMLINK_NOFOLLOW) == -1){		//already gone again, nothing to report
+        return;
+    }
+    ent.have_stat = 1;
+    if ((ev->mask & IN_CREATE) && S_ISREG(ent.st.st_mode) && ent.st.st_nlink == 1){		//reported once its writer closes it
+        return;
+    }
+    w->dev = dir->dev;
+    if (do_visit(&ent, w) && (ev->mask & (IN_CREATE | IN_MOVED_TO))){
+        do_dir(&ent, w);		//a new directory: check its items and watch it
+    }
+}
+
+/**
+ *
+ * \brief: walks a subtree without watches and checks the items changed since the previous rescan
+ *
+ * \param w - the walker of the watch loop
+ * \param root - the subtree
+ * \param since - items whose status changed before are left out
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void watch_rescan(struct walker *w, const struct watch_dir *root, struct timespec since){
+    path_set(&w->pb, root->path);
+    struct find_entry ent = {w->pb.buf, AT_FDCWD, w->pb.buf, DT_DIR, w->plan->stat_mask, 0, {0}, root->depth, 0};
+    w->dev = root->dev;
+    w->since = since;
+    do_dir(&ent, w);
+    w->since.tv_sec = 0;
+    w->since.tv_nsec = 0;
+}
+
+/**
+ *
+ * \brief: serves queries on a Unix socket until SIGINT or SIGTERM (-daemon)
+ *
+ * Clients send their arguments together with their stdout, stderr and working directory.
+ * One query runs at a time, with the descriptors of its client in place of the own ones, so
+ * the results, the error messages and the output of -exec go where they would go without
+ * the daemon. Three caches carry over from query to query: the user and group names, the
+ * listings of unchanged directories and the compiled queries. Only the user running the
+ * daemon is served, a query can run commands.
+ *
+ * \param plan - the plan of the daemon itself, only -daemon-cache is used
+ *
+ * \return 0 once it was stopped, 1 if the socket could not be set up
+ *
+ */
+
+static int daemon_run(const struct plan *plan){
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    struct stat st;
+    struct dircache dc;
+    struct daemon_query cache[DAEMON_QUERIES];
+    uint64_t clock = 0;
+    int keep[3];		//the own stdout, stderr and working directory, put back after each query
+    int wake[2];
+    int fd;
+
+    if (strlen(plan->daemon) >= sizeof(addr.sun_path)){
+        error(0, 0, "%s: the path of the socket is too long", plan->daemon);
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, plan->daemon);
+    if (lstat(plan->daemon, &st) == 0 && S_ISSOCK(st.st_mode)){
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd != -1 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0){
+            error(0, 0, "%s: a daemon is serving it already", plan->daemon);
+            close(fd);
+            return 1;
+        }
+        if (fd != -1){
+            close(fd);
+        }
+        unlink(plan->daemon);		//left behind by a daemon that was killed
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mode_t mask = umask(077);
+    if (fd == -1 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1){
+        umask(mask);
+        error(0, errno, "%s", plan->daemon);
+        if (fd != -1){
+            close(fd);
+        }
+        return 1;
+    }
+    umask(mask);
+    daemon_socket = plan->daemon;
+    if (pipe2(wake, O_CLOEXEC | O_NONBLOCK) == -1){
+        error(0, errno, "pipe");
+        close(fd);
+        daemon_socket = NULL;
+        unlink(plan->daemon);
+        return 1;
+    }
+    daemon_wake = wake[1];
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemon_signal;		//a handler, unlike SIG_IGN, is not inherited by the commands of -exec
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGPIPE, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    keep[0] = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    keep[1] = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+    keep[2] = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    daemon_dir = keep[2] != -1 ? keep[2] : AT_FDCWD;
+    memset(&dc, 0, sizeof(dc));
+    dc.budget = plan->daemon_cache;
+    pthread_mutex_init(&dc.lock, NULL);
+    dir_cache = &dc;
+    memset(cache, 0, sizeof(cache));
+
+    while (!daemon_stop){
+        struct pollfd pfd[2] = {{fd, POLLIN, 0}, {wake[0], POLLIN, 0}};		//a signal before poll is not missed
+        if (poll(pfd, 2, -1) == -1 || !(pfd[0].revents & POLLIN)){
+            continue;
+        }
+        int c = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (c == -1){
+            continue;
+        }
+        daemon_serve(c, cache, &clock, keep);
+        close(c);
+    }
+
+    for (size_t i = 0; i < DAEMON_QUERIES; i++){
+        daemon_query_free(&cache[i]);
+    }
+    dir_cache = NULL;
+    dircache_free(&dc);
+    pthread_mutex_destroy(&dc.lock);
+    daemon_dir = AT_FDCWD;
+    for (int i = 0; i < 3; i++){
+        if (keep[i] != -1){
+            close(keep[i]);
+        }
+    }
+    daemon_wake = -1;
+    close(wake[0]);
+    close(wake[1]);
+    close(fd);
+    daemon_socket = NULL;
+    unlink(plan->daemon);
+    return 0;
+}
+
+/**
+ *
+ * \brief: receives one query of a client, runs it and sends back its exit status
+ *
+ * \param c - the connection
+ * \param cache - the compiled queries
+ * \param clock - counts the queries, for the order of use of the cache
+ * \param keep - the own stdout, stderr and working directory of the daemon
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void daemon_serve(int c, struct daemon_query *cache, uint64_t *clock, const int *keep){
+    static time_t ids_time = 0;
+    struct daemon_request req;
+    struct ucred cred;
+    socklen_t credlen = sizeof(cred);
+    struct timeval tv = {DAEMON_TIMEOUT_SEC, 0};
+    char ctl[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = {&req, sizeof(req)};
+    struct msghdr msg;
+    struct daemon_query q;
+    int fds[3] = {-1, -1, -1};
+    int32_t status = 1;
+
+    if (getsockopt(c, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) == -1 || cred.uid != geteuid()){
+        return;
+    }
+    setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl;
+    msg.msg_controllen = sizeof(ctl);
+    ssize_t n = recvmsg(c, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    for (struct cmsghdr *cm = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL; cm != NULL; cm = CMSG_NXTHDR(&msg, cm)){
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS && cm->cmsg_len == CMSG_LEN(sizeof(fds))){
+            memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+        }
+    }
+    memset(&q, 0, sizeof(q));
+    if (n != sizeof(req) || req.magic != DAEMON_MAGIC || req.len > DAEMON_REQUEST_MAX || fds[2] == -1){
+        goto done;
+    }
+    q.len = req.len;
+    q.args = xmalloc(q.len + 1);
+    if (recv(c, q.args, q.len, MSG_WAITALL) != (ssize_t)q.len || (q.len > 0 && q.args[q.len - 1] != '\0')){
+        goto done;
+    }
+
+    time_t now = time(NULL);
+    if (now - ids_time >= DAEMON_TTL_SEC){		//names that changed in the meantime are looked up again
+        pthread_mutex_lock(&nss_lock);
+        idcache_clear(&user_cache);
+        idcache_clear(&group_cache);
+        pthread_mutex_unlock(&nss_lock);
+        ids_time = now;
+    }
+    fflush(stdout);
+    if (dup2(fds[0], STDOUT_FILENO) == -1 || dup2(fds[1], STDERR_FILENO) == -1 || fchdir(fds[2]) == -1){
+        goto restore;
+    }
+    struct daemon_query *run = daemon_compile(cache, &q, clock);
+    if (run != NULL){
+        pthread_t watcher;
+        atomic_store(&client_gone, 0);
+        serving = 1;
+        int rc = pthread_create(&watcher, NULL, daemon_watch_client, &c);
+        run->query->plan.outputs[0].is_tty = isatty(STDOUT_FILENO);		//the plan may have been compiled for another client
+        status = find_run(run->query);
+        fflush(stdout);
+        serving = 0;
+        if (rc == 0){
+            pthread_cancel(watcher);
+            pthread_join(watcher, NULL);
+        }
+        if (atomic_load(&client_gone)){
+            status = 1;
+        }
+        atomic_store(&client_gone, 0);
+    }
+restore:
+    dup2(keep[0], STDOUT_FILENO);
+    dup2(keep[1], STDERR_FILENO);
+    if (fchdir(keep[2]) == -1){
+        error(0, errno, "fchdir");
+    }
+    send(c, &status, sizeof(status), MSG_NOSIGNAL);
+done:
+    daemon_query_free(&q);
+    for (int i = 0; i < 3; i++){
+        if (fds[i] != -1){
+            close(fds[i]);
+        }
+    }
+}
+
+/**
+ *
+ * \brief: returns the compiled query for the arguments of a client, from the cache if it has them
+ *
+ * Queries are compiled again DAEMON_TTL_SEC after they were compiled. Plans that depend on
+ * the time or on files read while compiling are not kept, see plan->reusable. -watch and
+ * -daemon would never return, -db and -build-index end the program on a bad index file
+ * and would take the daemon with them, so they are refused.
+ *
+ * \param cache - the compiled queries
+ * \param q - the arguments received, compiled if they are not kept
+ * \param clock - counts the queries
+ *
+ * \return the entry of the cache, which then owns the arguments, or q itself, NULL if the arguments are invalid
+ *
+ */
+
+static struct daemon_query *daemon_compile(struct daemon_query *cache, struct daemon_query *q, uint64_t *clock){
+    time_t now = time(NULL);
+    struct daemon_query *slot = &cache[0];
+    char err[512];
+    size_t argc = 1;
+    for (size_t i = 0; i < DAEMON_QUERIES; i++){
+        struct daemon_query *e = &cache[i];
+        if (e->query != NULL && e->len == q->len && memcmp(e->args, q->args, q->len) == 0){
+            if (now - e->compiled < DAEMON_TTL_SEC){
+                e->used = ++*clock;
+                return e;
+            }
+            slot = e;
+            break;
+        }
+        if (e->used < slot->used){		//the empty ones first, they are at 0
+            slot = e;
+        }
+    }
+    for (size_t i = 0; i < q->len; i++){
+        argc += q->args[i] == '\0';
+    }
+    q->argv = xmalloc((argc + 1) * sizeof(*q->argv));
+    q->argv[0] = "find";
+    for (size_t i = 0, k = 1; i < q->len; i += strlen(q->args + i) + 1){
+        q->argv[k++] = q->args + i;
+    }
+    q->argv[argc] = NULL;
+    q->query = find_compile((int)argc, q->argv, err, sizeof(err));
+    if (q->query == NULL){
+        error(0, 0, "%s", err);
+        return NULL;
+    }
+    const struct plan *plan = &q->query->plan;
+    if (plan->watch != NULL || plan->daemon != NULL || plan->db != NULL || plan->index_out != NULL){
+        error(0, 0, "-watch, -daemon, -db and -build-index do not work through -client");
+        find_free(q->query);
+        q->query = NULL;
+        return NULL;
+    }
+    q->compiled = now;
+    q->used = ++*clock;
+    if (!q->query->plan.reusable){
+        return q;
+    }
+    daemon_query_free(slot);
+    *slot = *q;
+    memset(q, 0, sizeof(*q));
+    return slot;
+}
+
+/**
+ *
+ * \brief: releases a compiled query of -daemon and its arguments
+ *
+ * \param q - the query, it is empty afterwards
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void daemon_query_free(struct daemon_query *q){
+    if (q->query != NULL){
+        find_free(q->query);
+    }
+    free(q->args);
+    free(q->argv);
+    memset(q, 0, sizeof(*q));
+}
+
+/**
+ *
+ * \brief: ends the running query of -daemon when its client goes away, e.g. on Ctrl-C
+ *
+ * The client sends nothing after its query, so the connection only becomes readable when
+ * it is closed. The thread is cancelled once the query is done.
+ *
+ * \param arg - the connection
+ *
+ * \return NULL
+ *
+ */
+
+static void *daemon_watch_client(void *arg){
+    struct pollfd pfd = {*(int *)arg, POLLIN | POLLRDHUP, 0};
+    int n;
+    while ((n = poll(&pfd, 1, DAEMON_POLL_MS)) == 0 || (n == -1 && errno == EINTR)){
+        pthread_testcancel();
+    }
+    atomic_store(&client_gone, 1);
+    return NULL;
+}
+
+/**
+ *
+ * \brief: handler of SIGINT and SIGTERM, which stop -daemon, and of SIGPIPE, which then only fails the write
+ *
+ * \param sig - the signal
+ *
+ */
+
+static void daemon_signal(int sig){
+    if (sig != SIGPIPE){
+        int saved = errno;
+        daemon_stop = 1;
+        ssize_t n = write(daemon_wake, "", 1);		//fails once the pipe is full, the loop is woken up then anyway
+        (void)n;
+        errno = saved;
+    }
+}
+
+/**
+ *
+ * \brief checks if the filename matches with the name given in the option
+ *
+ *  The function do_name matches the last component of the item against the
+ *  compiled pattern. Items inside a directory carry their name already,
+ *  only for start points it is cut out of the path.
+ *
+ * \param ent - the file/dircectory that is checked
+ * \param e - -name, -iname or -name-from node with the compiled pattern
+ *
+ * \return 1 - if it's successful otherwise returns 0
+ *
+ */
+
+static int do_name(const struct find_entry *ent, const struct expr *e) {
+    const char *name = ent->name;
+    size_t len;
+    if (ent->dirfd != AT_FDCWD){
+        return match_expr(e, name, strlen(name));
+    }
+    len = strlen(name);		//start point: its last component without trailing slashes
+    while (len > 1 && name[len - 1] == '/'){
+        len--;
+    }
+    const char *base = name + len;
+    while (base > name && base[-1] != '/'){
+        base--;
+    }
+    if (len == 1 && name[0] == '/'){
+        base = name;
+    }
+    if (name[len] == '\0'){
+        return match_expr(e, base, (size_t)(name + len - base));
+    }
+    char *copy = strndup(base, (size_t)(name + len - base));
+    if (copy == NULL){
+        error(EXIT_FAILURE, errno, "strndup");
+    }
+    int match = match_expr(e, copy, strlen(copy));
+    free(copy);
+    return match;
+}
+/**
+ *
+ * \brief:do_type is a function that checks for a specific type of the searched item if requested.
+ *
+ * \param type is the S_IFMT value the -type parameter [bcdpfls] was compiled to
+ * \param ent is the item, its type comes from getdents64 when possible
+ *
+ * \return 0 in case of no match or 1 if match
+ *
+ */
+
+
+static int do_type(mode_t type, struct find_entry *ent) {
+    return entry_type(ent) == type;
+}
+
+/**
+ *
+ * \brief:print function takes the file name and prints it
+ *
+ *
+ * \param: w is the walker whose output buffer receives the name
+ * \param: out is the index of the output, stdout or a file of -fprint
+ * \param: file_name is the item to print
+ * \param: term is written after the name, '\n' or '\0' for -print0
+ *
+ *
+ * \return: no return value. only printing
+ *
+ *
+ */
+
+
+static void do_print(struct walker *w, size_t out, const char *file_name, char term) {
+    size_t len = strlen(file_name);
+    char *p = out_reserve(w, out, len + 1);
+    memcpy(p, file_name, len);
+    p[len] = term;
+    out_commit(w, out, p + len + 1);
+}
+
+/**
+ *
+ * \brief: hands a result to the caller of find_walk or to the reader of an iterator
+ *
+ * The callback gets the item of the walk itself. For an iterator the item is copied into the
+ * batch of the walker together with its path, it is read after the walk moved on.
+ *
+ * \param w - the walker
+ * \param ent - the item
+ *
+ */
+
+static void do_emit(struct walker *w, struct find_entry *ent){
+    struct sink *sink = w->plan->sink;
+    if (w->sort != NULL){		//kept with the result, the path is added by sort_add
+        struct pathbuf *e = &w->sorted.emits;
+        if (e->len + sizeof(*ent) > e->cap){
+            e->cap = e->cap ? e->cap * 2 : 4 * sizeof(*ent);
+            e->buf = xrealloc(e->buf, e->cap);
+        }
+        memcpy(e->buf + e->len, ent, sizeof(*ent));
+        e->len += sizeof(*ent);
+        return;
+    }
+    if (sink->iter == NULL){
+        if (sink->callback(ent, sink->arg) != 0){
+            atomic_store(&sink->stop, 1);
+        }
+        return;
+    }
+    if (walk_stopped(w->plan)){
+        return;
+    }
+    if (w->emit == NULL){
+        w->emit = iter_get(sink->iter);
+    }
+    struct iter_batch *b = w->emit;
+    size_t len = strlen(ent->path);
+    if (b->paths.len + len + 1 > b->paths.cap){
+        size_t cap = b->paths.cap ? b->paths.cap : PATH_INITIAL;
+        while (b->paths.len + len + 1 > cap){
+            cap *= 2;
+        }
+        b->paths.buf = xrealloc(b->paths.buf, cap);
+        b->paths.cap = cap;
+    }
+    memcpy(b->paths.buf + b->paths.len, ent->path, len + 1);
+    b->off[b->count] = b->paths.len;
+    b->paths.len += len + 1;
+    struct find_entry *item = &b->items[b->count++];
+    item->path = NULL;		//set by iter_put, the buffer may still move
+    item->dirfd = AT_FDCWD;
+    item->name = NULL;
+    item->d_type = ent->d_type;
+    item->stat_mask = ent->stat_mask;
+    item->have_stat = ent->have_stat;
+    if (ent->have_stat == 1){
+        item->st = ent->st;
+    }
+    item->depth = ent->depth;
+    item->prune = 0;
+    if (b->count == ITER_BATCH){
+        iter_put(sink->iter, b);
+        w->emit = NULL;
+    }
+}
+
+/**
+ *
+ * \brief: returns an empty batch for a walker of an iterator
+ *
+ * A batch the reader gave back is used again. Only ITER_BATCHES more batches than walkers
+ * (the readers of -contains included) are allocated, then the walk waits until the reader catches up.
+ *
+ * \param it - the iterator
+ *
+ * \return the batch
+ *
+ */
+
+static struct iter_batch *iter_get(struct find_iter *it){
+    const struct plan *plan = &it->query->plan;
+    size_t max = (size_t)(ITER_BATCHES + plan->jobs + (plan->contains ? plan->contains_jobs : 0));
+    struct iter_batch *b;
+    pthread_mutex_lock(&it->lock);
+    while (it->spare == NULL && it->nbatches >= max && !atomic_load(&it->sink.stop)){
+        pthread_cond_wait(&it->cond, &it->lock);
+    }
+    if ((b = it->spare) != NULL){
+        it->spare = b->next;
+    }
+    else {
+        it->nbatches++;
+    }
+    pthread_mutex_unlock(&it->lock);
+    if (b == NULL){
+        b = xmalloc(sizeof(*b));
+        b->paths.buf = NULL;
+        b->paths.cap = 0;
+    }
+    b->next = NULL;
+    b->count = 0;
+    b->paths.len = 0;
+    return b;
+}
+
+/**
+ *
+ * \brief: hands a batch of a walker to the reader of an iterator
+ *
+ * \param it - the iterator
+ * \param b - the batch, empty batches and those of an ended walk are kept for reuse
+ *
+ */
+
+static void iter_put(struct find_iter *it, struct iter_batch *b){
+    for (size_t i = 0; i < b->count; i++){
+        b->items[i].path = b->paths.buf + b->off[i];
+        b->items[i].name = b->items[i].path;
+    }
+    b->next = NULL;
+    pthread_mutex_lock(&it->lock);
+    if (b->count == 0 || atomic_load(&it->sink.stop)){
+        b->next = it->spare;
+        it->spare = b;
+    }
+    else if (it->last != NULL){
+        it->last->next = b;
+        it->last = b;
+    }
+    else {
+        it->full = it->last = b;
+    }
+    pthread_cond_broadcast(&it->cond);
+    pthread_mutex_unlock(&it->lock);
+}
+
+/**
+ *
+ * \brief: hands the partly filled batch of a walker to the reader, at the end of its walk
+ *
+ * \param w - the walker
+ *
+ */
+
+static void iter_flush(struct walker *w){
+    if (w->emit != NULL){
+        iter_put(w->plan->sink->iter, w->emit);
+        w->emit = NULL;
+    }
+}
+
+/**
+ *
+ * \brief: thread of an iterator, walks the query and tells the reader when it is done
+ *
+ * \param arg - the iterator
+ *
+ * \return NULL
+ *
+ */
+
+static void *iter_walk(void *arg){
+    struct find_iter *it = arg;
+    int status = walk_plan(&it->query->plan);
+    pthread_mutex_lock(&it->lock);
+    it->status = status;
+    it->done = 1;
+    pthread_cond_broadcast(&it->cond);
+    pthread_mutex_unlock(&it->lock);
+    return NULL;
+}
+
+/**
+ * \brief tells whether the caller of find_walk or of an iterator, or the client of -daemon, ended the walk
+ */
+
+static int walk_stopped(const struct plan *plan){
+    return (plan->sink != NULL && atomic_load_explicit(&plan->sink->stop, memory_order_relaxed))
+        || atomic_load_explicit(&client_gone, memory_order_relaxed);
+}
+
+
+/**
+ *
+ * \brief: do_path function matches the whole path of the item against the pattern, like POSIX find
+ *
+ * \param entry_name is the whole path of the item
+ * \param e is the -path, -ipath or -path-from node with the compiled pattern
+ *
+ * \return 1 in case of success, 0 otherwise
+ *
+ */
+
+static int do_path(const char *entry_name, const struct expr *e) {
+    return match_expr(e, entry_name, strlen(entry_name));
+}
+
+/**
+ *
+ * \brief: do_regex matches the whole path of the item against the regular expression, like GNU find
+ *
+ * \param path is the whole path of the item
+ * \param e is the -regex or -iregex node
+ * \param w is the walker, it holds the DFA of the node
+ *
+ * \return 1 in case of success, 0 otherwise
+ *
+ */
+
+static int do_regex(const char *path, const struct expr *e, struct walker *w) {
+    return match_regex(e->arg.regex, &w->dfas[e->arg.regex->index], path, strlen(path));
+}
+
+/**
+ *
+ * \brief: do_contains checks whether a regular file contains one of the strings of the node
+ *
+ * If the walk has readers and no action ran for the item yet, the item is handed to them
+ * and the rest of its evaluation is skipped; a reader evaluates the whole expression again,
+ * so the walk goes on while the file is read. The tests in front of -contains, which have
+ * no side effects, run twice then, -stats counts them once.
+ *
+ * \param ent is the item
+ * \param e is the -contains or -contains-from node
+ * \param w is the walker
+ *
+ * \return 1 in case of success, 0 otherwise, also if the item went to the readers
+ *
+ */
+
+static int do_contains(struct find_entry *ent, const struct expr *e, struct walker *w) {
+    w->replay = 0;
+    if (entry_type(ent) != S_IFREG){
+        return 0;
+    }
+    if (w->reads != NULL && !w->effects){
+        reads_push(w->reads, ent, w->root);
+        w->deferred = 1;
+        return 0;
+    }
+    return read_contains(ent, e->arg.needles, w);
+}
+
+/**
+ *
+ * \brief: reads a file in blocks and searches them for the strings
+ *
+ * The file is read with read() instead of being mapped, a file truncated while it is mapped
+ * would end the program with SIGBUS. Consecutive blocks overlap by the length of the longest
+ * string less one byte, so a string spanning two blocks is found. The search stops at the first
+ * match, at the end of the file or after plan->contains_max bytes. A file with a null byte
+ * in its first CONTAINS_SNIFF bytes is binary and never matches, like grep -I.
+ *
+ * \param ent - the file
+ * \param nd - the strings
+ * \param w - the walker, holds the buffer
+ *
+ * \return 1 if the file contains one of the strings, 0 otherwise
+ *
+ */
+
+static int read_contains(struct find_entry *ent, const struct needles *nd, struct walker *w){
+    size_t total = 0;
+    size_t keep = 0;
+    int found = 0;
+    uint64_t start = w->stats != NULL ? stats_ticks() : 0;
+    int fd = openat(ent->dirfd, ent->name, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1){
+        error(0, errno, "cannot open %s", ent->path);
+        return 0;
+    }
+    if (w->readcap < CONTAINS_BLOCK + nd->maxlen){
+        free(w->readbuf);
+        w->readcap = CONTAINS_BLOCK + nd->maxlen;
+        w->readbuf = xmalloc(w->readcap);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    while (!found && total < w->plan->contains_max){
+        size_t want = w->plan->contains_max - total < CONTAINS_BLOCK ? w->plan->contains_max - total : CONTAINS_BLOCK;
+        ssize_t n = read(fd, w->readbuf + keep, want);
+        if (n == -1 && errno == EINTR){
+            continue;
+        }
+        if (n == -1){
+            error(0, errno, "cannot read %s", ent->path);
+            break;
+        }
+        if (n == 0 || (total == 0 && memchr(w->readbuf, '\0', (size_t)n < CONTAINS_SNIFF ? (size_t)n : CONTAINS_SNIFF) != NULL)){
+            break;
+        }
+        total += (size_t)n;
+        size_t len = keep + (size_t)n;
+        found = nd->match_all || match_needles(nd, w->readbuf, len);
+        keep = len < nd->maxlen - 1 ? len : nd->maxlen - 1;
+        memmove(w->readbuf, w->readbuf + len - keep, keep);
+    }
+    close(fd);
+    if (w->stats != NULL){
+        w->stats->reads++;
+        w->stats->read_bytes += total;
+        w->stats->read_ticks += stats_ticks() - start;
+    }
+    return found;
+}
+
+/**
+ *
+ * \brief  Extended output of a file.
+ *
+ *  Indicates the number of the inode, number of blocks, permissions, number of links,
+ * Owner, Group, Last Modification Time and the name of the directory entry.
+ * The line is formatted straight into the output buffer.
+ *
+ * \param w - the walker whose output buffer receives the line
+ * \param out - index of the output
+ * \param path - file/dircectory name that is passed
+ * \param buf - contains information about the file and/or directory
+ * \return no return value
+ *
+ */
+
+static void do_ls(struct walker *w, size_t out, const char *path, const struct stat *buf) {
+    const char *user;
+    const char *group;
+    char uid_buff[24];
+    char gid_buff[24];
+    time_t minute = buf->st_mtime / 60;
+    if (minute != w->ls_minute){		//localtime_r is expensive, files of a directory often share the minute
+        struct tm time;
+        localtime_r(&(buf->st_mtime), &time);
+        strftime(w->ls_date, sizeof(w->ls_date), "%b %e %H:%M", &time);
+        w->ls_minute = minute;
+    }
+
+    user = user_name(buf->st_uid);
+    if (user == NULL){		//owners without a name are shown by id like ls does
+        format_number(uid_buff, buf->st_uid, 0)[0] = '\0';
+        user = uid_buff;
+    }
+    group = group_name(buf->st_gid);
+    if (group == NULL){
+        format_number(gid_buff, buf->st_gid, 0)[0] = '\0';
+        group = gid_buff;
+    }
+
+    size_t pathlen = strlen(path);
+    size_t datelen = strlen(w->ls_date);
+    char *p = out_reserve(w, out, LS_FIXED_MAX + strlen(user) + strlen(group) + pathlen);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = format_number(p, buf->st_ino, 5);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = format_number(p, (unsigned long long)buf->st_blocks / 2, 5); ////BLOCKSIZE*st_blocks / st_size ->umsetzen nur wie?
+    *p++ = ' ';
+    p = format_permission_string(p, buf->st_mode);
+    *p++ = ' ';
+    p = format_number(p, buf->st_nlink, 3);
+    *p++ = ' ';
+    p = format_string(p, user, 2);
+    *p++ = ' ';
+    p = format_string(p, group, 8);
+    *p++ = ' ';
+    p = format_number(p, (unsigned long long)buf->st_size, 12);
+    *p++ = ' ';
+    memcpy(p, w->ls_date, datelen);
+    p += datelen;
+    *p++ = ' ';
+    memcpy(p, path, pathlen);
+    p += pathlen;
+    *p++ = '\n';
+    out_commit(w, out, p);
+}
+
+/**
+ *
+ * \brief: compiles the format of -printf into a list of steps, escapes are resolved here once
+ *
+ * Directives follow GNU find: %p %f %h %P %H %d %s %b %k %m %M %u %g %U %G %i %n %D %y %Y %l,
+ * the times %a %c %t and %Ak %Ck %Tk with k a strftime conversion or @ + S T for the seconds
+ * with fraction, and %%. A - flag, a width and a precision are honored, other flags ignored.
+ * Unknown directives and escapes are reported and written as they are.
+ *
+ * \param format - the format as given
+ *
+ * \return the compiled format
+ *
+ */
+
+static struct format *compile_format(const char *format){
+    struct format *f = xmalloc(sizeof(*f));
+    size_t cap = 8;
+    char *text = xmalloc(strlen(format) + 1);		//literal text never grows
+    char *t = text;
+    const char *s = format;
+    f->ops = xmalloc(cap * sizeof(*f->ops));
+    f->nops = 0;
+    f->stop = 0;
+    f->stat_mask = 0;
+    f->text = text;
+    while (*s != '\0' && !f->stop){
+        struct fmt_op op = {'\0', '\0', 0, 0, 0, -1, t, 0};
+        while (*s != '\0' && *s != '%'){		//a run of literal text
+            if (*s != '\\'){
+                *t++ = *s++;
+                continue;
+            }
+            s++;
+            const char *esc = strchr("abfnrtv\\", *s);
+            if (*s != '\0' && esc != NULL){
+                *t++ = "\a\b\f\n\r\t\v\\"[esc - "abfnrtv\\"];
+                s++;
+            }
+            else if (*s >= '0' && *s <= '7'){
+                int c = 0;
+                for (int i = 0; i < 3 && *s >= '0' && *s <= '7'; i++){
+                    c = c * 8 + (*s++ - '0');
+                }
+                *t++ = (char)c;
+            }
+            else if (*s == 'c'){		//stop here and flush the output
+                f->stop = 1;
+                break;
+            }
+            else {
+                error(0, 0, "warning: unrecognized escape `\\%c'", *s);
+                *t++ = '\\';
+            }
+        }
+        op.len = (size_t)(t - op.text);
+        if (op.len > 0){
+            format_add(f, &op, &cap);
+        }
+        if (*s != '%' || f->stop){
+            continue;
+        }
+        const char *start = s++;
+        op = (struct fmt_op){'\0', '\0', 0, 0, 0, -1, NULL, 0};
+        for (; *s != '\0' && strchr("-+ #0", *s) != NULL; s++){
+            op.left |= *s == '-';
+            op.alt |= *s == '#';
+        }
+        for (; isdigit((unsigned char)*s); s++){
+            op.width = op.width * 10 + (*s - '0');
+        }
+        if (*s == '.'){
+            op.prec = 0;
+            for (s++; isdigit((unsigned char)*s); s++){
+                op.prec = op.prec * 10 + (*s - '0');
+            }
+        }
+        if (*s != '\0' && strchr("pfhPHdsbkmMugUGinDyYlact%", *s) != NULL){
+            op.conv = *s++;
+        }
+        else if ((*s == 'A' || *s == 'C' || *s == 'T') && s[1] != '\0'){
+            op.conv = *s++;
+            op.time = *s++;
+        }
+        else {
+            if (*s != '\0'){
+                s++;
+            }
+            error(0, 0, "warning: unrecognized format directive `%.*s'", (int)(s - start), start);
+            op.text = t;
+            memcpy(t, start, (size_t)(s - start));
+            t += s - start;
+            op.len = (size_t)(s - start);
+            format_add(f, &op, &cap);
+            continue;
+        }
+        if (op.conv == '%'){
+            op.conv = '\0';
+            op.text = t;
+            *t++ = '%';
+            op.len = 1;
+        }
+        switch (op.conv){
+            case 's': f->stat_mask |= STATX_SIZE; break;
+            case 'b': case 'k': f->stat_mask |= STATX_BLOCKS; break;
+            case 'm': case 'M': f->stat_mask |= STATX_MODE; break;
+            case 'u': case 'U': f->stat_mask |= STATX_UID; break;
+            case 'g': case 'G': f->stat_mask |= STATX_GID; break;
+            case 'i': f->stat_mask |= STATX_INO; break;
+            case 'n': f->stat_mask |= STATX_NLINK; break;
+            case 'D': case 'y': case 'Y': case 'l': f->stat_mask |= STATX_TYPE; break;
+            case 'a': case 'A': f->stat_mask |= STATX_ATIME; break;
+            case 'c': case 'C': f->stat_mask |= STATX_CTIME; break;
+            case 't': case 'T': f->stat_mask |= STATX_MTIME; break;
+        }
+        format_add(f, &op, &cap);
+    }
+    return f;
+}
+
+/**
+ *
+ * \brief: appends a step to a compiled format
+ *
+ * \param f - the format
+ * \param op - the step, copied
+ * \param cap - capacity of the steps, grown on demand
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void format_add(struct format *f, const struct fmt_op *op, size_t *cap){
+    if (f->nops == *cap){
+        *cap *= 2;
+        f->ops = xrealloc(f->ops, *cap * sizeof(*f->ops));
+    }
+    f->ops[f->nops++] = *op;
+}
+
+/**
+ *
+ * \brief: writes an item with a compiled -printf format
+ *
+ * The record is put together in the scratch buffer of the walker first and then copied
+ * into the output buffer as a whole, so the records of -j never interleave.
+ *
+ * \param w - the walker
+ * \param out - index of the output
+ * \param f - the format
+ * \param ent - the item, its stat data is fetched if a directive needs it
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void do_printf(struct walker *w, size_t out, const struct format *f, struct find_entry *ent){
+    struct pathbuf *line = &w->line;
+    const struct stat *st = NULL;
+    line->len = 0;
+    if (f->stat_mask != 0 && (st = entry_stat(ent)) == NULL){
+        return;		//reported by entry_stat, like -ls nothing is written
+    }
+    for (size_t i = 0; i < f->nops; i++){
+        const struct fmt_op *op = &f->ops[i];
+        char num[64];
+        char link[PATH_MAX];
+        const char *str = num;
+        size_t len = 0;
+        size_t base;
+        switch (op->conv){
+            case '\0':
+                str = op->text;
+                len = op->len;
+                break;
+            case 'p':
+                str = ent->path;
+                len = strlen(str);
+                break;
+            case 'f':
+                len = strlen(ent->path);
+                base = path_base(ent, len);
+                str = ent->path + base;
+                len -= base;
+                while (len > 1 && str[len - 1] == '/' && str[len - 2] == '/'){		//a start point keeps one trailing slash like in GNU find
+                    len--;
+                }
+                break;
+            case 'h':
+                str = ent->path;
+                len = strlen(str);
+                base = len;
+                while (base > 1 && str[base - 1] == '/'){		//trailing slashes of a start point are no separator
+                    base--;
+                }
+                size_t end = base;
+                while (base > 0 && str[base - 1] != '/'){
+                    base--;
+                }
+                if (base == 0 && end == len){		//no directory in front
+                    str = ".";
+                    len = 1;
+                }
+                else if (base == 0 || base == end){		//"d/" or "/" itself, GNU find drops one slash
+                    len--;
+                }
+                else {
+                    len = base - 1;		//one slash goes, empty for an item right below "/" like in GNU find
+                }
+                break;
+            case 'P':
+                len = w->root != NULL ? strlen(w->root) : 0;
+                str = ent->depth == 0 ? "" : ent->path + len + (len > 0 && ent->path[len] == '/');
+                len = strlen(str);
+                break;
+            case 'H':
+                str = w->root != NULL ? w->root : "";
+                len = strlen(str);
+                break;
+            case 'd':
+                len = (size_t)(format_number(num, (unsigned long long)ent->depth, 0) - num);
+                break;
+            case 's':
+                len = (size_t)(format_number(num, (unsigned long long)st->st_size, 0) - num);
+                break;
+            case 'b':
+                len = (size_t)(format_number(num, (unsigned long long)st->st_blocks, 0) - num);
+                break;
+            case 'k':
+                len = (size_t)(format_number(num, ((unsigned long long)st->st_blocks + 1) / 2, 0) - num);
+                break;
+            case 'm':
+                len = (size_t)snprintf(num, sizeof(num), op->alt ? "%#o" : "%o", (unsigned int)(st->st_mode & 07777));
+                break;
+            case 'M':
+                len = (size_t)(format_permission_string(num, st->st_mode) - num);
+                break;
+            case 'u':
+            case 'g':
+                str = op->conv == 'u' ? user_name(st->st_uid) : group_name(st->st_gid);
+                if (str != NULL){
+                    len = strlen(str);
+                    break;
+                }
+                str = num;		//no name, the id like -ls does
+                /* fall through */
+            case 'U':
+            case 'G':
+                len = (size_t)(format_number(num, op->conv == 'u' || op->conv == 'U' ? st->st_uid : st->st_gid, 0) - num);
+                break;
+            case 'i':
+                len = (size_t)(format_number(num, (unsigned long long)st->st_ino, 0) - num);
+                break;
+            case 'n':
+                len = (size_t)(format_number(num, (unsigned long long)st->st_nlink, 0) - num);
+                break;
+            case 'D':
+                len = (size_t)(format_number(num, (unsigned long long)st->st_dev, 0) - num);
+                break;
+            case 'y':
+                num[0] = type_char(st->st_mode);
+                len = 1;
+                break;
+            case 'Y':
+                num[0] = type_char(st->st_mode);
+                if (S_ISLNK(st->st_mode)){
+                    struct stat target;
+                    num[0] = fstatat(ent->dirfd, ent->name, &target, 0) == 0 ? type_char(target.st_mode) : errno == ELOOP ? 'L' : 'N';
+                }
+                len = 1;
+                break;
+            case 'l':
+                if (S_ISLNK(st->st_mode)){
+                    ssize_t n = readlinkat(ent->dirfd, ent->name, link, sizeof(link));
+                    str = link;
+                    len = n > 0 ? (size_t)n : 0;
+                }
+                break;
+            case 'a':
+            case 'c':
+            case 't':
+                len = format_time(w, num, st, op->conv == 't' ? 'm' : op->conv, 'c');
+                break;
+            default:		//%A, %C, %T
+                len = format_time(w, num, st, op->conv == 'T' ? 'm' : op->conv + 'a' - 'A', op->time);
+                break;
+        }
+        if (op->prec >= 0 && len > (size_t)op->prec){
+            len = (size_t)op->prec;
+        }
+        size_t pad = op->width > 0 && (size_t)op->width > len ? (size_t)op->width - len : 0;
+        char *p = line_reserve(line, len + pad);
+        if (!op->left){
+            memset(p, ' ', pad);
+            p += pad;
+        }
+        memcpy(p, str, len);
+        if (op->left){
+            memset(p + len, ' ', pad);
+        }
+        line->len += len + pad;
+    }
+    char *p = out_reserve(w, out, line->len);
+    memcpy(p, line->buf, line->len);
+    out_commit(w, out, p + line->len);
+    if (f->stop){
+        out_flush(w, out);
+    }
+}
+
+/**
+ *
+ * \brief: makes room at the end of a scratch buffer
+ *
+ * \param b - the buffer, its length is not changed
+ * \param len - bytes needed
+ *
+ * \return pointer to the room behind the current content
+ *
+ */
+
+static char *line_reserve(struct pathbuf *b, size_t len){
+    if (b->len + len > b->cap){
+        b->cap = b->cap > 0 ? b->cap : PATH_INITIAL;
+        while (b->len + len > b->cap){
+            b->cap *= 2;
+        }
+        b->buf = xrealloc(b->buf, b->cap);
+    }
+    return b->buf + b->len;
+}
+
+/**
+ *
+ * \brief: finds where the last element of the path of an item starts, for %f and %h
+ *
+ * Start points keep a trailing slash in %f like in GNU find. Items looked up by
+ * their whole path, the start points, -db and -watch, are split here.
+ *
+ * \param ent - the item
+ * \param len - length of its path
+ *
+ * \return offset of the last element in the path
+ *
+ */
+
+static size_t path_base(const struct find_entry *ent, size_t len){
+    if (ent->dirfd != AT_FDCWD){
+        return len - strlen(ent->name);
+    }
+    size_t end = len;
+    while (end > 1 && ent->path[end - 1] == '/'){
+        end--;
+    }
+    while (end > 0 && ent->path[end - 1] != '/'){
+        end--;
+    }
+    return end == len ? 0 : end;		//"/" is its own name
+}
+
+/**
+ *
+ * \brief: returns the letter of -type for a file type, U if it is unknown
+ *
+ * \param mode - the mode of the item
+ *
+ * \return the letter
+ *
+ */
+
+static char type_char(mode_t mode){
+    switch (mode & S_IFMT){
+        case S_IFREG: return 'f';
+        case S_IFDIR: return 'd';
+        case S_IFLNK: return 'l';
+        case S_IFBLK: return 'b';
+        case S_IFCHR: return 'c';
+        case S_IFIFO: return 'p';
+        case S_IFSOCK: return 's';
+        default: return 'U';
+    }
+}
+
+/**
+ *
+ * \brief: formats one of the times of an item for -printf
+ *
+ * The broken down time of the last minute is kept in the walker, the items of a directory often share it.
+ *
+ * \param w - the walker
+ * \param out - receives the text, at least 64 bytes
+ * \param st - stat data of the item
+ * \param field - 'a', 'c' or 'm'
+ * \param conv - a strftime conversion, @ for seconds since the epoch, + S T with fraction, or c for the ctime like form
+ *
+ * \return the length of the text
+ *
+ */
+
+static size_t format_time(struct walker *w, char *out, const struct stat *st, char field, char conv){
+    const struct timespec *ts = field == 'a' ? &st->st_atim : field == 'c' ? &st->st_ctim : &st->st_mtim;
+    char frac[16];
+    char spec[3] = {'%', conv, '\0'};
+    snprintf(frac, sizeof(frac), ".%09ld0", ts->tv_nsec);		//GNU find prints ten digits
+    if (conv == '@'){
+        return (size_t)snprintf(out, 64, "%lld%s", (long long)ts->tv_sec, frac);
+    }
+    time_t minute = ts->tv_sec / 60 - (ts->tv_sec % 60 < 0);
+    if (minute != w->fmt_minute){
+        time_t t = minute * 60;
+        localtime_r(&t, &w->fmt_tm);
+        w->fmt_minute = minute;
+    }
+    struct tm tm = w->fmt_tm;
+    tm.tm_sec = (int)(ts->tv_sec - minute * 60);
+    const char *layout = conv == 'c' ? "%a %b %e %H:%M:%S" : conv == '+' ? "%Y-%m-%d+%H:%M:%S" : conv == 'S' ? "%S" : conv == 'T' ? "%H:%M:%S" : spec;
+    size_t len = strftime(out, 64, layout, &tm);
+    if (layout != spec){
+        len += (size_t)snprintf(out + len, 64 - len, "%s", frac);
+    }
+    if (conv == 'c'){
+        len += (size_t)snprintf(out + len, 64 - len, " %d", tm.tm_year + 1900);
+    }
+    return len;
+}
+
+/**
+ *
+ * \brief: writes an item as a record of -format ndjson, csv or bin instead of its bare path
+ *
+ * All three carry path, type, mode, uid, gid, size, mtime and inode. The binary record is a
+ * struct bin_record in native byte order followed by the path, padded with zero bytes to a
+ * multiple of 8 so the next record is aligned again.
+ *
+ * \param w - the walker
+ * \param out - index of the output
+ * \param ent - the item
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void do_record(struct walker *w, size_t out, struct find_entry *ent){
+    const struct stat *st = entry_stat(ent);
+    size_t len = strlen(ent->path);
+    char *p;
+    if (st == NULL){
+        return;
+    }
+    if (w->plan->format == FORMAT_BIN){
+        struct bin_record r;
+        size_t size = (sizeof(r) + len + 7) & ~(size_t)7;
+        r.len = (uint32_t)size;
+        r.pathlen = (uint32_t)len;
+        r.mode = (uint32_t)st->st_mode;
+        r.uid = (uint32_t)st->st_uid;
+        r.gid = (uint32_t)st->st_gid;
+        r.nlink = (uint32_t)st->st_nlink;
+        r.size = (uint64_t)st->st_size;
+        r.mtime = stat_time(st, 'm');
+        r.ino = (uint64_t)st->st_ino;
+        p = out_reserve(w, out, size);
+        memcpy(p, &r, sizeof(r));
+        memcpy(p + sizeof(r), ent->path, len);
+        memset(p + sizeof(r) + len, 0, size - sizeof(r) - len);
+        out_commit(w, out, p + size);
+        return;
+    }
+    int json = w->plan->format == FORMAT_NDJSON;
+    p = out_reserve(w, out, 6 * len + RECORD_FIXED_MAX);
+    if (json){
+        p = stpcpy(p, "{\"path\":\"");
+        p = format_json_string(p, ent->path, len);
+        p = stpcpy(p, "\",\"type\":\"");
+    }
+    else {
+        p = format_csv_string(p, ent->path, len);
+        *p++ = ',';
+    }
+    *p++ = type_char(st->st_mode);
+    p = stpcpy(p, json ? "\",\"mode\":\"" : ",");
+    for (int shift = 9; shift >= 0; shift -= 3){
+        *p++ = (char)('0' + ((st->st_mode >> shift) & 7));
+    }
+    p = stpcpy(p, json ? "\",\"uid\":" : ",");
+    p = format_number(p, st->st_uid, 0);
+    p = stpcpy(p, json ? ",\"gid\":" : ",");
+    p = format_number(p, st->st_gid, 0);
+    p = stpcpy(p, json ? ",\"size\":" : ",");
+    p = format_number(p, (unsigned long long)st->st_size, 0);
+    p = stpcpy(p, json ? ",\"mtime\":" : ",");
+    p = format_seconds(p, &st->st_mtim);
+    p = stpcpy(p, json ? ",\"ino\":" : ",");
+    p = format_number(p, (unsigned long long)st->st_ino, 0);
+    p = stpcpy(p, json ? "}\n" : "\n");
+    out_commit(w, out, p);
+}
+
+/**
+ *
+ * \brief: writes the contents of a JSON string, valid UTF-8 is passed on unchanged
+ *
+ * Each byte that is not part of a valid UTF-8 character is written as the escape of the
+ * code point with its value, \u0080 to \u00ff. Those characters are written unescaped when
+ * they are valid, so a reader can turn such escapes back into the bytes of the name.
+ *
+ * \param out - receives at most six bytes per input byte
+ * \param str - the string
+ * \param len - its length
+ *
+ * \return pointer behind the written characters
+ *
+ */
+
+static char *format_json_string(char *out, const char *str, size_t len){
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++){
+        unsigned char c = (unsigned char)str[i];
+        size_t n = c >= 0x80 ? utf8_char(str + i, len - i) : 0;
+        if (n > 0){		//a whole valid character, passed through
+            memcpy(out, str + i, n);
+            out += n;
+            i += n - 1;
+        }
+        else if (c == '"' || c == '\\'){
+            *out++ = '\\';
+            *out++ = (char)c;
+        }
+        else if (c == '\n' || c == '\t'){
+            *out++ = '\\';
+            *out++ = c == '\n' ? 'n' : 't';
+        }
+        else if (c < 0x20 || c >= 0x7f){		//bytes that are not UTF-8 become U+0080 to U+00FF, which are never written escaped otherwise
+            out = stpcpy(out, "\\u00");
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 15];
+        }
+        else {
+            *out++ = (char)c;
+        }
+    }
+    return out;
+}
+
+/**
+ *
+ * \brief: length of the UTF-8 character a string starts with
+ *
+ * Overlong forms, surrogates and code points above U+10FFFF are not valid.
+ *
+ * \param s - the string
+ * \param len - bytes left in it
+ *
+ * \return 1 to 4, 0 if it does not start with a valid character
+ *
+ */
+
+static size_t utf8_char(const char *s, size_t len){
+    const unsigned char *u = (const unsigned char *)s;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+    size_t n;
+    if (u[0] < 0x80){
+        return 1;
+    }
+    if (u[0] >= 0xc2 && u[0] <= 0xdf){
+        n = 2;
+    }
+    else if (u[0] >= 0xe0 && u[0] <= 0xef){
+        n = 3;
+        lo = u[0] == 0xe0 ? 0xa0 : 0x80;
+        hi = u[0] == 0xed ? 0x9f : 0xbf;
+    }
+    else if (u[0] >= 0xf0 && u[0] <= 0xf4){
+        n = 4;
+        lo = u[0] == 0xf0 ? 0x90 : 0x80;
+        hi = u[0] == 0xf4 ? 0x8f : 0xbf;
+    }
+    else {
+        return 0;
+    }
+    if (len < n || u[1] < lo || u[1] > hi){
+        return 0;
+    }
+    for (size_t i = 2; i < n; i++){
+        if (u[i] < 0x80 || u[i] > 0xbf){
+            return 0;
+        }
+    }
+    return n;
+}
+
+/**
+ *
+ * \brief: writes a CSV field, quoted like RFC 4180 if it contains a comma, a quote or a line break
+ *
+ * \param out - receives at most two bytes per input byte and the quotes
+ * \param str - the field
+ * \param len - its length
+ *
+ * \return pointer behind the written characters
+ *
+ */
+
+static char *format_csv_string(char *out, const char *str, size_t len){
+    if (strpbrk(str, ",\"\r\n") == NULL){
+        memcpy(out, str, len);
+        return out + len;
+    }
+    *out++ = '"';
+    for (size_t i = 0; i < len; i++){
+        if (str[i] == '"'){
+            *out++ = '"';
+        }
+        *out++ = str[i];
+    }
+    *out++ = '"';
+    return out;
+}
+
+/**
+ *
+ * \brief: writes a time as seconds since the epoch with nine decimals
+ *
+ * \param out - receives the text, at most 31 bytes
+ * \param ts - the time
+ *
+ * \return pointer behind the written characters
+ *
+ */
+
+static char *format_seconds(char *out, const struct timespec *ts){
+    long long sec = ts->tv_sec;
+    long nsec = ts->tv_nsec;
+    if (sec < 0){
+        *out++ = '-';
+        sec = nsec > 0 ? -(sec + 1) : -sec;
+        nsec = nsec > 0 ? 1000000000L - nsec : 0;
+    }
+    out = format_number(out, (unsigned long long)sec, 0);
+    *out++ = '.';
+    for (long div = 100000000L; div > 0; div /= 10){
+        *out++ = (char)('0' + nsec / div % 10);
+    }
+    return out;
+}
+
+/**
+ *
+ * \brief: writes the header of -format csv or bin to the outputs -print writes to, before the walk
+ *
+ * \param plan - the plan
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void format_header(const struct plan *plan){
+    static const char csv[] = "path,type,mode,uid,gid,size,mtime,ino\n";
+    struct bin_header h;
+    const char *buf = csv;
+    size_t len = sizeof(csv) - 1;
+    if (plan->format == FORMAT_BIN){
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, BIN_MAGIC, sizeof(h.magic));
+        h.version = BIN_VERSION;
+        h.record = sizeof(struct bin_record);
+        buf = (const char *)&h;
+        len = sizeof(h);
+    }
+    else if (plan->format != FORMAT_CSV){
+        return;
+    }
+    for (size_t i = 0; i < plan->noutputs; i++){
+        if (plan->outputs[i].records && (i > 0 || plan->sink == NULL) && write(plan->outputs[i].fd, buf, len) != (ssize_t)len){		//with a sink the records of stdout go to the caller
+            error(serving ? 0 : EXIT_FAILURE, errno, "\nError while printing to %s\n", plan->outputs[i].name != NULL ? plan->outputs[i].name : "stdout");
+            atomic_store(&client_gone, 1);		//only reached while serving, the query of -daemon ends
+        }
+    }
+}
+
+/**
+ * \brief converts the entry attributes to readable permissions
+ *
+ * Writes the type character and the nine rwx characters of the mode.
+ *
+ *
+ * \param out - receives the ten characters
+ * \param mode - st_mode of the file and/or directory
+ * \returns pointer behind the written characters
+ */
+
+static char *format_permission_string(char *out, mode_t mode) {
+    char type;
+    switch(mode & S_IFMT)
+    {
+        case S_IFSOCK: type = 's'; break;
+        case S_IFLNK: type = 'l'; break;
+        case S_IFREG: type = '-'; break;
+        case S_IFBLK: type = 'b'; break;
+        case S_IFDIR: type = 'd'; break;
+        case S_IFCHR: type = 'c'; break;
+        case S_IFIFO: type= 'p'; break;
+        default: type = '-';
+    }
+
+    out[0] = type;
+    out[1] = (mode & S_IRUSR) ? 'r' : '-';
+    out[2] = (mode & S_IWUSR) ? 'w' : '-';
+    out[3] = (mode & S_IXUSR) ? 'x' : '-';
+    out[4] = (mode & S_IRGRP) ? 'r' : '-';
+    out[5] = (mode & S_IWGRP) ? 'w' : '-';
+    out[6] = (mode & S_IXGRP) ? 'x' : '-';
+    out[7] = (mode & S_IROTH) ? 'r' : '-';
+    out[8] = (mode & S_IWOTH) ? 'w' : '-';
+    out[9] = (mode & S_IXOTH) ? 'x' : '-';
+    if (mode & S_ISUID){		//the special bits take the place of x like in ls, upper case if x is not set
+        out[3] = (mode & S_IXUSR) ? 's' : 'S';
+    }
+    if (mode & S_ISGID){
+        out[6] = (mode & S_IXGRP) ? 's' : 'S';
+    }
+    if (mode & S_ISVTX){
+        out[9] = (mode & S_IXOTH) ? 't' : 'T';
+    }
+    return out + 10;
+}
+
+/**
+ * \brief writes a number in decimal, right aligned like printf("%*llu")
+ *
+ *
+ * \param out - receives the digits, at least max(width, 20) bytes
+ * \param number - the number
+ * \param width - minimum field width, padded with spaces on the left
+ * \returns pointer behind the written characters
+ */
+
+static char *format_number(char *out, unsigned long long number, int width) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+    for (int i = n; i < width; i++){
+        *out++ = ' ';
+    }
+    while (n > 0){
+        *out++ = digits[--n];
+    }
+    return out;
+}
+
+/**
+ * \brief writes a string right aligned like printf("%*s")
+ *
+ *
+ * \param out - receives the characters
+ * \param str - the string
+ * \param width - minimum field width, padded with spaces on the left
+ * \returns pointer behind the written characters
+ */
+
+static char *format_string(char *out, const char *str, int width) {
+    size_t len = strlen(str);
+    for (int i = (int)len; i < width; i++){
+        *out++ = ' ';
+    }
+    memcpy(out, str, len);
+    return out + len;
+}
+
+/**
+ * \brief returns room for a record in the output buffer of a walker
+ *
+ * The buffer is written first if the record does not fit anymore,
+ * a record larger than the buffer makes the buffer grow. While -sort
+ * collects stdout, its buffer grows instead.
+ *
+ *
+ * \param w - the walker
+ * \param out - index of the output
+ * \param len - maximum length of the record
+ * \returns where to write the record, out_commit finishes it
+ */
+
+static char *out_reserve(struct walker *w, size_t out, size_t len) {
+    struct outbuf *ob = &w->out[out];
+    if (ob->len + len > ob->cap){
+        out_flush(w, out);
+        if (ob->len + len > ob->cap){
+            ob->cap = ob->len + len > 2 * ob->cap ? ob->len + len : 2 * ob->cap;
+            ob->buf = xrealloc(ob->buf, ob->cap);
+        }
+    }
+    return ob->buf + ob->len;
+}
+
+/**
+ * \brief finishes a record started with out_reserve
+ *
+ * Terminals get every record right away, everything else once the buffer is full.
+ *
+ *
+ * \param w - the walker
+ * \param out - index of the output
+ * \param end - pointer behind the last character of the record
+ * \returns no return value
+ */
+
+static void out_commit(struct walker *w, size_t out, const char *end) {
+    struct outbuf *ob = &w->out[out];
+    ob->len = (size_t)(end - ob->buf);
+    if (w->plan->outputs[out].is_tty){
+        out_flush(w, out);
+    }
+}
+
+/**
+ * \brief writes the buffered records of a walker to the output
+ *
+ * The write happens under the lock of the output, so buffers of different workers never mix.
+ *
+ *
+ * \param w - the walker
+ * \param out - index of the output
+ * \returns no return value
+ */
+
+static void out_flush(struct walker *w, size_t out) {
+    struct outbuf *ob = &w->out[out];
+    struct output *o = &w->plan->outputs[out];
+    size_t done = 0;
+    if (ob->len == 0 || (out == 0 && w->sort != NULL)){		//sort_add takes the records of stdout
+        return;
+    }
+    uint64_t start = w->stats != NULL ? stats_ticks() : 0;
+    pthread_mutex_lock(&o->lock);
+    while (done < ob->len){
+        ssize_t n = write(o->fd, ob->buf + done, ob->len - done);
+        if (w->stats != NULL){
+            w->stats->writes++;
+        }
+        if (n == -1 && errno == EINTR){
+            continue;
+        }
+        if (n == -1 && serving){		//the client of -daemon went away, or its -fprint file failed, the daemon goes on with the next one
+            int err = errno;
+            pthread_mutex_unlock(&o->lock);
+            ob->len = 0;
+            if (atomic_exchange(&client_gone, 1) == 0 && out > 0){
+                error(0, err, "\nError while printing to %s\n", o->name);
+            }
+            return;
+        }
+        if (n == -1){
+            int err = errno;
+            pthread_mutex_unlock(&o->lock);
+            ob->len = 0;		//flush_at_exit must not try again
+            error(EXIT_FAILURE, err, "\nError while printing to %s\n", o->name != NULL ? o->name : "stdout");
+        }
+        done += (size_t)n;
+    }
+    pthread_mutex_unlock(&o->lock);
+    if (w->stats != NULL){
+        w->stats->write_bytes += ob->len;
+        w->stats->write_ticks += stats_ticks() - start;
+    }
+    ob->len = 0;
+}
+
+/**
+ *
+ * \brief: reads the command of -exec or -execdir up to ";" or "{} +"
+ *
+ * The "+" form needs "{}" as the last argument of the command and nowhere else.
+ *
+ * \param p - parser state, positioned behind the primary, left behind the terminator
+ * \param arg - the primary, for the error messages
+ *
+ * \return the command
+ *
+ */
+
+static struct exec *parse_exec(struct parser *p, const char *arg){
+    struct exec *ex = xmalloc(sizeof(*ex));
+    int first = p->pos;
+    ex->batch = 0;
+    ex->dir = strcmp(arg, "-execdir") == 0;
+    ex->index = 0;
+    while (p->pos < p->count && strcmp(p->args[p->pos], ";") != 0){
+        if (strcmp(p->args[p->pos], "+") == 0 && p->pos > first && strcmp(p->args[p->pos - 1], "{}") == 0){
+            ex->batch = 1;
+            break;
+        }
+        p->pos++;
+    }
+    if (p->pos >= p->count){
+        free(ex);
+        compile_error(0, "missing argument to `%s', the command ends with `;' or `{} +'", arg);
+    }
+    ex->argv = &p->args[first];
+    ex->argc = (size_t)(p->pos - first);
+    p->pos++;
+    if (ex->argc == (size_t)ex->batch){		//"{} +" alone is no command either
+        free(ex);
+        compile_error(0, "missing command to `%s'", arg);
+    }
+    if (ex->batch){
+        for (size_t i = 0; i + 1 < ex->argc; i++){
+            if (strstr(ex->argv[i], "{}") != NULL){
+                free(ex);
+                compile_error(0, "only one `{}' is supported with `%s ... +'", arg);
+            }
+        }
+        ex->index = p->plan->nexecs;
+        p->plan->execs = xrealloc(p->plan->execs, (p->plan->nexecs + 1) * sizeof(*p->plan->execs));
+        p->plan->execs[p->plan->nexecs++] = ex;
+    }
+    return ex;
+}
+
+/**
+ *
+ * \brief: runs the command of -exec or -execdir for an item, or adds the item to the batch of the "+" form
+ *
+ * The ";" form waits for the command and matches if it exits with 0. The "+" form always
+ * matches, a batch is started as soon as the next item would not fit into the arguments
+ * anymore, or with -execdir the next item is in another directory.
+ *
+ * \param ex - the command
+ * \param ent - the item
+ * \param w - the walker, holds the batches
+ *
+ * \return 1 if the item matches
+ *
+ */
+
+static int do_exec(const struct exec *ex, struct find_entry *ent, struct walker *w){
+    char *dir = NULL;
+    char *item = NULL;
+    if (ex->dir){
+        exec_split(ent->path, &dir, &item);
+    }
+    if (ex->batch){
+        struct execbatch *b = &w->batches[ex->index];
+        const char *arg = item != NULL ? item : ent->path;
+        size_t need = strlen(arg) + 1 + sizeof(char *);
+        if (b->nargs > 0 && (b->bytes + need > w->plan->arg_max || (dir != NULL && strcmp(dir, b->dir) != 0))){
+            exec_flush(w, ex->index);
+        }
+        if (b->nargs == 0){
+            b->bytes = sizeof(char *);		//the terminating NULL
+            for (size_t i = 0; i + 1 < ex->argc; i++){
+                b->bytes += strlen(ex->argv[i]) + 1 + sizeof(char *);
+            }
+            b->dir = dir;
+            dir = NULL;
+        }
+        if (b->nargs == b->cap){
+            b->cap = b->cap > 0 ? 2 * b->cap : 64;
+            b->args = xrealloc(b->args, b->cap * sizeof(*b->args));
+        }
+        if (item == NULL && (item = strdup(arg)) == NULL){
+            error(EXIT_FAILURE, errno, "strdup");
+        }
+        b->args[b->nargs++] = item;
+        b->bytes += need;
+        free(dir);
+        return 1;
+    }
+
+    char **argv = xmalloc((ex->argc + 1) * sizeof(*argv));
+    for (size_t i = 0; i < ex->argc; i++){
+        argv[i] = strstr(ex->argv[i], "{}") != NULL ? exec_arg(ex->argv[i], item != NULL ? item : ent->path) : ex->argv[i];
+    }
+    argv[ex->argc] = NULL;
+    uint64_t start = w->stats != NULL ? stats_ticks() : 0;
+    pid_t pid = exec_spawn(w, argv, dir, ent->dirfd);
+    int ok = pid != -1 && exec_wait(pid) == 0;
+    if (w->stats != NULL){
+        w->stats->exec_ticks += stats_ticks() - start;
+    }
+    for (size_t i = 0; i < ex->argc; i++){
+        if (argv[i] != ex->argv[i]){
+            free(argv[i]);
+        }
+    }
+    free(argv);
+    free(dir);
+    free(item);
+    return ok;
+}
+
+/**
+ *
+ * \brief: replaces every "{}" in an argument of -exec ... ; by the item
+ *
+ * \param arg - the argument as given
+ * \param item - path of the item, or ./name with -execdir
+ *
+ * \return the new argument, owned by the caller
+ *
+ */
+
+static char *exec_arg(const char *arg, const char *item){
+    size_t len = strlen(item);
+    size_t n = 0;
+    for (const char *s = strstr(arg, "{}"); s != NULL; s = strstr(s + 2, "{}")){
+        n++;
+    }
+    char *out = xmalloc(strlen(arg) - 2 * n + len * n + 1);
+    char *o = out;
+    const char *s;
+    while ((s = strstr(arg, "{}")) != NULL){
+        memcpy(o, arg, (size_t)(s - arg));
+        o += s - arg;
+        memcpy(o, item, len);
+        o += len;
+        arg = s + 2;
+    }
+    strcpy(o, arg);
+    return out;
+}
+
+/**
+ *
+ * \brief: splits the path of an item for -execdir into its directory and ./name
+ *
+ * \param path - path of the item, start points may end with slashes
+ * \param dir - receives the directory, "." for start points without one
+ * \param item - receives ./name, "/" for the root itself
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void exec_split(const char *path, char **dir, char **item){
+    size_t len = strlen(path);
+    size_t base;
+    while (len > 1 && path[len - 1] == '/'){
+        len--;
+    }
+    base = len;
+    while (base > 0 && path[base - 1] != '/'){
+        base--;
+    }
+    if (base == len){		//the root directory
+        if ((*dir = strdup("/")) == NULL || (*item = strdup("/")) == NULL){
+            error(EXIT_FAILURE, errno, "strdup");
+        }
+        return;
+    }
+    if ((*dir = base == 0 ? strdup(".") : base == 1 ? strdup("/") : strndup(path, base - 1)) == NULL){
+        error(EXIT_FAILURE, errno, "strndup");
+    }
+    *item = xmalloc(len - base + 3);
+    memcpy(*item, "./", 2);
+    memcpy(*item + 2, path + base, len - base);
+    (*item)[len - base + 2] = '\0';
+}
+
+/**
+ *
+ * \brief: starts the command of an -exec ... + with the items a walker collected, in the background
+ *
+ * \param w - the walker
+ * \param i - index of the batch
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void exec_flush(struct walker *w, size_t i){
+    const struct exec *ex = w->plan->execs[i];
+    struct execbatch *b = &w->batches[i];
+    if (b->nargs == 0){
+        return;
+    }
+    char **argv = xmalloc((ex->argc + b->nargs) * sizeof(*argv));
+    memcpy(argv, ex->argv, (ex->argc - 1) * sizeof(*argv));
+    memcpy(argv + ex->argc - 1, b->args, b->nargs * sizeof(*argv));
+    argv[ex->argc - 1 + b->nargs] = NULL;
+    uint64_t start = w->stats != NULL ? stats_ticks() : 0;
+    jobs_add(w, argv, b->dir);
+    if (w->stats != NULL){
+        w->stats->exec_ticks += stats_ticks() - start;
+    }
+    free(argv);
+    for (size_t j = 0; j < b->nargs; j++){
+        free(b->args[j]);
+    }
+    b->nargs = 0;
+    free(b->dir);
+    b->dir = NULL;
+}
+
+/**
+ *
+ * \brief: starts a command with posix_spawn, which shares the memory with the child like vfork
+ *
+ * The buffered output of the walker is written first, so it comes before anything the command prints.
+ *
+ * \param w - the walker
+ * \param argv - the command and its arguments, NULL terminated, looked up in PATH
+ * \param dir - directory the command runs in, NULL for the current one
+ * \param dirfd - open descriptor of dir, AT_FDCWD to change into it by name
+ *
+ * \return the process id, -1 if the command could not be started, which is reported
+ *
+ */
+
+static pid_t exec_spawn(struct walker *w, char **argv, const char *dir, int dirfd){
+    posix_spawn_file_actions_t actions;
+    pid_t pid;
+    int err;
+    for (size_t i = 0; i < w->plan->noutputs; i++){
+        out_flush(w, i);
+    }
+    if (dir != NULL){
+        posix_spawn_file_actions_init(&actions);
+        if (dirfd != AT_FDCWD){
+            posix_spawn_file_actions_addfchdir_np(&actions, dirfd);
+        }
+        else {
+            posix_spawn_file_actions_addchdir_np(&actions, dir);
+        }
+    }
+    err = posix_spawnp(&pid, argv[0], dir != NULL ? &actions : NULL, NULL, argv, environ);
+    if (dir != NULL){
+        posix_spawn_file_actions_destroy(&actions);
+    }
+    if (w->stats != NULL){
+        w->stats->execs++;
+    }
+    if (err != 0){
+        error(0, err, "cannot run %s", argv[0]);
+        exit_status = 1;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ *
+ * \brief: waits for a command to end
+ *
+ * \param pid - its process id
+ *
+ * \return its exit status, 1 if it was killed by a signal
+ *
+ */
+
+static int exec_wait(pid_t pid){
+    int status;
+    while (waitpid(pid, &status, 0) == -1){
+        if (errno != EINTR){
+            error(0, errno, "waitpid");
+            return 1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+/**
+ *
+ * \brief: starts a command of -exec ... + in the background and registers it
+ *
+ * Commands that ended are collected first. If plan->exec_jobs are still running, the oldest is
+ * waited for, the walk stops until then. Only the own children are waited for by pid, so the
+ * ";" forms running on other threads are not disturbed. The command is started under the lock,
+ * so walkers and readers of -contains flushing at the same time never run more than plan->exec_jobs.
+ *
+ * \param w - the walker
+ * \param argv - the command and its arguments
+ * \param dir - directory the command runs in, NULL for the current one
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void jobs_add(struct walker *w, char **argv, const char *dir){
+    const struct plan *plan = w->plan;
+    int status;
+    pid_t pid;
+    pthread_mutex_lock(&exec_lock);
+    for (size_t i = 0; i < exec_running; i++){
+        pid_t done = waitpid(exec_pids[i], &status, WNOHANG);
+        if (done == exec_pids[i] && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)){
+            exit_status = 1;
+        }
+        if (done == exec_pids[i] || (done == -1 && errno != EINTR)){
+            memmove(&exec_pids[i], &exec_pids[i + 1], (exec_running - i - 1) * sizeof(*exec_pids));
+            exec_running--;
+            i--;
+        }
+    }
+    if (exec_running == (size_t)plan->exec_jobs){
+        if (exec_wait(exec_pids[0]) != 0){
+            exit_status = 1;
+        }
+        memmove(&exec_pids[0], &exec_pids[1], (exec_running - 1) * sizeof(*exec_pids));
+        exec_running--;
+    }
+    if ((pid = exec_spawn(w, argv, dir, AT_FDCWD)) != -1){
+        exec_pids[exec_running++] = pid;
+    }
+    pthread_mutex_unlock(&exec_lock);
+}
+
+/**
+ *
+ * \brief: waits for the commands of -exec ... + still running at the end of the walk
+ *
+ * \return: void function no value returned
+ *
+ */
+
+static void jobs_wait_all(void){
+    pthread_mutex_lock(&exec_lock);
+    for (size_t i = 0; i < exec_running; i++){
+        if (exec_wait(exec_pids[i]) != 0){
+            exit_status = 1;
+        }
+    }
+    exec_running = 0;
+    pthread_mutex_unlock(&exec_lock);
+}
+
+/**
+ * \brief writes what is still buffered when the program terminates early, e.g. on a fatal error
+ *
+ * A daemon ending that way also removes its socket, so the next one can bind it.
+ *
+ * \returns no return value
+ */
+
+static void flush_at_exit(void) {
+    for (int i = 0; i < exit_nwalkers; i++){
+        for (size_t out = 0; out < exit_walkers[i].plan->noutputs; out++){
+            struct outbuf *ob = &exit_walkers[i].out[out];
+            if (ob->len > 0 && write(exit_walkers[i].plan->outputs[out].fd, ob->buf, ob->len) == -1){
+                error(0, errno, "\nError while printing\n");
+            }
+            ob->len = 0;
+        }
+    }
+    if (daemon_socket != NULL){
+        unlinkat(daemon_dir, daemon_socket, 0);
+    }
+}
+
+/**
+ *
+ * \brief registers flush_at_exit, once for all walks of the process
+ *
+ */
+
+static void flush_at_exit_register(void) {
+    atexit(flush_at_exit);
+}
+
+/**
+*
+* \brief checks the file is owned by the user
+*
+* The function do_user compares the owner of the file with the user id
+* the argument of -user was resolved to when the command line was compiled.
+*
+*
+* \param entry_data - contains information about the file and/or directory
+* \param uid - the user id to be checked
+*
+*
+* \return 1 - if it's successful otherwise returns 0
+*
+*/
+static int do_user(const struct stat *entry_data, uid_t uid) {
+    return entry_data->st_uid == uid;
+}
+
+/**
+*
+* \brief resolves the argument of -user to a user id
+*
+* The argument is looked up as a user name first, otherwise it has to be a numeric user id.
+* This is done once while compiling the command line, not for every file.
+*
+*
+* \param parms - the username or id to be resolved
+*
+*
+* \return the user id, the program terminates if the argument is neither
+*
+*/
+static uid_t parse_user(const char * parms) {
+    struct passwd *pwd_entry;
+    char *end;
+    errno = 0;
+    pwd_entry = getpwnam(parms);
+    if (pwd_entry != NULL)
+    {
+        return pwd_entry->pw_uid;
+    }
+    if (errno != 0)
+        error(0, errno, "\nError - user\n");
+    errno = 0;
+    unsigned long uid = strtoul(parms, &end, 10);
+    if (*parms == '\0' || *end != '\0' || errno != 0 || uid != (uid_t)uid){
+        compile_error(0, "`%s' is not the name of a known user", parms);
+    }
+    return (uid_t)uid;
+}
+
+/**
+*
+* \brief checks if items don't belong to a user
+*
+* This function checks if the owner id of an item has no entry in the user database
+*
+*
+* \param entry_data - contains information about the file and/or directory
+*
+* \return 1 - if it's successful otherwise returns 0
+*
+*/
+static int do_nouser(const struct stat *entry_data){
+    return user_name(entry_data->st_uid) == NULL;
+}
+
+/**
+*
+* \brief checks if items are owned by the group entered
+*
+* The function do_group compares the group of the item with the group id
+* the argument of -group was resolved to when the command line was compiled.
+*
+*
+* \param entry_data - contains information about the file and/or directory
+* \param gid - group id to be checked
+*
+*
+* \return 1 - if it's successful otherwise returns 0
+*
+*/
+static int do_group(const struct stat *entry_data, gid_t gid){
+    return entry_data->st_gid == gid;
+}
+
+/**
+*
+* \brief resolves the argument of -group to a group id
+*
+* The argument is looked up as a group name first, otherwise it has to be a numeric group id.
+* This is done once while compiling the command line, not for every file.
+*
+*
+* \param parms - group name or id to be resolved
+*
+*
+* \return the group id, the program terminates if the argument is neither
+*
+*/
+static gid_t parse_group(const char * parms)
+{
+    struct group *gr_entry;
+    char *end;
+    errno = 0;
+    gr_entry = getgrnam(parms);
+    if (gr_entry != NULL)
+    {
+        return gr_entry->gr_gid;
+    }
+    if (errno != 0) {
+        error(0, errno, "\nError - group\n");
+    }
+    errno = 0;
+    unsigned long gid = strtoul(parms, &end, 10);
+    if (*parms == '\0' || *end != '\0' || errno != 0 || gid != (gid_t)gid){
+        compile_error(0, "`%s' is not the name of an existing group", parms);
+    }
+    return (gid_t)gid;
+}
+
+/**
+*
+* \brief checks if items don't belong to a group
+*
+* This function checks if the group id of an item has no entry in the group database
+*
+*
+* \param entry_data - contains information about the file and/or directory
+*
+* \return 1 - if it's successful otherwise returns 0
+*
+*/
+static int do_nogroup(const struct stat *entry_data){
+    return group_name(entry_data->st_gid) == NULL;
+}
+
+/**
+*
+* \brief reads a numeric argument like +n, -n or n into the range of values it accepts
+*
+*
+* \param e - the primary, receives the range
+* \param option - name of the primary for the error message
+* \param value - the argument
+*
+* \return no return value
+*
+*/
+static void parse_range(struct expr *e, const char *option, const char *value){
+    int64_t n;
+    int cmp = parse_cmp(option, value, &n, NULL);
+    e->arg.range.lo = cmp > 0 ? n + 1 : cmp < 0 ? INT64_MIN : n;
+    e->arg.range.hi = cmp > 0 ? INT64_MAX : cmp < 0 ? n - 1 : n;
+}
+
+/**
+*
+* \brief splits a numeric argument into its comparison and the number
+*
+*
+* \param option - name of the primary for the error message
+* \param value - the argument, +n, -n or n
+* \param n - receives the number
+* \param suffix - receives what follows the number, NULL if nothing may follow
+*
+* \return 1 for +n (greater), -1 for -n (less), 0 for n (equal)
+*
+*/
+static int parse_cmp(const char *option, const char *value, int64_t *n, const char **suffix){
+    const char *s = value;
+    char *end;
+    int cmp = 0;
+    if (*s == '+' || *s == '-'){
+        cmp = *s == '+' ? 1 : -1;
+        s++;
+    }
+    errno = 0;
+    unsigned long long number = isdigit((unsigned char)*s) ? strtoull(s, &end, 10) : 0;
+    if (!isdigit((unsigned char)*s) || errno != 0 || number > INT64_MAX || (suffix == NULL && *end != '\0')){
+        compile_error(0, "invalid argument `%s' to `%s'", value, option);
+    }
+    if (suffix != NULL){
+        *suffix = end;
+    }
+    *n = (int64_t)number;
+    return cmp;
+}
+
+/**
+*
+* \brief reads the argument of -size, n[cwbkMG] with 512 byte blocks by default
+*
+* Sizes are rounded up to whole units like in POSIX find, so -size -1M only matches empty files.
+*
+*
+* \param e - the primary, receives the range of units and the unit
+* \param option - name of the primary for the error message
+* \param value - the argument
+*
+* \return no return value
+*
+*/
+static void parse_filesize(struct expr *e, const char *option, const char *value){
+    static const char units[] = "cwbkMG";
+    static const int64_t bytes[] = {1, 2, 512, 1024, 1024 * 1024, 1024 * 1024 * 1024};
+    const char *suffix;
+    int64_t n;
+    int cmp = parse_cmp(option, value, &n, &suffix);
+    const char *unit = *suffix != '\0' ? strchr(units, *suffix) : strchr(units, 'b');
+    if (unit == NULL || (*suffix != '\0' && suffix[1] != '\0')){
+        compile_error(0, "invalid argument `%s' to `%s'", value, option);
+    }
+    e->arg.range.unit = bytes[unit - units];
+    e->arg.range.lo = cmp > 0 ? n + 1 : cmp < 0 ? INT64_MIN : n;
+    e->arg.range.hi = cmp > 0 ? INT64_MAX : cmp < 0 ? n - 1 : n;
+}
+
+/**
+*
+* \brief turns the argument of -atime, -ctime, -mtime or -amin, -cmin, -mmin into a range of times
+*
+* Ages are counted from the start of the program. In days the remainder is discarded like POSIX
+* says, so "n" accepts the times in (now - (n + 1) days, now - n days]. Minutes are rounded up
+* like in GNU find: "n" accepts ages in ((n - 1) minutes, n minutes], +n and -n compare exactly.
+* The bounds are computed here once, items only compare their time in nanoseconds.
+*
+*
+* \param e - the primary, receives the range and the time field
+* \param option - name of the primary, its second letter names the field
+* \param value - the argument
+* \param now - start of the program in nanoseconds since the epoch
+*
+* \return no return value
+*
+*/
+static void parse_age(struct expr *e, const char *option, const char *value, int64_t now){
+    int minutes = strcmp(option + 2, "min") == 0;
+    int64_t unit = minutes ? 60 * NSEC_PER_SEC : 86400 * NSEC_PER_SEC;
+    int64_t n;
+    int cmp = parse_cmp(option, value, &n, NULL);
+    int64_t newest = time_back(now, minutes ? n - 1 : n, unit);		//times of age n are before or at this one
+    int64_t oldest = time_back(now, minutes ? n : n + 1, unit);		//and after this one
+    e->arg.range.field = option[1];
+    if (minutes){
+        e->arg.range.lo = cmp > 0 ? INT64_MIN : cmp < 0 ? oldest + 1 : oldest;
+        e->arg.range.hi = cmp > 0 ? oldest - 1 : cmp < 0 ? INT64_MAX : newest - 1;
+    }
+    else {
+        e->arg.range.lo = cmp > 0 ? INT64_MIN : cmp < 0 ? newest + 1 : oldest + 1;
+        e->arg.range.hi = cmp > 0 ? oldest : cmp < 0 ? INT64_MAX : newest;
+    }
+}
+
+/**
+*
+* \brief steps back from a time by a number of units without overflowing
+*
+*
+* \param now - the time in nanoseconds
+* \param n - number of units
+* \param unit - nanoseconds per unit
+*
+* \return the time, INT64_MIN if it is before what can be represented
+*
+*/
+static int64_t time_back(int64_t now, int64_t n, int64_t unit){
+    int64_t span;
+    int64_t t;
+    if (__builtin_mul_overflow(n, unit, &span) || __builtin_sub_overflow(now, span, &t)){
+        return INT64_MIN;
+    }
+    return t;
+}
+
+/**
+*
+* \brief reads the modification time of the reference file of -newer, once
+*
+*
+* \param e - the primary, receives the range of later times
+* \param value - the reference file, symbolic links are not followed
+*
+* \return no return value
+*
+*/
+static void parse_newer(struct expr *e, const char *value){
+    struct stat st;
+    if (fstatat(AT_FDCWD, value, &st, AT_SYMLINK_NOFOLLOW) == -1){
+        compile_error(errno, "cannot stat reference file %s", value);
+    }
+    e->arg.range.field = 'm';
+    e->arg.range.lo = stat_time(&st, 'm') + 1;
+    e->arg.range.hi = INT64_MAX;
+}
+
+/**
+*
+* \brief reads the argument of -perm: an octal or symbolic mode, optionally after - or /
+*
+*
+* \param e - the primary, receives the mode and how it is compared
+* \param option - name of the primary for the error message
+* \param value - the argument
+*
+* \return no return value
+*
+*/
+static void parse_perm(struct expr *e, const char *option, const char *value){
+    const char *s = value;
+    char *end;
+    e->arg.perm.how = '\0';
+    if (*s == '-' || *s == '/'){
+        e->arg.perm.how = *s++;
+    }
+    if (isdigit((unsigned char)*s)){
+        unsigned long mode = strtoul(s, &end, 8);
+        if (*end != '\0' || mode > 07777){
+            compile_error(0, "invalid mode `%s' to `%s'", value, option);
+        }
+        e->arg.perm.mode = (mode_t)mode;
+        return;
+    }
+    e->arg.perm.mode = parse_symbolic(option, value, s);
+}
+
+/**
+*
+* \brief applies a symbolic mode like u+w,g=rx to no bits at all, there is no umask in find
+*
+*
+* \param option - name of the primary for the error message
+* \param value - the whole argument for the error message
+* \param s - the symbolic mode
+*
+* \return the permission bits
+*
+*/
+static mode_t parse_symbolic(const char *option, const char *value, const char *s){
+    mode_t mode = 0;
+    for (;;){
+        mode_t who = 0;
+        for (; *s == 'u' || *s == 'g' || *s == 'o' || *s == 'a'; s++){
+            who |= *s == 'u' ? S_ISUID | S_IRWXU : *s == 'g' ? S_ISGID | S_IRWXG : *s == 'o' ? S_ISVTX | S_IRWXO : 07777;
+        }
+        if (who == 0){
+            who = 07777;
+        }
+        if (*s != '+' && *s != '-' && *s != '='){
+            compile_error(0, "invalid mode `%s' to `%s'", value, option);
+        }
+        while (*s == '+' || *s == '-' || *s == '='){
+            char op = *s++;
+            mode_t bits = 0;
+            for (; *s != '\0' && strchr("rwxXst", *s) != NULL; s++){
+                bits |= *s == 'r' ? 0444 : *s == 'w' ? 0222 : *s == 's' ? S_ISUID | S_ISGID : *s == 't' ? S_ISVTX : 0111;
+            }
+            bits &= who;
+            mode = op == '+' ? mode | bits : op == '-' ? mode & ~bits : (mode & ~who) | bits;
+        }
+        if (*s == '\0'){
+            return mode;
+        }
+        if (*s++ != ','){
+            compile_error(0, "invalid mode `%s' to `%s'", value, option);
+        }
+    }
+}
+
+/**
+*
+* \brief returns one of the times of an item in nanoseconds since the epoch
+*
+*
+* \param st - the stat data
+* \param field - 'a', 'c' or 'm'
+*
+* \return the time
+*
+*/
+static int64_t stat_time(const struct stat *st, char field){
+    const struct timespec *ts = field == 'a' ? &st->st_atim : field == 'c' ? &st->st_ctim : &st->st_mtim;
+    return (int64_t)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+/**
+*
+* \brief checks the size, a time, the inode number or the link count of an item against the range of the primary
+*
+*
+* \param e - -size, -atime ... -mmin, -newer, -inum or -links
+* \param st - the stat data of the item
+*
+* \return 1 if the value is in the range, 0 otherwise
+*
+*/
+static int do_range(const struct expr *e, const struct stat *st){
+    int64_t v;
+    switch (e->kind){
+        case EXPR_SIZE:
+            v = st->st_size / e->arg.range.unit + (st->st_size % e->arg.range.unit != 0);
+            break;
+        case EXPR_TIME:
+            v = stat_time(st, e->arg.range.field);
+            break;
+        case EXPR_INUM:
+            v = (int64_t)st->st_ino;
+            break;
+        default:
+            v = (int64_t)st->st_nlink;
+            break;
+    }
+    return v >= e->arg.range.lo && v <= e->arg.range.hi;
+}
+
+/**
+*
+* \brief checks the permission bits of an item for -perm
+*
+*
+* \param e - the primary
+* \param st - the stat data of the item
+*
+* \return 1 if the bits match, 0 otherwise
+*
+*/
+static int do_perm(const struct expr *e, const struct stat *st){
+    mode_t mode = st->st_mode & 07777;
+    switch (e->arg.perm.how){
+        case '-':
+            return (mode & e->arg.perm.mode) == e->arg.perm.mode;
+        case '/':
+            return e->arg.perm.mode == 0 || (mode & e->arg.perm.mode) != 0;
+        default:
+            return mode == e->arg.perm.mode;
+    }
+}
+
+/**
+*
+* \brief checks if an item is an empty file or a directory without entries
+*
+* Directories are opened and read until the first entry other than . and .. turns up.
+*
+*
+* \param ent - the item
+* \param st - its stat data
+*
+* \return 1 if it is empty, 0 otherwise
+*
+*/
+static int do_empty(const struct find_entry *ent, const struct stat *st){
+    char buf[1024] __attribute__((aligned(__alignof__(struct dirent64))));
+    ssize_t n;
+    int empty = 1;
+    if (!S_ISDIR(st->st_mode)){
+        return S_ISREG(st->st_mode) && st->st_size == 0;
+    }
+    int fd = openat(ent->dirfd, ent->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1){
+        error(0, errno, "cannot open directory %s", ent->path);
+        return 0;
+    }
+    while (empty && (n = getdents64(fd, buf, sizeof(buf))) > 0){
+        for (ssize_t off = 0; off < n; off += ((struct dirent64 *)(buf + off))->d_reclen){
+            const char *name = ((struct dirent64 *)(buf + off))->d_name;
+            if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0){
+                empty = 0;
+                break;
+            }
+        }
+    }
+    close(fd);
+    return empty;
+}
+
+/**
+*
+* \brief returns the name of a user id, every id is only looked up once
+*
+* Ids without an entry in the user database are cached as well, so -nouser and -ls
+* cost one lookup per distinct owner instead of one per file.
+*
+*
+* \param uid - the user id
+*
+* \return the user name or NULL if the id has no entry
+*
+*/
+static const char *user_name(uid_t uid){
+    const char *name;
+    pthread_mutex_lock(&nss_lock);
+    if (!idcache_get(&user_cache, uid, &name)){
+        struct passwd *pwd_entry;
+        uint64_t start = thread_stats != NULL ? stats_ticks() : 0;
+        errno = 0;
+        pwd_entry = getpwuid(uid);
+        if (thread_stats != NULL){
+            thread_stats->nss++;
+            thread_stats->nss_ticks += stats_ticks() - start;
+        }
+        if (pwd_entry == NULL && errno != 0 && errno != ENOENT && errno != ESRCH) {
+            error(0, errno, "\nError - user\n");
+        }
+        name = idcache_put(&user_cache, uid, pwd_entry != NULL ? pwd_entry->pw_name : NULL);
+    }
+    pthread_mutex_unlock(&nss_lock);
+    return name;
+}
+
+/**
+*
+* \brief returns the name of a group id, every id is only looked up once
+*
+* Ids without an entry in the group database are cached as well, so -nogroup and -ls
+* cost one lookup per distinct group instead of one per file.
+*
+*
+* \param gid - the group id
+*
+* \return the group name or NULL if the id has no entry
+*
+*/
+static const char *group_name(gid_t gid){
+    const char *name;
+    pthread_mutex_lock(&nss_lock);
+    if (!idcache_get(&group_cache, gid, &name)){
+        struct group *gr_entry;
+        uint64_t start = thread_stats != NULL ? stats_ticks() : 0;
+        errno = 0;
+        gr_entry = getgrgid(gid);
+        if (thread_stats != NULL){
+            thread_stats->nss++;
+            thread_stats->nss_ticks += stats_ticks() - start;
+        }
+        if (gr_entry == NULL && errno != 0 && errno != ENOENT && errno != ESRCH) {
+            error(0, errno, "\nError - group\n");
+        }
+        name = idcache_put(&group_cache, gid, gr_entry != NULL ? gr_entry->gr_name : NULL);
+    }
+    pthread_mutex_unlock(&nss_lock);
+    return name;
+}
+
+/**
+*
+* \brief looks an id up in a cache, the caller holds nss_lock
+*
+*
+* \param cache - the user or group cache
+* \param id - the user or group id
+* \param name - receives the cached name, NULL for ids without an entry
+*
+* \return 1 if the id is cached, 0 otherwise
+*
+*/
+static int idcache_get(const struct idcache *cache, unsigned int id, const char **name){
+    if (cache->cap == 0){
+        return 0;
+    }
+    for (size_t i = IDCACHE_HASH(id) & (cache->cap - 1); cache->slots[i].used; i = (i + 1) & (cache->cap - 1)){
+        if (cache->slots[i].id == id){
+            *name = cache->slots[i].name;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+*
+* \brief adds an id to a cache, the caller holds nss_lock
+*
+* The table uses open addressing and doubles once it is half full.
+*
+*
+* \param cache - the user or group cache
+* \param id - the user or group id
+* \param name - the name from the database or NULL, it is copied
+*
+* \return the cached copy of the name
+*
+*/
+static const char *idcache_put(struct idcache *cache, unsigned int id, const char *name){
+    if (2 * (cache->count + 1) > cache->cap){
+        struct idcache grown;
+        grown.cap = cache->cap ? cache->cap * 2 : IDCACHE_INITIAL;
+        grown.count = 0;
+        grown.slots = xmalloc(grown.cap * sizeof(*grown.slots));
+        memset(grown.slots, 0, grown.cap * sizeof(*grown.slots));
+        for (size_t i = 0; i < cache->cap; i++){
+            if (cache->slots[i].used){
+                idcache_put(&grown, cache->slots[i].id, NULL);
+                grown.slots[idcache_slot(&grown, cache->slots[i].id)].name = cache->slots[i].name;
+            }
+        }
+        free(cache->slots);
+        *cache = grown;
+    }
+    size_t i = idcache_slot(cache, id);
+    char *copy = NULL;
+    if (name != NULL && (copy = strdup(name)) == NULL){
+        error(EXIT_FAILURE, errno, "strdup");
+    }
+    cache->slots[i].used = 1;
+    cache->slots[i].id = id;
+    cache->slots[i].name = copy;
+    cache->count++;
+    return copy;
+}
+
+/**
+*
+* \brief finds the slot of an id or the free slot it belongs into
+*
+*
+* \param cache - the user or group cache, it has at least one free slot
+* \param id - the user or group id
+*
+* \return index of the slot
+*
+*/
+static size_t idcache_slot(const struct idcache *cache, unsigned int id){
+    size_t i = IDCACHE_HASH(id) & (cache->cap - 1);
+    while (cache->slots[i].used && cache->slots[i].id != id){
+        i = (i + 1) & (cache->cap - 1);
+    }
+    return i;
+}
+
+/**
+*
+* \brief empties the user or group cache, so the names are looked up again (-daemon)
+*
+*
+* \param cache - the user or group cache, the caller holds nss_lock
+*
+* \return: void function no value returned
+*
+*/
+static void idcache_clear(struct idcache *cache){
+    for (size_t i = 0; i < cache->cap; i++){
+        free((char *)cache->slots[i].name);
+    }
+    free(cache->slots);
+    cache->slots = NULL;
+    cache->cap = 0;
+    cache->count = 0;
+}
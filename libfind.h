@@ -0,0 +1,214 @@
+/*
+ * libfind.h
+ *
+ *\description: the search engine of find as a library. A query is compiled once from
+ * a command line, or from its parts, and can then be walked any number of times:
+ *
+ *      char err[512];
+ *      struct find_query *q = find_compile(argc, argv, err, sizeof(err));
+ *      find_walk(q, callback, arg);                    //push: callback per result
+ *
+ *      struct find_iter *it = find_iter_open(q);       //pull
+ *      struct find_entry *e;
+ *      while ((e = find_iter_next(it)) != NULL){
+ *          puts(find_entry_path(e));
+ *      }
+ *      find_iter_close(it);
+ *      find_free(q);
+ *
+ * The results are the items -print would write, including the implied -print of an
+ * expression without actions. The other actions (-ls, -printf, -fprint, -exec, ...)
+ * work like on the command line. An entry is borrowed: it stays valid during the
+ * callback, or until the next find_iter_next, and nothing is allocated per result.
+ *
+ * Errors in the command line are returned by the compile functions, other errors are
+ * reported on stderr and end the process like in the command line tool (out of memory,
+ * an unreadable index of -db, a failed write to an output). Several queries can be
+ * walked at once on different threads, but a query is walked by one walk at a time.
+ * The counters of -stats, the job limit of -exec ... + and the exit status are shared
+ * by all walks of the process.
+ */
+
+#ifndef LIBFIND_H
+#define LIBFIND_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct find_query;      //a compiled query
+struct find_entry;      //an item of the walk, borrowed
+struct find_iter;       //a walk whose results are pulled
+
+/**
+ * a query given by its parts instead of a command line, a zeroed struct searches the current directory for everything
+ */
+struct find_spec {
+    const char *const *paths;   //start points, NULL terminated, NULL for the current directory
+    const char *const *expr;    //the expression as command line arguments, NULL terminated, NULL matches everything
+    int jobs;                   //threads walking the tree (-j), 0 for one, at most 4 per processor and 1024
+    int maxdepth;               //levels read below the start points (-maxdepth), 0 for no limit
+    int mindepth;               //items above this level are not checked (-mindepth)
+    int xdev;                   //1 to stay on the file system of each start point (-xdev)
+};
+
+/**
+ * receives the results of find_walk, with -j or -contains from several threads at once, with -sort in order
+ * from the calling thread once the walk is done; a value other than 0 ends the walk
+ */
+typedef int (*find_callback)(struct find_entry *entry, void *arg);
+
+/**
+ *
+ * \brief: compiles a command line: start points, then the expression, argv[0] is skipped
+ *
+ * The query points into argv, which has to stay valid until find_free.
+ *
+ * \param argc - number of arguments
+ * \param argv - the arguments like those of main
+ * \param err - receives the message if the command line is invalid, may be NULL
+ * \param errlen - size of err
+ *
+ * \return the query, NULL if the command line is invalid
+ *
+ */
+
+struct find_query *find_compile(int argc, char **argv, char *err, size_t errlen);
+
+/**
+ *
+ * \brief: compiles a query from its parts, the strings have to stay valid until find_free
+ *
+ * \param spec - the query
+ * \param err - receives the message if the query is invalid, may be NULL
+ * \param errlen - size of err
+ *
+ * \return the query, NULL if it is invalid
+ *
+ */
+
+struct find_query *find_compile_spec(const struct find_spec *spec, char *err, size_t errlen);
+
+/**
+ *
+ * \brief: releases a query, files opened by -fprint are closed
+ *
+ */
+
+void find_free(struct find_query *query);
+
+/**
+ *
+ * \brief: walks a query like the command line tool does, the results are written to stdout
+ *
+ * \return the exit status of the tool, 0 or 1 if a command of -exec ... + failed
+ *
+ */
+
+int find_run(struct find_query *query);
+
+/**
+ *
+ * \brief: runs a query in a daemon started with -daemon, it writes the results to stdout
+ *
+ * The daemon reads paths relative to the working directory of the caller and keeps the
+ * listings of unchanged directories, the user and group names and the compiled query for
+ * the queries after this one.
+ *
+ * \param socket_path - the socket the daemon serves
+ * \param argc - number of arguments
+ * \param argv - the start points and the expression, as for find_compile without the program name
+ *
+ * \return the exit status of the query, 1 if the daemon could not be reached
+ *
+ */
+
+int find_client(const char *socket_path, int argc, char **argv);
+
+/**
+ *
+ * \brief: walks a query and hands every result to a callback
+ *
+ * With -watch the changes are handed over as well, until the callback ends the walk.
+ *
+ * \param query - the query
+ * \param callback - called for every result
+ * \param arg - passed to the callback
+ *
+ * \return 0, or 1 if a command of -exec ... + failed
+ *
+ */
+
+int find_walk(struct find_query *query, find_callback callback, void *arg);
+
+/**
+ *
+ * \brief: starts a walk whose results are fetched with find_iter_next
+ *
+ * The walk runs on a thread of its own and stays a few hundred results ahead of the reader.
+ *
+ */
+
+struct find_iter *find_iter_open(struct find_query *query);
+
+/**
+ *
+ * \brief: returns the next result, valid until the next call
+ *
+ * \return the result, NULL at the end of the walk
+ *
+ */
+
+struct find_entry *find_iter_next(struct find_iter *iter);
+
+/**
+ *
+ * \brief: ends a walk, also before all results were fetched, and releases the iterator
+ *
+ * \return 0, or 1 if a command of -exec ... + failed
+ *
+ */
+
+int find_iter_close(struct find_iter *iter);
+
+/**
+ * the whole path of a result, starting with its start point
+ */
+const char *find_entry_path(const struct find_entry *entry);
+
+/**
+ * the last element of the path
+ */
+const char *find_entry_name(const struct find_entry *entry);
+
+/**
+ * levels below its start point, 0 for a start point
+ */
+int find_entry_depth(const struct find_entry *entry);
+
+/**
+ * the DT_* type reported by the directory, DT_UNKNOWN if the file system does not report it
+ */
+unsigned char find_entry_dtype(const struct find_entry *entry);
+
+/**
+ *
+ * \brief: returns the lstat data of a result, fetched on first use unless the query needed it already
+ *
+ * If the query fetched it, fields it did not ask for may be 0 on file systems that only fill
+ * what statx asked for; with -db only the fields kept in the index are set.
+ *
+ * \return the data, NULL if the item cannot be read anymore
+ *
+ */
+
+const struct stat *find_entry_stat(struct find_entry *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
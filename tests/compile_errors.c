@@ -0,0 +1,66 @@
+/**
+ * compile_errors.c
+ *
+ * Compiles command lines that are all wrong, over and over, and checks that
+ * find_compile rejects each of them with a message. Built with AddressSanitizer
+ * by the Makefile next to it, so whatever a failed compile leaves allocated is
+ * reported as a leak when the program ends.
+ *
+ * Usage:
+ *      ./compile_errors [ <rounds> ]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../libfind.h"
+
+#define ROUNDS 200      //times every command line is compiled by default
+
+/**
+ * command lines find_compile has to reject, NULL ends each of them
+ */
+static const char *cases[][12] = {
+    {"find", ".", "-name", NULL},
+    {"find", ".", "-name", "*.c", "-o", NULL},
+    {"find", ".", "(", "-name", "a", "-o", "-name", "b", NULL},
+    {"find", ".", "!", "(", "-name", "a", "-size", NULL},
+    {"find", ".", "-name", "a", "-path", "*/b", "-frobnicate", NULL},
+    {"find", ".", "-regex", ".*\\.c", "-iname", "x*", "-regex", "(", NULL},
+    {"find", ".", "-contains", "foo", "-type", "q", NULL},
+    {"find", ".", "-printf", "%p %s\\n", "-user", "no-such-user-here", NULL},
+    {"find", ".", "-name-from", "/nonexistent/names", NULL},
+    {"find", ".", "-name", "a", "-contains-from", "/nonexistent/strings", NULL},
+    {"find", ".", "-exec", "echo", "{}", NULL},
+    {"find", ".", "-name", "a", "-exec", "echo", "{}", "{}", "+", NULL},
+    {"find", ".", "-skip-dir", ".git", "-order", "sideways", NULL},
+    {"find", ".", "-fprint", "/nonexistent/out", NULL},
+    {"find", ".", "-perm", "u+q", "-print", NULL},
+    {"find", ".", "-newer", "/nonexistent/ref", NULL},
+    {"find", ".", "-name", "a", ")", NULL},
+    {"find", ".", "-watch", "-db", "/nonexistent/index", NULL},
+};
+
+int main(int argc, char **argv){
+    int rounds = argc > 1 ? atoi(argv[1]) : ROUNDS;
+    char err[512];
+    for (int r = 0; r < rounds; r++){
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++){
+            int n = 0;
+            while (cases[i][n] != NULL){
+                n++;
+            }
+            err[0] = '\0';
+            struct find_query *q = find_compile(n, (char **)cases[i], err, sizeof(err));
+            if (q != NULL || err[0] == '\0'){
+                fprintf(stderr, "compile_errors: case %zu was %s\n", i, q != NULL ? "accepted" : "rejected without a message");
+                return 1;
+            }
+            if (r == 0){
+                printf("%s\n", err);
+            }
+        }
+    }
+    return 0;
+}